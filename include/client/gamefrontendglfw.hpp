@@ -17,6 +17,7 @@
 class ScriptEngine;
 
 #include "server/scene3d.hpp"
+#include "common/delegate_list.hpp"
 
 class GameFrontendGLFW : public GameFrontend
 {
@@ -53,7 +54,7 @@ public:
 private:
     GLFWwindow *m_mainWindow;
     Renderer *m_mainRenderer;
-    boost::signals2::signal<void(double)> m_updateEvents;
+    clean::delegate_list<void(double)> m_updateEvents;
     double m_elapsedTime, m_deltaTime;
 };
 
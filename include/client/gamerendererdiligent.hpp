@@ -47,6 +47,7 @@ struct ModelData
     std::vector<Diligent::RefCntAutoPtr<Diligent::IBuffer>> indexBuffers;
     std::vector<uint32_t> indexCounts;
     size_t meshCount;
+    std::vector<std::shared_ptr<MeshPrimitive>> meshes; // vertex data of morphed draws
 };
 
 struct RenderData 
@@ -55,6 +56,9 @@ struct RenderData
     std::vector<size_t> materialIds;
     Diligent::float4x4 modelMatrix;
     std::vector<Diligent::float4x4> meshMatrices;
+    std::vector<bool> meshMask; // per mesh slot, empty - draw all meshes
+    std::vector<Diligent::float4x4> boneMatrices;
+    std::vector<Diligent::IBuffer*> vertexBuffers; // per mesh slot, replace the model's buffers if set (morphed meshes)
 };
 
 enum VERTEX_COMPONENT_FLAGS : Diligent::Uint32
@@ -92,8 +96,7 @@ public:
     void updateLightColor(const glm::vec4 &color, uint32_t id) override;
     std::string getType() const override;
 
-    void queueRender(size_t modelId, const std::vector<size_t>& materialIds, const glm::mat4& modelMatrix) override;
-    void queueRender(size_t modelId, const std::vector<size_t>& materialIds, const glm::mat4& modelMatrix, const std::vector<glm::mat4>& meshMatrices) override;
+    void queueRender(const RenderItem& item) override;
 
     size_t allocateModel(std::shared_ptr<ModelPrimitive> mesh) override;
 protected:
@@ -128,6 +131,9 @@ private:
     std::vector<Diligent::RefCntAutoPtr<Diligent::ITexture>> m_textures;
 
     std::vector<RenderData> m_queuedRenderObjects;
+    // written once per frame, handed out again after draw()
+    std::vector<Diligent::RefCntAutoPtr<Diligent::IBuffer>> m_dynamicVertexBuffers;
+    size_t m_usedDynamicVertexBuffers = 0;
 
     Diligent::RefCntAutoPtr<Diligent::IRenderDevice> m_pDevice;
     Diligent::RefCntAutoPtr<Diligent::IDeviceContext> m_pImmediateContext;
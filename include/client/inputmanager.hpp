@@ -3,7 +3,7 @@
 
 #include <functional>
 #include <unordered_map>
-#include <boost/signals2.hpp>
+#include "common/delegate_list.hpp"
 
 namespace clean
 {
@@ -71,12 +71,12 @@ public:
     void joystickEventCallback(int jid, int event);
     void joystickEventSubscribe(const clean::joystick_event_callback &callb);
 private:
-    boost::signals2::signal<void(double)> m_updateEvents;
+    clean::delegate_list<void(double)> m_updateEvents;
 
-    boost::signals2::signal<void(int, int, int, int)> m_keyEvents;
-    boost::signals2::signal<void(int, int)> m_mouseBtnEvents;
-    boost::signals2::signal<void(int, int)> m_mousePosEvents;
-    boost::signals2::signal<void(int, int)> m_mouseScrollEvents;
+    clean::delegate_list<void(int, int, int, int)> m_keyEvents;
+    clean::delegate_list<void(int, int)> m_mouseBtnEvents;
+    clean::delegate_list<void(int, int)> m_mousePosEvents;
+    clean::delegate_list<void(int, int)> m_mouseScrollEvents;
 
     std::unordered_map<int, JoystickState> m_connectedJoysticks;
 };
@@ -4,6 +4,7 @@
 #include "common/modelmanager.hpp"
 
 #include <queue>
+#include <span>
 #include <glm/glm.hpp>
 #include <stdexcept>
 
@@ -127,6 +128,19 @@ private:
 class Camera3D;
 class MaterialManager;
 
+// one draw of an allocated model, the optional spans stay empty when unused
+// they only have to stay valid during the queueRender call, the renderer copies what it keeps
+struct RenderItem
+{
+    size_t modelId = 0;
+    glm::mat4 modelMatrix = glm::mat4(1.f);
+    std::span<const size_t> materialIds;
+    std::span<const glm::mat4> meshMatrices; // per mesh slot (node transforms of animated models), identity past the end
+    std::span<const uint32_t> meshIds; // mesh slots to draw (e.g. the active LOD), all meshes if empty
+    std::span<const glm::mat4> bonePalette; // poses the skinned meshes (ModelSkeleton::computePalette)
+    std::span<const std::vector<glm::vec3>> meshPositions; // [meshId] replaces the vertex positions of the slot (morphed meshes), empty ones keep the model's
+};
+
 class Renderer
 {
     friend class MaterialManager;
@@ -147,8 +161,7 @@ public:
     virtual void updateLightPosition(const glm::vec4 &pos, uint32_t id=0) = 0;
     virtual void updateLightColor(const glm::vec4 &color, uint32_t id=0) = 0;
 
-    virtual void queueRender(size_t modelId, const std::vector<size_t>& materialIds, const glm::mat4& modelMatrix) = 0;
-    virtual void queueRender(size_t modelId, const std::vector<size_t>& materialIds, const glm::mat4& modelMatrix, const std::vector<glm::mat4>& meshMatrices) = 0;
+    virtual void queueRender(const RenderItem& item) = 0;
     virtual size_t allocateModel(std::shared_ptr<ModelPrimitive> mesh) = 0;
 
     // lowercase renderer identifier (gl, vk, dx, etc.)
@@ -2,7 +2,7 @@
 #define UIBUTTON_HPP
 
 #include "client/ui/uilabel.hpp"
-#include <boost/signals2.hpp>
+#include "common/delegate_list.hpp"
 
 class UIButton : public UILabel
 {
@@ -15,7 +15,7 @@ public:
 
     virtual UIElement::UIType getType() const override;
 private:
-    boost::signals2::signal<void()> m_clickEvents;
+    clean::delegate_list<void()> m_clickEvents;
 };
 
 #endif // UIBUTTON_HPP
@@ -3,7 +3,7 @@
 
 #include "client/ui/uielement.hpp"
 #include <functional>
-#include <boost/signals2.hpp>
+#include "common/delegate_list.hpp"
 
 class UISpinBox : public UIElement
 {
@@ -32,7 +32,7 @@ public:
     void changeValueSubscribe(const std::function<void(float)> &callb);
     void onChangeValue(float a);
 private:
-    boost::signals2::signal<void(float)> m_changeValueEvents;
+    clean::delegate_list<void(float)> m_changeValueEvents;
 
     std::string m_label;
     float m_value, m_min, m_max;
@@ -3,7 +3,7 @@
 
 #include "client/ui/uielement.hpp"
 
-#include <boost/signals2.hpp>
+#include "common/delegate_list.hpp"
 
 class UITextInput : public UIElement
 {
@@ -27,7 +27,7 @@ public:
     void changeValueSubscribe(const std::function<void(const std::string&)> &callb);
     void onChangeValue(const std::string& val);
 protected:
-    boost::signals2::signal<void(const std::string&)> m_changeValueEvents;
+    clean::delegate_list<void(const std::string&)> m_changeValueEvents;
 
     std::string m_label;
     std::string m_value;
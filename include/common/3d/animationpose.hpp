@@ -0,0 +1,58 @@
+#ifndef ANIMATION_POSE_HPP
+#define ANIMATION_POSE_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "common/3d/animationprimitive.hpp"
+#include "common/3d/modelnodetree.hpp"
+#include "common/3d/modelskeleton.hpp"
+
+// one clip contributing to a blended pose
+struct AnimationLayer
+{
+    const AnimationPrimitive* anim;
+    double timecode;
+    float weight;             // fade from the layers below towards this clip, or the strength of an additive clip
+    bool additive;            // adds the clip's offset from the bind pose on top of the layers below
+    AnimationCursor* cursors; // anim->channelCount() entries, may be nullptr
+};
+
+// local transforms of all nodes or bones as separate arrays, so blends run over contiguous floats
+struct AnimationLocalPose
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+};
+
+// evaluated animation state of a model, owned by an instance or shared through the pose cache
+struct AnimationPose
+{
+    std::vector<glm::mat4> nodeLocals;     // node tree models only
+    std::vector<glm::mat4> nodeGlobals;
+    std::vector<glm::mat4> meshTransforms; // per mesh slot, from the node globals
+    std::vector<glm::mat4> boneLocals;     // skeleton models only
+    std::vector<glm::mat4> bonePalette;
+
+    // samples anim at timecode, cursors holds anim.channelCount() entries (nullptr samples without them)
+    // buffers keep their size while the model stays the same, so steady playback doesn't allocate
+    void evaluate(const AnimationPrimitive& anim, const ModelNodeTree* nodes, const ModelSkeleton* skeleton, double timecode, AnimationCursor* cursors);
+    // samples every layer and blends them bottom up, starting from the bind pose
+    // scratch buffers are members, so once sized a model's blends don't allocate
+    void evaluateBlend(const AnimationLayer* layers, size_t layerCount, const ModelNodeTree* nodes, const ModelSkeleton* skeleton);
+    // blends the mesh and bone palettes of two evaluated poses, t = 0 gives from
+    // cheap stand-in for evaluate() between the samples of instances updated at a reduced rate
+    void interpolate(const AnimationPose& from, const AnimationPose& to, float t);
+
+private:
+    void updatePalettes(const ModelNodeTree* nodes, const ModelSkeleton* skeleton);
+
+    AnimationLocalPose m_blendNodes; // blend result so far
+    AnimationLocalPose m_blendBones;
+    AnimationLocalPose m_layerNodes; // layer being sampled
+    AnimationLocalPose m_layerBones;
+    AnimationLocalPose m_bindBones;
+};
+
+#endif // ANIMATION_POSE_HPP
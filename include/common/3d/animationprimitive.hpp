@@ -3,40 +3,108 @@
 
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <optional>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 
-class AnimationKeyFrame 
+// sampled channel transform, missing components are identity
+struct AnimationTransform
 {
-public:
-    AnimationKeyFrame() = default;
-    AnimationKeyFrame(const glm::mat4& trs, double time);
-    AnimationKeyFrame(double time);
+    glm::vec3 position = glm::vec3(0.f);
+    glm::quat rotation = glm::quat(1.f, 0.f, 0.f, 0.f);
+    glm::vec3 scale = glm::vec3(1.f);
 
-    void setTime(double t);
-    double time() const;
+    glm::mat4 matrix() const;
+};
 
-    void setPosition(const glm::vec3& pos);
-    const std::optional<glm::vec3>& position() const;
+// keys of one channel, components may have different key counts (as Assimp provides them), times ascending
+struct AnimationChannelKeys
+{
+    std::vector<float> positionTimes;
+    std::vector<glm::vec3> positions;
+    std::vector<float> rotationTimes;
+    std::vector<glm::quat> rotations;
+    std::vector<float> scaleTimes;
+    std::vector<glm::vec3> scales;
+};
 
-    void setRotation(const glm::quat& rot);
-    const std::optional<glm::quat>& rotation() const;
+// ranges of a channel inside the flat arrays of its AnimationPrimitive
+struct AnimationChannel
+{
+    uint32_t positionOffset, positionCount;
+    uint32_t rotationOffset, rotationCount;
+    uint32_t scaleOffset, scaleCount;
+    int32_t node; // ModelNodeTree node driven by the channel, -1 if none
+    int32_t bone; // skeleton bone driven by the channel, -1 if none
+    glm::vec3 positionMin;  // compressed clips: position = positionMin + PackedVec3 * positionStep
+    glm::vec3 positionStep;
+};
 
-    void setScale(const glm::vec3& scl);
-    const std::optional<glm::vec3>& scale() const;
+// position quantized to 16 bits per axis inside its channel's range
+struct PackedVec3
+{
+    uint16_t data[3];
+};
 
-    glm::mat4 transform() const;
-private:
-    double m_time;
-    std::optional<glm::vec3> m_position;
-    std::optional<glm::quat> m_rotation;
-    std::optional<glm::vec3> m_scale;
+// smallest three: the three smaller components in 15 bits each, the index of the dropped largest one
+// in the top bits of data[0] (low) and data[1] (high), 48 bits in total
+struct PackedQuat
+{
+    uint16_t data[3];
+};
+
+// per component error allowed when dropping keys that interpolation of their neighbours reproduces
+struct AnimationCompressionSettings
+{
+    float positionTolerance = 1e-3f; // units
+    float rotationTolerance = 1e-3f; // radians
+    float scaleTolerance = 1e-3f;
+};
+
+// errors are measured at the source key times against the uncompressed clip
+struct AnimationCompressionReport
+{
+    size_t bytesBefore;
+    size_t bytesAfter;
+    uint32_t keysBefore;
+    uint32_t keysAfter;
+    float maxPositionError;
+    float maxRotationError; // radians
+    float maxScaleError;
+};
+
+// per instance and channel, remembers the last key pair of each component so playback is O(1) per sample
+struct AnimationCursor
+{
+    uint32_t position = 0;
+    uint32_t rotation = 0;
+    uint32_t scale = 0;
 };
 
+// trade-off of a baked clip, errors are measured halfway between baked frames
+struct AnimationBakeReport
+{
+    double rate;               // frames per second
+    uint32_t frames;
+    size_t keyBytes;           // source keys (memoryUsage() without the baked frames)
+    size_t bakedBytes;
+    float maxTranslationError; // units
+    float maxMatrixError;      // largest element difference of the upper 3x3 (rotation * scale)
+};
+
+// two baked frames of all channels and the blend factor between them
+struct AnimationBakedSample
+{
+    const glm::mat4* frame0; // channelCount() matrices
+    const glm::mat4* frame1;
+    float t;
+
+    glm::mat4 channel(uint32_t channelId) const { return frame0[channelId] + (frame1[channelId] - frame0[channelId]) * t; }
+};
+
+// channels are indexed densely, their keys live in flat per-component arrays
 class AnimationPrimitive
 {
 public:
@@ -49,17 +117,47 @@ public:
     void setDuration(double value);
     double duration() const;
 
+    // returns the new channel index
+    uint32_t addChannel(const AnimationChannelKeys& keys, int32_t node, int32_t bone=-1);
     size_t channelCount() const;
-    void setMeshIds(uint32_t channelId, const std::vector<uint32_t>& meshIds);
-    const std::vector<uint32_t>& affectedMeshIds(uint32_t channelId) const;
+    const AnimationChannel& channel(uint32_t channelId) const;
+    AnimationChannelKeys channelKeys(uint32_t channelId) const;
+
+    int32_t channelNode(uint32_t channelId) const;
+    int32_t channelBone(uint32_t channelId) const;
+
+    AnimationTransform sample(uint32_t channelId, double timecode, AnimationCursor* cursor=nullptr) const;
+
+    // drops redundant keys and quantizes positions and rotations, sampling decompresses on the fly
+    // channels added afterwards are quantized as well (but keep all their keys)
+    AnimationCompressionReport compress(const AnimationCompressionSettings& settings);
+    bool compressed() const;
+
+    // resamples every channel at rate frames per second into channel matrices, baked clips are evaluated
+    // by blending the two surrounding frames instead of searching and interpolating keys
+    AnimationBakeReport bake(double rate);
+    void clearBake();
+    bool baked() const;
+    double bakeRate() const;
+    AnimationBakedSample sampleBaked(double timecode) const;
 
-    void addKeyframe(uint32_t channelId, AnimationKeyFrame keyFrame);
-    AnimationKeyFrame keyframe(uint32_t channelId, double timecode) const;
+    size_t memoryUsage() const; // bytes used by keys, tables and baked frames
 private:
     std::string m_name;
     double m_duration;
-    std::unordered_map<uint32_t, std::vector<AnimationKeyFrame>> m_keyframes;
-    std::unordered_map<uint32_t, std::vector<uint32_t>> m_meshIdsPerChannel;
+    std::vector<AnimationChannel> m_channels;
+    std::vector<float> m_positionTimes;
+    std::vector<glm::vec3> m_positions;
+    std::vector<float> m_rotationTimes;
+    std::vector<glm::quat> m_rotations;
+    std::vector<float> m_scaleTimes;
+    std::vector<glm::vec3> m_scales;
+    bool m_compressed = false;
+    std::vector<PackedVec3> m_packedPositions; // replace m_positions/m_rotations when compressed
+    std::vector<PackedQuat> m_packedRotations;
+    double m_bakeRate = 0.0;
+    uint32_t m_bakedFrames = 0;
+    std::vector<glm::mat4> m_baked; // frame-major, m_bakedFrames * channel count
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,12 @@
+#ifndef ANIMATION_UPDATE_TIER_HPP
+#define ANIMATION_UPDATE_TIER_HPP
+
+// how often an animated instance is evaluated, picked by AnimationSystem::selectTier
+enum class AnimationUpdateTier
+{
+    Full,    // evaluated every frame
+    Reduced, // evaluated every few frames, palettes interpolated in between
+    Paused   // only the playback time advances
+};
+
+#endif // ANIMATION_UPDATE_TIER_HPP
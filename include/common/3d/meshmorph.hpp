@@ -0,0 +1,65 @@
+#ifndef MESH_MORPH_HPP
+#define MESH_MORPH_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// offset of a single vertex, quantized to 16 bits per axis (see MorphKey::scale)
+struct MorphDelta
+{
+    uint32_t vertex;
+    int16_t offset[3];
+};
+
+// sparse vertex offsets from the base mesh, only moved vertices are stored
+struct MorphKey
+{
+    float amount;                   // position of the key inside its target (W3D deform percent), 1 for plain targets
+    glm::vec3 scale;                // offset = MorphDelta::offset * scale
+    std::vector<MorphDelta> deltas; // ascending vertex order
+};
+
+// a morph target is a series of keys, amounts between two keys blend them linearly
+struct MorphTarget
+{
+    std::string name;
+    std::vector<MorphKey> keys; // ascending amount
+};
+
+struct MorphWeight
+{
+    uint32_t target;
+    uint32_t key;
+    float weight;
+};
+
+class MeshMorph
+{
+public:
+    static constexpr float DELTA_EPSILON = 1e-5f; // smaller offsets are dropped
+
+    MeshMorph() = default;
+    ~MeshMorph() = default;
+
+    // full target positions -> sparse quantized key
+    static MorphKey makeKey(float amount, const std::vector<glm::vec3>& base, const std::vector<glm::vec3>& target);
+
+    void addTarget(const MorphTarget& target); // keys are sorted by amount
+    size_t targetCount() const;
+    const MorphTarget& target(size_t index) const;
+    int32_t findTarget(const std::string& name) const;
+
+    // appends the keys making up target at amount [0; last key amount], amount 0 is the base mesh
+    void blend(uint32_t target, float amount, float weight, std::vector<MorphWeight>& weights) const;
+    // adds the weighted key offsets to positions (base mesh positions)
+    void apply(const std::vector<MorphWeight>& weights, std::vector<glm::vec3>& positions) const;
+
+    size_t deltaCount() const;
+    size_t memoryUsage() const; // bytes used by the keys
+private:
+    std::vector<MorphTarget> m_targets;
+};
+
+#endif // MESH_MORPH_HPP
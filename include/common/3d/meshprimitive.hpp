@@ -3,8 +3,11 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include <glm/glm.hpp>
 
+#include "common/3d/meshmorph.hpp"
+
 
 enum class VertexType
 {
@@ -39,6 +42,27 @@ private:
     VertexType m_type;
 };
 
+// axis aligned box and a sphere around the box center, both enclosing all points
+struct BoundingVolume
+{
+    glm::vec3 min = glm::vec3(0.f);
+    glm::vec3 max = glm::vec3(0.f);
+    glm::vec3 center = glm::vec3(0.f);
+    float radius = 0.f;
+
+    static BoundingVolume fromPoints(const std::vector<glm::vec3>& points);
+};
+
+// bones a skinned mesh may reference, the size of g_BoneTransforms in texture.vsh
+#define MAX_BONE_TRANSFORMS 128
+
+// up to four bones per vertex, unused slots have zero weight
+struct VertexInfluence
+{
+    uint16_t bones[4];
+    float weights[4];
+};
+
 class MeshPrimitive
 {
 public:
@@ -57,15 +81,38 @@ public:
     void addIndex(unsigned int index);
 
     size_t vertexCount() const;
+    const std::vector<VertexPrimitive>& vertices() const;
     const std::vector<char> vertexData() const;
+    size_t vertexStride() const; // bytes per vertex in vertexData()
+    // vertexData() into data (vertexCount() * vertexStride() bytes), positions replace the vertex positions if set
+    void writeVertexData(char* data, const std::vector<glm::vec3>* positions=nullptr) const;
 
     size_t indexCount() const;
+    const std::vector<uint32_t>& indices() const;
     const std::vector<char> indexData() const;
+
+    // skinned meshes have one influence per vertex, positions are in bone space
+    void addInfluence(const VertexInfluence& influence);
+    bool isSkinned() const;
+    const std::vector<VertexInfluence>& influences() const;
+    uint32_t requiredBoneCount() const; // palette size needed to skin this mesh
+
+    // morph targets (W3D deforms, Assimp anim meshes), nullptr if the mesh has none
+    void setMorph(std::shared_ptr<MeshMorph> morph);
+    std::shared_ptr<MeshMorph> morph() const;
+
+    // bind pose bounds in model space, filled by the importers
+    void setBounds(const BoundingVolume& bounds);
+    const BoundingVolume& bounds() const;
 private:
     uint32_t m_id; // meshId in model
     std::string m_name;
     std::vector<VertexPrimitive> m_vertices;
     std::vector<uint32_t> m_indices;
+    std::vector<VertexInfluence> m_influences;
+    uint32_t m_requiredBoneCount = 0;
+    std::shared_ptr<MeshMorph> m_morph;
+    BoundingVolume m_bounds;
 };
 
 #endif
\ No newline at end of file
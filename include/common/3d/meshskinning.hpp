@@ -0,0 +1,21 @@
+#ifndef MESH_SKINNING_HPP
+#define MESH_SKINNING_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "common/3d/meshprimitive.hpp"
+
+// CPU linear blend skinning (headless servers, hit testing), uses AVX or SSE when the build enables them
+class MeshSkinning
+{
+public:
+    // positions (and optionally normals) of a skinned mesh posed by the palette, rigid meshes are copied
+    static void skin(const MeshPrimitive& mesh, const std::vector<glm::mat4>& palette,
+                     std::vector<glm::vec3>& positions, std::vector<glm::vec3>* normals=nullptr);
+
+    // "avx", "sse" or "scalar"
+    static const char* simdPath();
+};
+
+#endif // MESH_SKINNING_HPP
@@ -0,0 +1,26 @@
+#ifndef MODEL_CACHE_HPP
+#define MODEL_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "common/3d/modelprimitive.hpp"
+
+#define MODEL_CACHE_MAGIC   "CMDL"
+
+// cooked model format: ready to use meshes, BVHs, skeleton, node tree, morph targets, LODs, animations and morph animations in native (little endian) byte order
+class ModelCache
+{
+public:
+    static constexpr uint32_t VERSION = 9;
+
+    // 'art/w3d/abc.w3d' -> 'cooked/art/w3d/abc.w3d.cmdl'
+    static std::string cookedPath(const std::string& sourcePath);
+
+    static std::vector<char> serialize(const ModelPrimitive& model);
+    static std::shared_ptr<ModelPrimitive> deserialize(const std::vector<char>& data);
+};
+
+#endif // MODEL_CACHE_HPP
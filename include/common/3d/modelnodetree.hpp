@@ -0,0 +1,53 @@
+#ifndef MODEL_NODE_TREE_HPP
+#define MODEL_NODE_TREE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// scene node hierarchy flattened into parent-index arrays, parents always precede their children
+// mesh vertices are stored in the bind pose global space of their node
+class ModelNodeTree
+{
+public:
+    ModelNodeTree() = default;
+    ~ModelNodeTree() = default;
+
+    // parent is -1 for roots, returns the node index
+    uint32_t addNode(const std::string& name, int32_t parent, const glm::mat4& local);
+    size_t nodeCount() const;
+    const std::string& nodeName(size_t index) const;
+    int32_t findNode(const std::string& name) const;
+
+    const std::vector<int32_t>& parents() const;
+    const std::vector<glm::mat4>& bindLocals() const;
+    const std::vector<glm::mat4>& bindGlobals() const;
+    // bind locals split into translation, rotation and scale for blending
+    const std::vector<glm::vec3>& bindPositions() const;
+    const std::vector<glm::quat>& bindRotations() const;
+    const std::vector<glm::vec3>& bindScales() const;
+
+    // node the mesh slot hangs from, -1 if none
+    void attachMesh(uint32_t meshSlot, int32_t node);
+    int32_t meshNode(uint32_t meshSlot) const;
+    size_t meshCount() const; // highest attached mesh slot + 1
+
+    // local -> global transforms in one pass over the nodes, locals[i] per node
+    void computeGlobals(const std::vector<glm::mat4>& locals, std::vector<glm::mat4>& globals) const;
+    // per mesh slot: global * inverse(bind global) of its node, identity for detached meshes
+    void computeMeshPalette(const std::vector<glm::mat4>& globals, std::vector<glm::mat4>& meshTransforms) const;
+private:
+    std::vector<std::string> m_names;
+    std::vector<int32_t> m_parents;
+    std::vector<glm::mat4> m_bindLocals;
+    std::vector<glm::mat4> m_bindGlobals;
+    std::vector<glm::mat4> m_inverseBindGlobals;
+    std::vector<glm::vec3> m_bindPositions;
+    std::vector<glm::quat> m_bindRotations;
+    std::vector<glm::vec3> m_bindScales;
+    std::vector<int32_t> m_meshNodes; // per mesh slot
+};
+
+#endif // MODEL_NODE_TREE_HPP
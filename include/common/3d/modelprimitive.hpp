@@ -2,9 +2,30 @@
 #define MODEL_PRIMITIVE_HPP
 
 #include <memory>
+#include <vector>
+#include <glm/vec3.hpp>
 
 #include "common/3d/meshprimitive.hpp"
 #include "common/3d/animationprimitive.hpp"
+#include "common/3d/morphanimation.hpp"
+#include "common/3d/trianglebvh.hpp"
+#include "common/3d/modelskeleton.hpp"
+#include "common/3d/modelnodetree.hpp"
+
+// single level of detail of a model (W3D HLOD array)
+struct ModelLOD
+{
+    float maxScreenSize;            // fraction of the screen area covered by the model
+    std::vector<uint32_t> meshIds;  // mesh slots drawn at this level
+};
+
+struct ModelRayHit
+{
+    float t;            // segment parameter, stays valid after affine transforms
+    uint32_t meshId;    // mesh slot
+    uint32_t triangle;
+    glm::vec3 point;
+};
 
 class ModelPrimitive
 {
@@ -26,9 +47,46 @@ public:
 
     std::shared_ptr<AnimationPrimitive> animation(size_t index) const;
     std::shared_ptr<AnimationPrimitive> animation(const std::string& name) const;
+
+    // morph target weights over time, tracks refer to the mesh slots and their MeshMorph targets
+    void addMorphAnimation(std::shared_ptr<MorphAnimation> anim);
+    size_t morphAnimationCount() const;
+    std::shared_ptr<MorphAnimation> morphAnimation(size_t index) const;
+    std::shared_ptr<MorphAnimation> morphAnimation(const std::string& name) const;
+
+    // LODs are ordered from the lowest to the highest detail
+    void addLOD(const ModelLOD& lod);
+    size_t lodCount() const;
+    const ModelLOD& lod(size_t index) const;
+    size_t selectLOD(float screenSize) const;
+
+    // bind pose bounds of all meshes in model space
+    void setBounds(const BoundingVolume& bounds);
+    const BoundingVolume& bounds() const;
+    const glm::vec3& boundingCenter() const;
+    float boundingRadius() const;
+
+    // nullptr for models without skinned meshes
+    void setSkeleton(std::shared_ptr<ModelSkeleton> skeleton);
+    std::shared_ptr<ModelSkeleton> skeleton() const;
+
+    // scene nodes the animation channels drive, nullptr if the model has none
+    void setNodeTree(std::shared_ptr<ModelNodeTree> nodes);
+    std::shared_ptr<ModelNodeTree> nodeTree() const;
+
+    void setMeshBVH(size_t index, std::shared_ptr<TriangleBVH> bvh);
+    std::shared_ptr<TriangleBVH> meshBVH(size_t index) const;
+    // closest model space hit, only meshes of the most detailed LOD are tested
+    bool raycast(const RaySegment& ray, ModelRayHit& hit) const;
 private:
     std::vector<std::shared_ptr<MeshPrimitive>> m_meshes;
     std::vector<std::shared_ptr<AnimationPrimitive>> m_animations;
+    std::vector<std::shared_ptr<MorphAnimation>> m_morphAnimations;
+    std::vector<std::shared_ptr<TriangleBVH>> m_meshBVHs;
+    std::vector<ModelLOD> m_lods;
+    std::shared_ptr<ModelSkeleton> m_skeleton;
+    std::shared_ptr<ModelNodeTree> m_nodeTree;
+    BoundingVolume m_bounds;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef MODEL_SKELETON_HPP
+#define MODEL_SKELETON_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+struct SkeletonBone
+{
+    std::string name;
+    int32_t parent;         // -1 for roots, always lower than the bone index
+    glm::vec3 translation;  // bind pose relative to the parent
+    glm::quat rotation;
+    glm::mat4 offset;       // mesh space -> bone space, identity for W3D (skin vertices are stored in bone space)
+};
+
+// bone hierarchy (W3D pivots), bones are stored parents first
+class ModelSkeleton
+{
+public:
+    ModelSkeleton() = default;
+    ~ModelSkeleton() = default;
+
+    void addBone(const SkeletonBone& bone);
+    size_t boneCount() const;
+    const SkeletonBone& bone(size_t index) const;
+    int32_t findBone(const std::string& name) const;
+
+    // applied on top of the root bones (e.g. W3D Z-up -> engine Y-up)
+    void setRootTransform(const glm::mat4& transform);
+    const glm::mat4& rootTransform() const;
+
+    const std::vector<glm::mat4>& bindLocalTransforms() const;
+    // local bone transforms -> skinning palette (root * global * offset), locals[i] per bone
+    void computePalette(const std::vector<glm::mat4>& locals, std::vector<glm::mat4>& palette) const;
+    const std::vector<glm::mat4>& bindPalette() const;
+private:
+    void updateBindPalette();
+
+    std::vector<SkeletonBone> m_bones;
+    glm::mat4 m_rootTransform = glm::mat4(1.f);
+    std::vector<glm::mat4> m_bindLocals;
+    std::vector<glm::mat4> m_bindPalette;
+};
+
+#endif // MODEL_SKELETON_HPP
@@ -0,0 +1,45 @@
+#ifndef MORPH_ANIMATION_HPP
+#define MORPH_ANIMATION_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "common/3d/meshmorph.hpp"
+
+// moves one morph target of one mesh through its keys (poses) over time
+struct MorphTrack
+{
+    uint32_t mesh;               // mesh slot in the model
+    uint32_t target;             // target of the mesh's MeshMorph
+    std::vector<float> times;    // seconds, ascending
+    std::vector<uint32_t> poses; // 0 is the base mesh, p > 0 is key p - 1 of the target
+};
+
+// morph target weights over time (W3D morph anims), between two keys the poses are blended linearly
+class MorphAnimation
+{
+public:
+    MorphAnimation() = default;
+    MorphAnimation(const std::string& name, double duration);
+
+    const std::string& name() const;
+    double duration() const;
+
+    void addTrack(const MorphTrack& track);
+    size_t trackCount() const;
+    const MorphTrack& track(size_t index) const;
+    // the animation has tracks for the mesh slot
+    bool drives(uint32_t mesh) const;
+
+    // appends the weighted keys of the mesh's tracks at timecode, input for MeshMorph::apply
+    void sample(uint32_t mesh, double timecode, std::vector<MorphWeight>& weights) const;
+
+    size_t memoryUsage() const; // bytes used by the tracks
+private:
+    std::string m_name;
+    double m_duration = 0.0;
+    std::vector<MorphTrack> m_tracks;
+};
+
+#endif // MORPH_ANIMATION_HPP
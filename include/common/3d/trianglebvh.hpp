@@ -0,0 +1,72 @@
+#ifndef TRIANGLE_BVH_HPP
+#define TRIANGLE_BVH_HPP
+
+#include <vector>
+#include <cstdint>
+#include <glm/vec3.hpp>
+
+// ray or segment, hits are reported as origin + t * direction for t in [0, maxT]
+struct RaySegment
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float maxT;
+
+    static RaySegment fromPoints(const glm::vec3& from, const glm::vec3& to);
+};
+
+struct TriangleHit
+{
+    float t;
+    uint32_t triangle; // face index in the mesh
+    glm::vec3 point;
+};
+
+// same encoding as W3D AABTree nodes: MSB of frontOrFirst marks a leaf
+struct BVHNode
+{
+    glm::vec3 min;
+    uint32_t frontOrFirst;
+    glm::vec3 max;
+    uint32_t backOrCount;
+
+    bool isLeaf() const { return (frontOrFirst & 0x80000000) != 0; }
+    uint32_t first() const { return frontOrFirst & 0x7FFFFFFF; }
+};
+
+class TriangleBVH
+{
+public:
+    TriangleBVH() = default;
+    ~TriangleBVH() = default;
+
+    // binned SAH build
+    void build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+    // reuse a prebuilt topology (W3D AABTree), node bounds are refit to the given positions
+    void build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+               const std::vector<BVHNode>& nodes, const std::vector<uint32_t>& triangleOrder);
+
+    // closest hit along the segment
+    bool intersect(const RaySegment& ray, TriangleHit& hit) const;
+
+    bool empty() const;
+    size_t nodeCount() const;
+    size_t triangleCount() const;
+    // longest root to leaf path, the traversal stack of intersect() never holds more than depth() + 1 nodes
+    uint32_t depth() const;
+    const glm::vec3& boundsMin() const;
+    const glm::vec3& boundsMax() const;
+    const std::vector<BVHNode>& nodes() const;
+    const std::vector<uint32_t>& triangleOrder() const;
+private:
+    void buildTriangles(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+    // returns the depth of the subtree
+    uint32_t refit(uint32_t nodeId);
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<uint32_t> m_triangleOrder;  // leaf ranges index into this
+    std::vector<glm::vec3> m_vertices;      // v0, edge1, edge2 per leaf slot
+    uint32_t m_depth = 0;
+};
+
+#endif // TRIANGLE_BVH_HPP
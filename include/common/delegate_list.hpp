@@ -0,0 +1,131 @@
+#ifndef DELEGATE_LIST_HPP
+#define DELEGATE_LIST_HPP
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+namespace clean
+{
+
+template<typename Signature>
+class delegate_list;
+
+// callbacks called in connection order, for events raised on one thread (per frame updates, input)
+// no locks and no per call bookkeeping, an emission is a walk over a vector
+// callbacks may connect and disconnect during an emission: new ones are called from the next emission on,
+// disconnected ones are skipped right away and their entries removed once the outermost emission is done
+template<typename... Args>
+class delegate_list<void(Args...)>
+{
+public:
+    using callback = std::function<void(Args...)>;
+    using connection = uint32_t;
+
+    delegate_list()
+        : m_nextId(1),
+          m_emitting(0),
+          m_removed(false)
+    { }
+
+    delegate_list(const delegate_list<void(Args...)> &) = delete;
+    delegate_list<void(Args...)> &operator =(const delegate_list<void(Args...)> &) = delete;
+
+    connection connect(const callback &fn)
+    {
+        connection id = m_nextId++;
+        // appending could move the callback that is running
+        if(m_emitting > 0)
+            m_added.push_back(entry{fn, id});
+        else
+            m_entries.push_back(entry{fn, id});
+        return id;
+    }
+
+    void disconnect(connection id)
+    {
+        for(auto *entries : {&m_entries, &m_added})
+        {
+            for(size_t i = 0; i < entries->size(); i++)
+            {
+                if((*entries)[i].id != id)
+                    continue;
+                if(m_emitting > 0)
+                {
+                    (*entries)[i].id = 0;
+                    m_removed = true;
+                }
+                else
+                    entries->erase(entries->begin() + i);
+                return;
+            }
+        }
+    }
+
+    void clear()
+    {
+        for(auto &e : m_entries)
+            e.id = 0;
+        m_added.clear();
+        m_removed = !m_entries.empty();
+        if(m_emitting == 0)
+            compact();
+    }
+
+    bool empty() const
+    {
+        return m_entries.empty() && m_added.empty();
+    }
+
+    size_t size() const
+    {
+        return m_entries.size() + m_added.size();
+    }
+
+    void operator()(Args... args)
+    {
+        if(m_entries.empty())
+            return;
+
+        m_emitting++;
+        // the vector doesn't change while emitting, only entries are marked
+        for(size_t i = 0; i < m_entries.size(); i++)
+        {
+            if(m_entries[i].id != 0)
+                m_entries[i].fn(args...);
+        }
+        if(--m_emitting == 0)
+            compact();
+    }
+
+private:
+    struct entry
+    {
+        callback fn;
+        connection id; // 0 once disconnected
+    };
+
+    void compact()
+    {
+        if(m_removed)
+        {
+            std::erase_if(m_entries, [](const entry &e) { return e.id == 0; });
+            std::erase_if(m_added, [](const entry &e) { return e.id == 0; });
+            m_removed = false;
+        }
+        if(!m_added.empty())
+        {
+            m_entries.insert(m_entries.end(), std::make_move_iterator(m_added.begin()), std::make_move_iterator(m_added.end()));
+            m_added.clear();
+        }
+    }
+
+    std::vector<entry> m_entries;
+    std::vector<entry> m_added; // connected during an emission
+    connection m_nextId;
+    uint32_t m_emitting;
+    bool m_removed;
+};
+
+}
+#endif // DELEGATE_LIST_HPP
@@ -58,6 +58,11 @@ public:
         return m_data;
     }
 
+    const T& value() const
+    {
+        return m_data;
+    }
+
     T& operator*()
     {
         return value();
@@ -3,7 +3,12 @@
 
 #include "common/entities/staticmesh.hpp"
 #include "common/modelmanager.hpp"
+#include "common/3d/animationpose.hpp"
+#include "common/3d/morphanimation.hpp"
+#include "common/3d/animationupdatetier.hpp"
 
+class AnimationSystem;
+class Camera3D;
 
 class AnimatedModelComponent : public StaticMesh
 {
@@ -12,9 +17,27 @@ public:
     ~AnimatedModelComponent() override;
 
     void draw(Renderer *rend) override;
+    // advances the playback time, the pose is evaluated by the scene's AnimationSystem after all updates
     void update(double dt) override;
 
+    // samples the animation layers at the last update time into the instance's own pose
+    void evaluatePose();
+
+    // cross-fades when a fade duration is set, switches immediately otherwise
     void setAnimation(std::shared_ptr<AnimationPrimitive> anim);
+    // fades from the current animation to anim over seconds, the old one keeps playing meanwhile
+    void crossFade(std::shared_ptr<AnimationPrimitive> anim, double seconds);
+    void setFadeDuration(double seconds);
+    double fadeDuration() const;
+
+    // looping clip added on top of the current animation, relative to the bind pose (nullptr clears the slot)
+    void setAdditiveLayer(uint32_t slot, std::shared_ptr<AnimationPrimitive> anim, float weight=1.f);
+    void setLayerWeight(uint32_t slot, float weight);
+
+    // plays anim on the morph targets of the model's meshes, independent of the skeletal animation
+    // morphed positions are evaluated when the component is drawn, nullptr restores the base meshes
+    void setMorphAnimation(std::shared_ptr<MorphAnimation> anim, bool looping=true);
+    double morphTime() const;
 
     // trigger animation
     // returns true on success
@@ -26,11 +49,75 @@ public:
 
     const char *getName() const override;
 private:
+    friend class AnimationSystem;
+
+    const ModelNodeTree *nodeTree() const;
+    const ModelSkeleton *skeleton() const;
+    const AnimationPose &pose() const;
+    // picks the update tier and queues the pose on the scene's animation system
+    void submitPose(AnimationSystem &animations, Camera3D &camera, double dt);
+    // reduced tier and blended instances, which can't use the pose cache
+    void evaluateOwnPose();
+    // reduced tier: evaluates at the start of each interval, interpolates the palettes until the next one
+    void advanceReducedPose();
+
+    bool blending() const;
+    void switchAnimation(std::shared_ptr<AnimationPrimitive> anim);
+    // blend input for the update times moved by offset seconds, rebuilt in place
+    void buildLayers(double offset);
+    void evaluateLayers(AnimationPose &pose, double offset);
+    void advanceLayers(double dt);
+    void advanceMorph(double dt);
+    // m_morphPositions at m_morphTime
+    void evaluateMorphs();
+
     double m_time;
+    double m_poseTime; // time the next evaluatePose() samples
     bool m_looping;
     bool m_shouldPlay;
     std::shared_ptr<AnimationPrimitive> m_currentAnimation; // TODO: add animation list
-    std::vector<glm::mat4> m_meshTransforms;
+    std::vector<AnimationCursor> m_cursors; // per channel
+
+    // clip playing alongside the current animation
+    struct PlaybackLayer
+    {
+        std::shared_ptr<AnimationPrimitive> anim;
+        double time = 0.0;
+        double poseTime = 0.0;
+        float weight = 1.f;
+        bool playing = true;
+        bool looping = true;
+        std::vector<AnimationCursor> cursors;
+    };
+    PlaybackLayer m_fadeOut; // previous animation until the fade ends
+    double m_fadeTime;
+    double m_fadePoseTime;
+    double m_fadeLength;
+    double m_fadeDuration; // used by setAnimation
+    std::vector<PlaybackLayer> m_additiveLayers;
+    std::vector<AnimationLayer> m_layers; // scratch of evaluateLayers
+    AnimationPose m_pose;
+    std::shared_ptr<AnimationPose> m_sharedPose; // pose cache entry, replaces m_pose when set
+    AnimationSystem *m_animationSystem; // set while queued for evaluation
+    AnimationUpdateTier m_updateTier;
+
+    std::shared_ptr<MorphAnimation> m_morphAnimation;
+    double m_morphTime;
+    bool m_morphLooping;
+    std::vector<MorphWeight> m_morphWeights; // scratch of evaluateMorphs
+    std::vector<std::vector<glm::vec3>> m_morphPositions; // per mesh slot, empty for meshes the animation doesn't drive
+
+    // reduced rate playback state, to is evaluated offset seconds ahead and reached after interval frames
+    struct ReducedPose
+    {
+        AnimationPose from;
+        AnimationPose to;
+        double offset = 0.0;
+        uint32_t step = 0;
+        uint32_t interval = 1;
+        bool valid = false; // from and to hold poses of the current animation
+    };
+    ReducedPose m_reduced;
 };
 
 #endif
\ No newline at end of file
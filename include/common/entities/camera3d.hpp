@@ -32,6 +32,13 @@ public:
 
     const glm::mat4 &getViewMatrix();
     const glm::mat4 &getProjectionMatrix();
+
+    // fraction of the screen area covered by a bounding sphere (W3D screen size)
+    float screenSize(const glm::vec3 &center, float radius) const;
+    // false when the bounding sphere lies completely outside the view frustum
+    bool sphereInFrustum(const glm::vec3 &center, float radius);
+    // left, right, bottom, top, near, far as (normal, distance) with unit normals pointing inside
+    void frustumPlanes(glm::vec4 planes[6]);
 protected:
     void updateMatrices();
 
@@ -2,6 +2,7 @@
 #define COMPONENT_HPP
 
 #include <memory>
+#include <cstdint>
 
 class Renderer;
 class Entity;
@@ -13,12 +14,24 @@ public:
 
     virtual void draw(Renderer *rend) = 0;
     virtual void update(double dt) = 0;
+    // nullptr once the entity is gone, the entity owns its components and not the other way around
     std::shared_ptr<Entity> getParent() const;
+    // same entity without touching the reference count, nullptr after the entity removed the component or was destroyed
+    Entity *getParentEntity() const;
     virtual bool isDrawable() const = 0;
 
     virtual const char *getName() const;
+    // in one of the component pools of its entity's scene
+    bool isPooled() const;
+
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
 protected:
-    std::shared_ptr<Entity> m_parent;
+    friend class ComponentPoolBase;
+    friend class Entity;
+
+    Entity *m_parent;                  // what updates use, cleared by the entity
+    std::weak_ptr<Entity> m_parentRef;
+    uint32_t m_poolSlot; // index in the scene's pool of this type, NO_SLOT outside a scene
 };
 
 #endif // COMPONENT_HPP
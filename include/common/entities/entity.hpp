@@ -3,27 +3,37 @@
 
 #include "client/renderer.hpp"
 #include "component.hpp"
+#include "entityhandle.hpp"
+#include "common/3d/modelprimitive.hpp"
+#include "common/dirty_flag.hpp"
 #include <functional>
 #include <glm/gtx/quaternion.hpp>
-#include <boost/signals2.hpp>
+#include "common/delegate_list.hpp"
 #include <stduuid/uuid.h>
 
 class Scene3D;
 
 class Entity;
 
-class Entity
+// shared ownership lets components and children refer back through weak pointers
+class Entity : public std::enable_shared_from_this<Entity>
 {
 public:
     Entity();
+    // the id persists across sessions and the network, entities without one get the nil uuid
     Entity(const uuids::uuid& id);
     ~Entity();
 
+    // components are only drawn and updated here while the entity is outside a scene
     virtual void draw(Renderer *rend);
     virtual void update(double dt);
 
     virtual const uuids::uuid& getID() const;
+    bool hasID() const;
+    // slot in the scene's object table, invalid outside a scene
+    EntityHandle getHandle() const;
     virtual void setVisible(bool yes);
+    virtual bool isVisible() const;
 
     virtual void destroy();
 
@@ -36,28 +46,59 @@ public:
     virtual glm::vec3 getEulerRotation() const;
     virtual const glm::quat &getRotation() const;
     virtual const glm::vec3 &getScale() const;
+    // position, rotation and scale are relative to the parent entity if there is one
+    // parent world * translate * rotate * scale, recomposed only after the transform changed
+    // (in a scene by its TransformSystem, which batches the recomposition)
+    const glm::mat4 &getWorldMatrix();
+    glm::vec3 getWorldPosition();
+    // union of the mesh bounds, just the world position without meshes
+    void getWorldBounds(glm::vec3 &min, glm::vec3 &max);
+
+    // nullptr detaches, throws when parent is this entity or one of its children
+    // the transforms follow the parent while both entities are in the same scene
+    virtual void setParent(std::shared_ptr<Entity> parent);
+    virtual std::shared_ptr<Entity> getParent() const;
+    virtual const std::vector<Entity*> &getChildren() const;
 
     virtual void setScene(Scene3D *parent);
     virtual Scene3D *getParentScene() const;
+    // slot in the scene's TransformSystem, TransformSystem::NO_SLOT outside a scene
+    uint32_t getTransformSlot() const;
 
+    // components of entities in a scene live in the scene's component pools, which update and draw them
     virtual void attachComponent(std::shared_ptr<Component> comp);
     virtual void removeComponent(const char *name);
+    const std::vector<std::shared_ptr<Component>> &getComponents() const;
+
+    // tests attached mesh components, see ModelManager::raycast
+    virtual size_t raycast(const std::vector<RaySegment>& rays, std::vector<ModelRayHit>& hits) const;
 
     // events
     virtual void updateSubscribe(const std::function<void(Entity*, double)> &callb);
     virtual void destroySubscribe(const std::function<void(Entity*)> &callb);
 
 protected:
+    friend class Scene3D;
+
+    // links the transform to the parent's when both are in this scene
+    void linkTransform();
+
     uuids::uuid m_id;
+    EntityHandle m_handle;
     bool m_visible;
     glm::vec3 m_position;
     glm::quat m_rotation;
     glm::vec3 m_scale;
+    clean::dirty_flag<glm::mat4> m_worldMatrix; // outside a scene, relative to the parent
+    glm::mat4 m_parentedWorld;                  // outside a scene with a parent
+    uint32_t m_transformSlot;                   // in the scene's TransformSystem
+    std::weak_ptr<Entity> m_parentEntity;
+    std::vector<Entity*> m_children;            // remove themselves when destroyed
     Scene3D *m_parentScene;
-    std::unordered_map<const char*, std::shared_ptr<Component>> m_components;
+    std::vector<std::shared_ptr<Component>> m_components;
 
-    boost::signals2::signal<void(Entity*, double)> m_updateEvents;
-    boost::signals2::signal<void(Entity*)> m_destroyEvents;
+    clean::delegate_list<void(Entity*, double)> m_updateEvents;
+    clean::delegate_list<void(Entity*)> m_destroyEvents;
 };
 
 #endif // ENTITY_HPP
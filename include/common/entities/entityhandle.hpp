@@ -0,0 +1,27 @@
+#ifndef ENTITY_HANDLE_HPP
+#define ENTITY_HANDLE_HPP
+
+#include <cstdint>
+
+// slot of an entity in its scene's object table and the generation of that slot
+// the generation changes whenever the slot is freed, so handles of removed entities stop resolving
+// instead of finding whatever took the slot next
+struct EntityHandle
+{
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    uint32_t index = NO_INDEX;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != NO_INDEX; }
+
+    // both halves in one integer, for scripts and hash keys
+    uint64_t value() const { return (static_cast<uint64_t>(generation) << 32) | index; }
+    static EntityHandle fromValue(uint64_t value) { return EntityHandle{static_cast<uint32_t>(value), static_cast<uint32_t>(value >> 32)}; }
+
+    bool operator==(const EntityHandle& other) const = default;
+};
+
+static_assert(sizeof(EntityHandle) == sizeof(uint64_t), "entity handles are meant to stay 64 bits");
+
+#endif // ENTITY_HANDLE_HPP
@@ -1,7 +1,10 @@
 #ifndef MESHCOMPONENT_HPP
 #define MESHCOMPONENT_HPP
 
+#include <vector>
+
 #include "common/entities/component.hpp"
+#include "common/3d/modelprimitive.hpp"
 
 class MeshComponent : public Component
 {
@@ -24,6 +27,11 @@ public:
     virtual bool isTranslucent() const = 0;
 
     virtual const char *getName() const = 0;
+
+    // see ModelManager::raycast
+    virtual size_t raycast(const std::vector<RaySegment>& rays, std::vector<ModelRayHit>& hits) const = 0;
+    // model bounding sphere in world space as of the last update, false without a model
+    virtual bool worldBoundingSphere(glm::vec3& center, float& radius) const = 0;
 protected:
     bool m_visible;
     bool m_castShadow;
@@ -5,6 +5,7 @@
 #include <string>
 
 #include "common/entities/meshcomponent.hpp"
+#include "common/3d/modelprimitive.hpp"
 
 class StaticMesh : public MeshComponent
 {
@@ -29,13 +30,29 @@ public:
 
     const char *getName() const override;
 
+    size_t raycast(const std::vector<RaySegment>& rays, std::vector<ModelRayHit>& hits) const override;
+    bool worldBoundingSphere(glm::vec3& center, float& radius) const override;
+
     void updateMatrix();
 
+    // currently selected level of detail (W3D HLOD), 0 is the lowest
+    size_t lodLevel() const;
+
     static std::shared_ptr<StaticMesh> createComponent(std::shared_ptr<Entity> parent);
 protected:
+    void updateLOD();
+    // bonePalette is empty for models without a skeleton, meshPositions for models without morphed meshes
+    void queueModel(Renderer *rend, const std::vector<glm::mat4>& meshMatrices, const std::vector<glm::mat4>& bonePalette,
+                    const std::vector<std::vector<glm::vec3>>& meshPositions=std::vector<std::vector<glm::vec3>>{});
+    const std::vector<glm::mat4>& bindPalette() const;
+
     std::string m_name;
     glm::mat4 m_modelMatrix;
+    glm::vec3 m_worldCenter; // model bounding sphere, follows m_modelMatrix
+    float m_worldRadius;
     uint32_t m_meshId;
+    std::shared_ptr<ModelPrimitive> m_model;
+    size_t m_lodLevel;
     bool m_visible;
     bool m_castShadow;
     bool m_translucent;
@@ -0,0 +1,116 @@
+#ifndef EVENT_BUS_HPP
+#define EVENT_BUS_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <typeindex>
+#include <unordered_map>
+#include <functional>
+
+#include "common/delegate_list.hpp"
+
+namespace clean
+{
+
+// queued events between systems, any copyable type E is an event
+// publish may be called from any thread, the handlers run on the thread calling dispatch(), at the point its owner chose
+// events are delivered per type in the order the types were first used, and in publish order within a type
+class EventBus
+{
+public:
+    using connection = uint32_t;
+
+    template<typename E>
+    connection subscribe(const std::function<void(const E&)> &handler)
+    {
+        return channel<E>().handlers.connect(handler);
+    }
+
+    template<typename E>
+    void unsubscribe(connection id)
+    {
+        channel<E>().handlers.disconnect(id);
+    }
+
+    template<typename E>
+    void publish(E event)
+    {
+        Channel<E> &events = channel<E>();
+        std::lock_guard<std::mutex> lock(events.mutex);
+        events.queue.push_back(std::move(event));
+    }
+
+    // delivers everything published so far, events that handlers publish wait for the next dispatch
+    void dispatch()
+    {
+        size_t count = channelCount();
+        for(size_t i = 0; i < count; i++)
+            channelAt(i)->take();
+        for(size_t i = 0; i < count; i++)
+            channelAt(i)->deliver();
+    }
+
+private:
+    struct ChannelBase
+    {
+        virtual ~ChannelBase() = default;
+        virtual void take() = 0;
+        virtual void deliver() = 0;
+    };
+
+    template<typename E>
+    struct Channel : public ChannelBase
+    {
+        std::mutex mutex; // queue
+        std::vector<E> queue;
+        std::vector<E> taken; // reused between dispatches
+        delegate_list<void(const E&)> handlers;
+
+        void take() override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            taken.swap(queue);
+        }
+
+        void deliver() override
+        {
+            for(const E &event : taken)
+                handlers(event);
+            taken.clear();
+        }
+    };
+
+    size_t channelCount()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_order.size();
+    }
+
+    // handlers may subscribe to new types, which grows the list
+    ChannelBase *channelAt(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_order[index];
+    }
+
+    template<typename E>
+    Channel<E> &channel()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto &events = m_channels[std::type_index(typeid(E))];
+        if(events == nullptr)
+        {
+            events = std::make_unique<Channel<E>>();
+            m_order.push_back(events.get());
+        }
+        return static_cast<Channel<E>&>(*events);
+    }
+
+    std::mutex m_mutex; // channel table
+    std::unordered_map<std::type_index, std::unique_ptr<ChannelBase>> m_channels;
+    std::vector<ChannelBase*> m_order;
+};
+
+}
+#endif // EVENT_BUS_HPP
@@ -0,0 +1,50 @@
+#ifndef MODEL_IMPORTER_HPP
+#define MODEL_IMPORTER_HPP
+
+#include <unordered_map>
+#include <string>
+#include <memory>
+
+#include <assimp/IOSystem.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/matrix4x4.h>
+
+#include "common/3d/modelprimitive.hpp"
+
+struct aiScene;
+struct aiMesh;
+class W3DImporter;
+class W3DHLOD;
+class W3DHierarchy;
+class W3DFile;
+
+// converts assimp supported files into ModelPrimitives, not thread safe (use one per thread)
+class ModelImporter
+{
+public:
+    ModelImporter(Assimp::IOSystem *ioSystem=nullptr); // takes ownership of ioSystem
+    ~ModelImporter();
+
+    std::shared_ptr<ModelPrimitive> importFile(const std::string& path, const std::string& name);
+    std::shared_ptr<ModelPrimitive> importMemory(const std::vector<char>& data, const std::string& name, const std::string& hint);
+
+    // animations of later imports are compressed (see AnimationPrimitive::compress), off by default
+    void setAnimationCompression(bool enabled, const AnimationCompressionSettings& settings=AnimationCompressionSettings{});
+private:
+    std::shared_ptr<ModelPrimitive> convert(const aiScene* scene, const std::string& name);
+    void build_bvhs(std::shared_ptr<ModelPrimitive> model, const std::vector<std::vector<glm::vec3>>& bindPositions);
+    std::shared_ptr<ModelSkeleton> import_skeleton(const W3DHierarchy& hierarchy);
+    void import_influences(const aiMesh* mesh, const ModelSkeleton* skeleton, std::shared_ptr<MeshPrimitive> meshPrimitive);
+    // anim meshes -> sparse quantized morph targets
+    void import_morphs(const aiMesh* mesh, const aiMatrix4x4& transform, std::shared_ptr<MeshPrimitive> meshPrimitive);
+    void import_lods(const W3DHLOD& hlod, const std::unordered_map<std::string, uint32_t>& meshSlots, std::shared_ptr<ModelPrimitive> model);
+    // W3D morph anims -> MorphAnimation tracks over the morph targets of the meshes their channels control
+    void import_morph_animations(const W3DFile& w3dfile, std::shared_ptr<ModelPrimitive> model);
+
+    Assimp::Importer m_importer;
+    W3DImporter *m_w3dImporter; // owned by m_importer
+    bool m_compressAnimations;
+    AnimationCompressionSettings m_animationCompression;
+};
+
+#endif // MODEL_IMPORTER_HPP
@@ -22,10 +22,21 @@ public:
     void addAnimation(const W3DAnimation& animation);
     size_t animationCount() const;
     const W3DAnimation& animation(size_t index) const;
+
+    void addMorphAnimation(const W3DMorphAnimation& animation);
+    size_t morphAnimationCount() const;
+    const W3DMorphAnimation& morphAnimation(size_t index) const;
+
+    void setHLOD(const W3DHLOD& hlod);
+    bool hasHLOD() const;
+    const W3DHLOD& getHLOD() const;
 private:
     W3DHierarchy m_hierarchy;
     std::vector<W3DMesh> m_meshes;
     std::vector<W3DAnimation> m_animations;
+    std::vector<W3DMorphAnimation> m_morphAnimations;
+    W3DHLOD m_hlod;
+    bool m_hasHLOD = false;
 };
 
 class W3DLoader
@@ -367,6 +367,12 @@ private:
 //
 class W3DAABTreeHeader
 {
+public:
+	W3DAABTreeHeader() = default;
+	W3DAABTreeHeader(Assimp::IOStream *stream);
+
+	uint32_t nodeCount() const;
+	uint32_t polyCount() const;
 private:
 	uint32_t m_nodeCount;
 	uint32_t m_polyCount;
@@ -381,6 +387,17 @@ private:
 //
 class W3DAABTreeNode
 {
+public:
+	W3DAABTreeNode() = default;
+	W3DAABTreeNode(Assimp::IOStream *stream);
+
+	const W3DVector& min() const;
+	const W3DVector& max() const;
+	bool isLeaf() const;
+	uint32_t front() const;
+	uint32_t back() const;
+	uint32_t poly0() const;
+	uint32_t polyCount() const;
 private:
 	W3DVector m_min;
 	W3DVector m_max;
@@ -569,10 +586,20 @@ private:
 
 class W3DMorphAnimHeader
 {
+public:
+	W3DMorphAnimHeader() = default;
+	W3DMorphAnimHeader(Assimp::IOStream *stream);
+
+	uint32_t version() const;
+	const std::string& name() const;
+	const std::string& hierarchyName() const;
+	uint32_t frameCount() const;
+	float frameRate() const;
+	uint32_t channelCount() const;
 private:
 	uint32_t m_version;
-	char m_name[W3D_NAME_LEN];
-	char m_hierarchyName[W3D_NAME_LEN];
+	std::string m_name;
+	std::string m_hierarchyName;
 	uint32_t m_frameCount;
 	float m_frameRate;
 	uint32_t m_channelCount;
@@ -580,6 +607,12 @@ private:
 
 class W3DMorphAnimKey
 {
+public:
+	W3DMorphAnimKey() = default;
+	W3DMorphAnimKey(Assimp::IOStream *stream);
+
+	uint32_t morphFrame() const;
+	uint32_t poseFrame() const;
 private:
 	uint32_t m_morphFrame;
 	uint32_t m_poseFrame;
@@ -903,15 +936,29 @@ private:
 ********************************************************************************/
 class W3DHLODHeader
 {
+public:
+	W3DHLODHeader() = default;
+	W3DHLODHeader(Assimp::IOStream *stream);
+
+	uint32_t version() const;
+	uint32_t lodCount() const;
+	const std::string& name() const;
+	const std::string& hierarchyName() const;
 private:
 	uint32_t m_version;
 	uint32_t m_lodCount;
-	char m_name[W3D_NAME_LEN];
-	char m_hierarchyName[W3D_NAME_LEN];
+	std::string m_name;
+	std::string m_hierarchyName;
 };
 
 class W3DHLODArrayHeader
 {
+public:
+	W3DHLODArrayHeader() = default;
+	W3DHLODArrayHeader(Assimp::IOStream *stream);
+
+	uint32_t modelCount() const;
+	float maxScreenSize() const;
 private:
 	uint32_t m_modelCount;
 	float m_maxScreenSize;
@@ -919,9 +966,15 @@ private:
 
 class W3DHLODSubObject
 {
+public:
+	W3DHLODSubObject() = default;
+	W3DHLODSubObject(Assimp::IOStream *stream);
+
+	uint32_t boneIndex() const;
+	const std::string& name() const; // "CONTAINER.MESH"
 private:
 	uint32_t m_boneIndex;
-	char m_name[W3D_NAME_LEN];
+	std::string m_name; // W3D_NAME_LEN*2 on disk
 };
 
 /********************************************************************************
@@ -1121,6 +1174,54 @@ private:
 	std::vector<W3DTextureStage> m_textureStages;
 };
 
+class W3DAABTree
+{
+public:
+	W3DAABTree() = default;
+
+	void setHeader(const W3DAABTreeHeader &header);
+	const W3DAABTreeHeader& header() const;
+
+	void addPolyIndex(uint32_t polyIndex);
+	const std::vector<uint32_t>& polyIndices() const;
+
+	void addNode(const W3DAABTreeNode &node);
+	const std::vector<W3DAABTreeNode>& nodes() const;
+private:
+	W3DAABTreeHeader m_header;
+	std::vector<uint32_t> m_polyIndices;
+	std::vector<W3DAABTreeNode> m_nodes;
+};
+
+class W3DDeformKeyframe
+{
+public:
+	W3DDeformKeyframe() = default;
+	void setInfo(const W3DDeformKeyframeInfo &info);
+	const W3DDeformKeyframeInfo& info() const;
+
+	void addData(const W3DDeformData &data);
+	const std::vector<W3DDeformData>& data() const;
+private:
+	W3DDeformKeyframeInfo m_info;
+	std::vector<W3DDeformData> m_data;
+};
+
+class W3DDeformSet
+{
+public:
+	W3DDeformSet() = default;
+	void setInfo(const W3DDeformSetInfo &info);
+	const W3DDeformSetInfo& info() const;
+
+	void addKeyframe(const W3DDeformKeyframe &keyframe);
+	size_t keyframeCount() const;
+	const W3DDeformKeyframe& keyframe(uint32_t index) const;
+private:
+	W3DDeformSetInfo m_info;
+	std::vector<W3DDeformKeyframe> m_keyframes;
+};
+
 class W3DMesh
 {
 public:
@@ -1136,6 +1237,7 @@ public:
 	const W3DVector& normal(uint32_t index) const;
 
 	void addInfluence(const W3DVertexInfo &influence);
+	size_t influenceCount() const;
 	const W3DVertexInfo& influence(uint32_t index) const;
 
 	void addTriangle(const W3DTriangle &triangle);
@@ -1158,6 +1260,14 @@ public:
 
 	void addMaterialPass(const W3DMaterialPass &materialPass);
 	const W3DMaterialPass& materialPass(uint32_t index) const;
+
+	void setAABTree(const W3DAABTree &aabTree);
+	bool hasAABTree() const;
+	const W3DAABTree& aabTree() const;
+
+	void addDeformSet(const W3DDeformSet &deformSet);
+	size_t deformSetCount() const;
+	const W3DDeformSet& deformSet(uint32_t index) const;
 private:
 	W3DMeshHeader3 m_header;
 	std::vector<W3DVector> m_vertices;
@@ -1170,6 +1280,9 @@ private:
 	std::vector<W3DShader> m_shaders;
 	std::vector<W3DTexture> m_textures;
 	std::vector<W3DMaterialPass> m_materialPasses;
+	W3DAABTree m_aabTree;
+	bool m_hasAABTree = false;
+	std::vector<W3DDeformSet> m_deformSets;
 };
 
 class W3DHierarchy
@@ -1180,6 +1293,7 @@ public:
 	const W3DHierarchyHeader& header() const;
 
 	void addPivot(const W3DPivot &pivot);
+	size_t pivotCount() const;
 	const W3DPivot& pivot(uint32_t index) const;
 private:
 	W3DHierarchyHeader m_header;
@@ -1210,8 +1324,49 @@ private:
 	std::vector<W3DBitChannel> m_bitChannels;
 };
 
+class W3DMorphAnimChannel
+{
+public:
+	W3DMorphAnimChannel() = default;
+	void setPoseName(const std::string &poseName);
+	const std::string& poseName() const;
+
+	void addKey(const W3DMorphAnimKey &key);
+	const std::vector<W3DMorphAnimKey>& keys() const;
+private:
+	std::string m_poseName;			// anim holding the poses
+	std::vector<W3DMorphAnimKey> m_keys;
+};
+
+class W3DMorphAnimation
+{
+public:
+	W3DMorphAnimation() = default;
+	void setHeader(const W3DMorphAnimHeader &header);
+	const W3DMorphAnimHeader& header() const;
+
+	void addChannel(const W3DMorphAnimChannel &channel);
+	size_t channelCount() const;
+	const W3DMorphAnimChannel& channel(uint32_t index) const;
+
+	void addPivotChannel(uint32_t channel);
+	const std::vector<uint32_t>& pivotChannels() const;
+private:
+	W3DMorphAnimHeader m_header;
+	std::vector<W3DMorphAnimChannel> m_channels;
+	std::vector<uint32_t> m_pivotChannels;	// channel controlling each pivot of the hierarchy
+};
+
 class W3DLODArray
 {
+public:
+	W3DLODArray() = default;
+	void setHeader(const W3DHLODArrayHeader &header);
+	const W3DHLODArrayHeader& header() const;
+
+	void addSubObject(const W3DHLODSubObject &subObject);
+	size_t subObjectCount() const;
+	const W3DHLODSubObject& subObject(uint32_t index) const;
 private:
 	W3DHLODArrayHeader m_header;
 	std::vector<W3DHLODSubObject> m_subObjects;
@@ -1219,6 +1374,14 @@ private:
 
 class W3DHLOD
 {
+public:
+	W3DHLOD() = default;
+	void setHeader(const W3DHLODHeader &header);
+	const W3DHLODHeader& header() const;
+
+	void addLODArray(const W3DLODArray &lodArray);
+	size_t lodArrayCount() const;
+	const W3DLODArray& lodArray(uint32_t index) const;
 private:
 	W3DHLODHeader m_header;
 	std::vector<W3DLODArray> m_lodArrays;
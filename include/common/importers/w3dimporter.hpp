@@ -4,6 +4,12 @@
 #include <assimp/BaseImporter.h>
 #include <assimp/IOSystem.hpp>
 #include <assimp/IOStream.hpp>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "common/importers/w3d/loader.hpp"
+
+struct aiMesh;
 
 class W3DImporter : public Assimp::BaseImporter
 {
@@ -15,6 +21,21 @@ public:
     void SetupProperties(const Assimp::Importer *pImp) override;
     const aiImporterDesc *GetInfo() const override;
     void InternReadFile(const std::string &pFile, aiScene *pScene, Assimp::IOSystem *pIOHandler) override;
+
+    // raw data of the last read file, for chunks without an aiScene counterpart (HLOD, ...)
+    bool hasLastFile() const;
+    const W3DFile& lastFile() const;
+    void resetLastFile();
+private:
+    // loads the pivots from the HLOD's hierarchy file when the model doesn't contain them
+    static void resolveHierarchy(W3DFile& w3dfile, const std::string& pFile, Assimp::IOSystem* pIOHandler);
+    // vertex influences -> aiBones named after the hierarchy pivots
+    static void importSkinBones(const W3DHierarchy& hierarchy, const W3DMesh& w3dmesh, aiMesh* mesh);
+    // deform (damage) keyframes -> aiAnimMeshes, so they follow the vertex joining post-process
+    static void importDeformSets(const W3DMesh& w3dmesh, aiMesh* mesh, const std::function<glm::vec3(glm::vec3)>& pivotTransform);
+
+    W3DFile m_lastFile;
+    bool m_hasLastFile = false;
 };
 
 #endif
\ No newline at end of file
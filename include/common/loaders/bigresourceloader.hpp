@@ -46,6 +46,9 @@ public:
     std::shared_ptr<DataResource> get(const std::string& path, bool caching=false) const override;
 
     const char* getType() const override;
+
+    static std::vector<BigFileEntry> listEntries(const std::string& bigFile);
+    static std::shared_ptr<DataResource> readEntry(const std::string& bigFile, const BigFileEntry& entry);
 private:
     std::vector<std::string> m_bigFiles;
 };
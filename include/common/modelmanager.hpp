@@ -6,13 +6,12 @@
 
 #include <assimp/IOSystem.hpp>
 #include <assimp/IOStream.hpp>
-#include <assimp/Importer.hpp>
 
 #include "common/loaders/basicresourceloader.hpp"
+#include "common/importers/modelimporter.hpp"
 
 #include "common/3d/modelprimitive.hpp"
 
-
 class ResourcesIOStream : public Assimp::IOStream
 {
 public:
@@ -52,13 +51,30 @@ public:
     void import_model(const std::string& path, const std::string& name, bool allocateGraphics=true);
 
     size_t getModelId(const std::string& path) const;
+    std::shared_ptr<ModelPrimitive> getModel(size_t modelId) const;
+
+    // world space segments against a placed model, hits[i] is replaced when a closer hit is found
+    // (initialize hits[i].t with rays[i].maxT), returns number of updated hits
+    size_t raycast(size_t modelId, const glm::mat4& modelMatrix, const std::vector<RaySegment>& rays, std::vector<ModelRayHit>& hits) const;
     std::shared_ptr<AnimationPrimitive> getAnimation(const std::string& modelName, const std::string& animationName) const;
+    std::shared_ptr<MorphAnimation> getMorphAnimation(const std::string& modelName, const std::string& animationName) const;
+
+    // animations of models imported afterwards are compressed, see ModelImporter::setAnimationCompression
+    void setAnimationCompression(bool enabled, const AnimationCompressionSettings& settings=AnimationCompressionSettings{});
+    // animations of models imported afterwards are baked at rate frames per second, 0 keeps them keyframed
+    void setAnimationBakeRate(double rate);
+    double animationBakeRate() const;
 private:
+    // model cooked by cleanengine-cook-w3d, nullptr if there is none
+    std::shared_ptr<ModelPrimitive> load_cooked(const std::string& path) const;
     void allocate_graphics(const std::string& name, std::shared_ptr<ModelPrimitive> model);
+    void bake_animations(const std::string& name, std::shared_ptr<ModelPrimitive> model) const;
 
-    Assimp::Importer m_importer;
+    ModelImporter m_importer;
     std::unordered_map<std::string, std::shared_ptr<ModelPrimitive>> m_models;
     std::unordered_map<std::string, size_t> m_modelIDs;  // imported model ids
+    std::unordered_map<size_t, std::shared_ptr<ModelPrimitive>> m_modelsById;
+    double m_animationBakeRate;
 };
 
 #endif // MODELMANAGER_HPP
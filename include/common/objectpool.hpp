@@ -0,0 +1,117 @@
+#ifndef OBJECT_POOL_HPP
+#define OBJECT_POOL_HPP
+
+#include <memory>
+#include <new>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <typeinfo>
+#include <cstddef>
+#include <cstdint>
+
+namespace clean
+{
+
+struct PoolStats
+{
+    std::string name;  // type the pool was made for
+    size_t slotSize;   // bytes, with the shared_ptr control block for pooled shared objects
+    size_t live;       // slots in use
+    size_t highWater;  // most slots in use at once
+    size_t capacity;   // slots allocated from the system, never given back
+    size_t allocations; // since startup
+};
+
+// fixed size slots carved out of blocks, freed slots go on a free list and are handed out again first
+// allocation only reaches the system when every block is full, blocks grow with the pool up to a limit
+class ObjectPool
+{
+public:
+    ObjectPool(const std::type_info& type, size_t slotSize, size_t alignment);
+    ~ObjectPool();
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    void* allocate();
+    void deallocate(void* slot);
+
+    PoolStats stats() const;
+    // every pool made so far, in creation order
+    static std::vector<PoolStats> allStats();
+
+private:
+    void addBlock(size_t slots);
+
+    struct FreeSlot
+    {
+        FreeSlot* next;
+    };
+
+    mutable std::mutex m_mutex;
+    std::string m_name;
+    size_t m_slotSize;
+    size_t m_alignment;
+    std::vector<void*> m_blocks;
+    FreeSlot* m_freeSlots;
+    size_t m_live;
+    size_t m_highWater;
+    size_t m_capacity;
+    size_t m_allocations;
+};
+
+// allocator for std::allocate_shared, which rebinds it to its control block type, so the object and its
+// reference counts share one slot; Tag names the pool, every rebound type gets its own pool per tag
+template<typename T, typename Tag = T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind
+    {
+        using other = PoolAllocator<U, Tag>;
+    };
+
+    PoolAllocator() noexcept = default;
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U, Tag>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        if (n != 1)
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        return static_cast<T*>(pool().allocate());
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        if (n != 1)
+            ::operator delete(ptr, std::align_val_t(alignof(T)));
+        else
+            pool().deallocate(ptr);
+    }
+
+    // never destroyed, objects may still be released during static destruction
+    static ObjectPool& pool()
+    {
+        static ObjectPool* instance = new ObjectPool(typeid(Tag), sizeof(T), alignof(T));
+        return *instance;
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U, Tag>&) const noexcept { return true; }
+};
+
+// std::make_shared with the object and its control block in a slot of T's pool
+template<typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args&&... args)
+{
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+} // namespace clean
+
+#endif // OBJECT_POOL_HPP
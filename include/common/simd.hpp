@@ -0,0 +1,36 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// SSE versions of the hot per-element loops, plain loops on other targets
+// destinations may alias their first source
+namespace clean::simd
+{
+
+// dst[i] = from[i] + (to[i] - from[i]) * t
+void lerp(float *dst, const float *from, const float *to, float t, size_t count);
+
+// dst[i] += (value[i] - reference[i]) * weight
+void addScaledDifference(float *dst, const float *value, const float *reference, float weight, size_t count);
+
+// normalized lerp of count quaternions (4 floats each) along the shorter arc
+void nlerpQuats(float *dst, const float *from, const float *to, float t, size_t count);
+
+// matrices[i] = translate(positions[i]) * rotate(rotations[i]) * scale(scales[i]) for every i in indices
+// positions and scales hold 3 floats per element, rotations unit quaternions as x, y, z, w,
+// matrices 16 floats in column-major order; four elements are composed per step
+void composeTransforms(const uint32_t *indices, size_t count, const float *positions, const float *rotations, const float *scales, float *matrices);
+
+// visible[i] = 1 when sphere i (x, y, z, radius in separate arrays) is not completely behind one of the
+// planes (a, b, c, d each with a unit normal pointing inside), else 0; four spheres are tested per step
+void spheresInPlanes(const float *planes, size_t planeCount, const float *x, const float *y, const float *z, const float *radius,
+                     size_t count, uint8_t *visible);
+// the left, right, bottom, top, near and far planes of a column-major view-projection matrix with [0, 1] clip depth
+// (GLM_FORCE_DEPTH_ZERO_TO_ONE), as a, b, c, d each with a unit normal pointing inside, 24 floats in planes
+void frustumPlanes(const float *viewProj, float *planes);
+
+}
+
+#endif // SIMD_HPP
@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <cstdint>
+
+// persistent worker threads for data-parallel loops, the calling thread takes part in every loop
+// every thread starts on its own contiguous share of the chunks and steals half of another
+// thread's remaining share when it runs out, so uneven chunks still keep all threads busy
+class ThreadPool
+{
+public:
+    // 0 workers = hardware concurrency - 1
+    explicit ThreadPool(unsigned workerCount=0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // workers + the calling thread
+    unsigned threadCount() const;
+
+    // calls fn(begin, end) for chunks of at most grain items covering [0; count), returns when all chunks are done
+    // the first exception thrown by fn is rethrown here; calls from inside fn run serially
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    // chunks moved to another thread by steals, since the pool was created
+    uint64_t stolenChunks() const;
+
+    // shared by the engine systems
+    static ThreadPool& global();
+private:
+    // chunk indices [begin; end) packed into one word, so owner and thieves agree through a single CAS
+    struct alignas(64) WorkRange
+    {
+        std::atomic<uint64_t> chunks;
+    };
+
+    void workerLoop(unsigned index);
+    void runChunks(unsigned index);
+    bool popChunk(unsigned index, uint32_t& chunk);
+    bool stealChunk(unsigned index, uint32_t& chunk);
+
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<WorkRange[]> m_ranges; // per thread, the calling thread is 0
+    std::mutex m_loopMutex; // one loop at a time
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const std::function<void(size_t, size_t)>* m_task;
+    size_t m_count;
+    size_t m_grain;
+    uint64_t m_generation;
+    unsigned m_busy;
+    bool m_stop;
+    std::exception_ptr m_error;
+    std::atomic<uint64_t> m_stolen;
+};
+
+#endif // THREAD_POOL_HPP
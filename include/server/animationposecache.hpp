@@ -0,0 +1,65 @@
+#ifndef ANIMATION_POSE_CACHE_HPP
+#define ANIMATION_POSE_CACHE_HPP
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "common/3d/animationpose.hpp"
+
+struct PoseCacheStats
+{
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    uint64_t poses = 0; // distinct poses evaluated
+
+    double hitRate() const;
+};
+
+// shares the poses of instances playing the same animation at nearly the same time within one frame
+// time is quantized to the tolerance, a tolerance of 0 disables the cache
+class AnimationPoseCache
+{
+public:
+    AnimationPoseCache();
+
+    void setTolerance(double seconds);
+    double tolerance() const;
+    bool enabled() const;
+
+    // pose for (anim, nodes, skeleton, timecode) this frame, evaluate is set for the first lookup of a key
+    // the caller then has to fill the pose at quantizedTime before anyone reads it
+    std::shared_ptr<AnimationPose> acquire(const AnimationPrimitive* anim, const ModelNodeTree* nodes, const ModelSkeleton* skeleton, double timecode,
+                                           double& quantizedTime, bool& evaluate);
+    // forgets this frame's keys, poses nobody references any more are reused by later frames
+    void endFrame();
+
+    const PoseCacheStats& frameStats() const; // last finished frame
+    const PoseCacheStats& totalStats() const;
+    void resetStats();
+private:
+    struct Key
+    {
+        const AnimationPrimitive* anim;
+        const ModelNodeTree* nodes;
+        const ModelSkeleton* skeleton;
+        int64_t step;
+
+        bool operator==(const Key& other) const = default;
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    double m_tolerance;
+    std::unordered_map<Key, std::shared_ptr<AnimationPose>, KeyHash> m_frame;
+    std::vector<std::shared_ptr<AnimationPose>> m_pool; // poses of earlier frames still held by instances
+    std::vector<std::shared_ptr<AnimationPose>> m_free; // sorted out of m_pool by endFrame(), acquire() takes from here
+    PoseCacheStats m_current;
+    PoseCacheStats m_last;
+    PoseCacheStats m_total;
+};
+
+#endif // ANIMATION_POSE_CACHE_HPP
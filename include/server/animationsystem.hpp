@@ -0,0 +1,86 @@
+#ifndef ANIMATION_SYSTEM_HPP
+#define ANIMATION_SYSTEM_HPP
+
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "common/threadpool.hpp"
+#include "server/animationposecache.hpp"
+#include "common/3d/animationupdatetier.hpp"
+
+class AnimatedModelComponent;
+class Camera3D;
+
+// screen sizes are the fraction of the screen covered by the bounding sphere, like the W3D LOD switch sizes
+struct AnimationLODSettings
+{
+    bool enabled = false;
+    float reducedScreenSize = 0.01f; // smaller instances are updated at the reduced rate
+    float pausedScreenSize = 0.f;    // smaller instances are paused, culled and hidden ones always are
+    uint32_t reducedInterval = 4;    // frames between two evaluations of a reduced instance
+};
+
+struct AnimationLODStats
+{
+    size_t full = 0;
+    size_t reduced = 0;
+    size_t paused = 0;
+};
+
+// collects the animated instances advanced during Scene3D::update and evaluates their poses in parallel batches
+class AnimationSystem
+{
+public:
+    explicit AnimationSystem(ThreadPool& pool=ThreadPool::global());
+    ~AnimationSystem();
+
+    // update tier of an instance with the given world bounding sphere, always Full while the LOD is disabled
+    // the camera matrices have to be up to date when called from several threads
+    AnimationUpdateTier selectTier(Camera3D& camera, const glm::vec3& center, float radius, bool visible) const;
+    // queues the instance for the next evaluate() at its update tier, called from the update threads
+    // paused instances are only counted
+    void submit(AnimatedModelComponent* instance, AnimationUpdateTier tier=AnimationUpdateTier::Full);
+    // drops a queued instance (component destroyed before evaluation)
+    void cancel(AnimatedModelComponent* instance);
+    // evaluates all queued poses into the instances' pose buffers and clears the queue
+    void evaluate();
+
+    // instances per worker chunk
+    void setBatchSize(size_t size);
+    size_t batchSize() const;
+
+    void setLODSettings(const AnimationLODSettings& settings);
+    const AnimationLODSettings& lodSettings() const;
+    const AnimationLODStats& lastLODStats() const; // instances per tier in the last evaluated frame
+
+    // disabled until a tolerance is set
+    AnimationPoseCache& poseCache();
+
+    size_t lastInstanceCount() const;
+    double lastEvaluateTime() const; // seconds
+private:
+    struct PoseJob
+    {
+        AnimatedModelComponent* instance;
+        AnimationPose* pose;
+        double time;
+        bool custom; // the instance evaluates itself (reduced tier or blended layers)
+    };
+
+    ThreadPool& m_pool;
+    std::mutex m_pendingMutex; // submit and cancel
+    std::vector<AnimatedModelComponent*> m_pending;
+    std::vector<PoseJob> m_jobs;
+    AnimationPoseCache m_poseCache;
+    AnimationLODSettings m_lodSettings;
+    AnimationLODStats m_lodStats;
+    AnimationLODStats m_lastLODStats;
+    size_t m_batchSize;
+    size_t m_lastInstanceCount;
+    double m_lastEvaluateTime;
+};
+
+#endif // ANIMATION_SYSTEM_HPP
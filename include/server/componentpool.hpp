@@ -0,0 +1,214 @@
+#ifndef COMPONENT_POOL_HPP
+#define COMPONENT_POOL_HPP
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "common/entities/component.hpp"
+#include "common/entities/entity.hpp"
+#include "common/entities/meshcomponent.hpp"
+#include "common/simd.hpp"
+#include "common/threadpool.hpp"
+
+enum class ComponentUpdate
+{
+    Serial,  // on the main thread, may touch other entities, the scene or scripts
+    Parallel // in chunks on worker threads, only touches its own component and reads its entity
+};
+
+struct CullingStats
+{
+    size_t visible = 0; // meshes queued for rendering
+    size_t culled = 0;  // meshes outside the view frustum
+};
+
+// state of one Scene3D::draw, shared by all pools
+struct DrawCulling
+{
+    bool enabled = false;
+    float planes[24] = {}; // see Camera3D::frustumPlanes
+    CullingStats stats;
+};
+
+// components of one concrete type packed into a dense array, systems walk it linearly
+// every component remembers its slot, so removal swaps the last one in without a search
+class ComponentPoolBase
+{
+public:
+    virtual ~ComponentPoolBase() = default;
+
+    virtual void insert(Component *comp) = 0;
+    virtual void erase(Component *comp) = 0;
+    virtual void clear() = 0;
+    virtual size_t size() const = 0;
+
+    virtual void update(double dt) = 0;
+    // components split into chunks of grain on the pool, they must not add or remove components
+    virtual void update(double dt, ThreadPool &pool, size_t grain) = 0;
+    // drawable components of visible entities, meshes are culled against the frustum first
+    virtual void draw(Renderer *rend, DrawCulling &culling) = 0;
+protected:
+    static uint32_t &slot(Component *comp) { return comp->m_poolSlot; }
+    static Entity *parent(Component *comp) { return comp->m_parent; }
+};
+
+// T is the exact dynamic type of the stored components, which lets update and draw skip the virtual dispatch
+// Component itself is the fallback pool of types the scene doesn't know
+template<typename T>
+class ComponentPool : public ComponentPoolBase
+{
+public:
+    void insert(Component *comp) override
+    {
+        slot(comp) = static_cast<uint32_t>(m_components.size());
+        m_components.push_back(static_cast<T*>(comp));
+    }
+
+    void erase(Component *comp) override
+    {
+        uint32_t index = slot(comp);
+        if(index >= m_components.size() || m_components[index] != comp)
+            return;
+
+        m_components[index] = m_components.back();
+        slot(m_components[index]) = index;
+        m_components.pop_back();
+        slot(comp) = Component::NO_SLOT;
+    }
+
+    void clear() override
+    {
+        for(auto comp : m_components)
+            slot(comp) = Component::NO_SLOT;
+        m_components.clear();
+    }
+
+    size_t size() const override
+    {
+        return m_components.size();
+    }
+
+    void update(double dt) override
+    {
+        // by index, an update may remove components of this pool
+        for(size_t i = 0; i < m_components.size(); i++)
+            updateComponent(m_components[i], dt);
+    }
+
+    void update(double dt, ThreadPool &pool, size_t grain) override
+    {
+        pool.parallelFor(m_components.size(), grain, [this, dt](size_t begin, size_t end) {
+            for(size_t i = begin; i < end; i++)
+                updateComponent(m_components[i], dt);
+        });
+    }
+
+    void draw(Renderer *rend, DrawCulling &culling) override
+    {
+        if constexpr(std::is_base_of_v<MeshComponent, T>)
+        {
+            if(culling.enabled)
+            {
+                drawCulled(rend, culling);
+                return;
+            }
+        }
+
+        for(size_t i = 0; i < m_components.size(); i++)
+        {
+            T *comp = m_components[i];
+            if(!parent(comp)->isVisible() || !drawable(comp))
+                continue;
+            drawComponent(comp, rend);
+            if constexpr(std::is_base_of_v<MeshComponent, T>)
+                culling.stats.visible++;
+        }
+    }
+
+    const std::vector<T*> &components() const
+    {
+        return m_components;
+    }
+private:
+    static void updateComponent(T *comp, double dt)
+    {
+        if constexpr(std::is_abstract_v<T>)
+            comp->update(dt);
+        else
+            comp->T::update(dt);
+    }
+
+    static bool drawable(T *comp)
+    {
+        if constexpr(std::is_abstract_v<T>)
+            return comp->isDrawable();
+        else
+            return comp->T::isDrawable();
+    }
+
+    static void drawComponent(T *comp, Renderer *rend)
+    {
+        if constexpr(std::is_abstract_v<T>)
+            comp->draw(rend);
+        else
+            comp->T::draw(rend);
+    }
+
+    // bounding spheres of the drawable meshes gathered into columns, tested four at a time
+    // meshes without a model yet can't be culled
+    void drawCulled(Renderer *rend, DrawCulling &culling)
+    {
+        m_drawList.clear();
+        m_cullX.clear();
+        m_cullY.clear();
+        m_cullZ.clear();
+        m_cullRadius.clear();
+        for(size_t i = 0; i < m_components.size(); i++)
+        {
+            T *comp = m_components[i];
+            if(!parent(comp)->isVisible() || !drawable(comp))
+                continue;
+
+            glm::vec3 center(0.f);
+            float radius;
+            bool bounded;
+            if constexpr(std::is_abstract_v<T>)
+                bounded = comp->worldBoundingSphere(center, radius);
+            else
+                bounded = comp->T::worldBoundingSphere(center, radius);
+            if(!bounded)
+                radius = std::numeric_limits<float>::infinity();
+
+            m_drawList.push_back(comp);
+            m_cullX.push_back(center.x);
+            m_cullY.push_back(center.y);
+            m_cullZ.push_back(center.z);
+            m_cullRadius.push_back(radius);
+        }
+
+        m_cullVisible.resize(m_drawList.size());
+        clean::simd::spheresInPlanes(culling.planes, 6, m_cullX.data(), m_cullY.data(), m_cullZ.data(), m_cullRadius.data(),
+                                     m_drawList.size(), m_cullVisible.data());
+        for(size_t i = 0; i < m_drawList.size(); i++)
+        {
+            if(m_cullVisible[i])
+            {
+                drawComponent(m_drawList[i], rend);
+                culling.stats.visible++;
+            }
+            else
+                culling.stats.culled++;
+        }
+    }
+
+    std::vector<T*> m_components;
+
+    // scratch of drawCulled
+    std::vector<T*> m_drawList;
+    std::vector<float> m_cullX, m_cullY, m_cullZ, m_cullRadius;
+    std::vector<uint8_t> m_cullVisible;
+};
+
+#endif // COMPONENT_POOL_HPP
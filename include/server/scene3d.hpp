@@ -4,8 +4,18 @@
 #include "client/renderer.hpp"
 #include "server/physicsmanager.hpp"
 #include "common/entities/camera3d.hpp"
+#include "common/entities/entityhandle.hpp"
+#include "server/animationsystem.hpp"
+#include "server/componentpool.hpp"
+#include "server/transformsystem.hpp"
+#include "server/spatialindex.hpp"
+#include "server/scenequery.hpp"
+#include "common/eventbus.hpp"
 
 #include <unordered_map>
+#include <map>
+#include <typeindex>
+#include <memory>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -13,10 +23,19 @@
 
 #include "common/dirty_flag.hpp"
 
+struct SceneRayHit
+{
+    std::shared_ptr<Entity> entity; // nullptr when nothing was hit
+    uint32_t meshId;
+    uint32_t triangle;
+    glm::vec3 point;
+    float t;
+};
+
 class Scene3D
 {
 public:
-    Scene3D();
+    explicit Scene3D(ThreadPool& pool=ThreadPool::global());
     ~Scene3D();
 
     void draw(Renderer *rend);
@@ -24,11 +43,30 @@ public:
 
     void terminate();
 
-    void addObject(std::shared_ptr<Entity> other);
+    // spawns and destroys go through a command buffer: outside update() it is applied right away, during it
+    // (component updates, entity events) the changes wait for the end of the update and are applied in one batch
+    // the handle is valid from the start, but only resolves once the spawn was applied
+    EntityHandle addObject(std::shared_ptr<Entity> other);
     void removeObject(std::shared_ptr<Entity> other);
+    void removeObject(const EntityHandle& handle);
 
+    // O(1), empty once the entity left the scene even if its slot was reused
+    std::weak_ptr<Entity> getObject(const EntityHandle& handle) const;
+    // only entities created with a persistent id can be found by it
     std::weak_ptr<Entity> getObject(const uuids::uuid& id) const;
 
+    // closest mesh hit per segment, the model triangle BVHs of the entities the spatial index finds along it are tested nearest first
+    std::vector<SceneRayHit> raycast(const std::vector<RaySegment>& rays) const;
+    SceneRayHit raycast(const glm::vec3& from, const glm::vec3& to) const;
+
+    // entities whose bounds (meshes, or the position without meshes) overlap, found through the spatial index
+    // the index follows the transforms and meshes after each update
+    std::vector<std::shared_ptr<Entity>> queryBox(const glm::vec3& min, const glm::vec3& max) const;
+    std::vector<std::shared_ptr<Entity>> querySphere(const glm::vec3& center, float radius) const;
+    std::vector<std::shared_ptr<Entity>> queryFrustum(Camera3D& camera) const;
+    // nearest first
+    std::vector<std::shared_ptr<Entity>> queryRay(const glm::vec3& from, const glm::vec3& to) const;
+
     void clear();
 
     void setCamera(const Camera3D &cam);
@@ -39,10 +77,99 @@ public:
     void setLightCount(uint32_t count);
 
     size_t getObjectCount() const;
+
+    // meshes outside the camera frustum are skipped before they reach the renderer, on by default
+    void setFrustumCulling(bool enabled);
+    bool frustumCulling() const;
+    const CullingStats& lastCullingStats() const;
+
+    // delivered at the end of every update, before the spawns and destroys are applied
+    clean::EventBus& events();
+    AnimationSystem& animations();
+    TransformSystem& transforms();
+    SpatialIndex& spatialIndex();
+    // refreshes the entity's bounds in the spatial index after the next component update
+    void invalidateBounds(Entity *entity);
+
+    // gives components of type T (exact type) their own pool, updated in registration order
+    // types nobody registered get a serial pool on first use, updated before the registered ones
+    // serial pools run before the transform update, parallel ones after it, when the world matrices are final
+    template<typename T>
+    void registerComponentType(ComponentUpdate update=ComponentUpdate::Serial)
+    {
+        if(m_poolIndex.find(std::type_index(typeid(T))) != m_poolIndex.end())
+            return;
+        m_pools.push_back(std::make_unique<ComponentPool<T>>());
+        m_poolUpdates.push_back(update);
+        m_poolIndex[std::type_index(typeid(T))] = m_pools.back().get();
+    }
+
+    // dense array of the components of exact type T in the scene, empty for unregistered types
+    template<typename T>
+    const std::vector<T*>& components() const
+    {
+        static const std::vector<T*> empty;
+        auto it = m_poolIndex.find(std::type_index(typeid(T)));
+        if(it == m_poolIndex.end())
+            return empty;
+        return static_cast<const ComponentPool<T>*>(it->second)->components();
+    }
+
+    size_t getComponentCount() const;
+
+    // entities with components of all the types Ts (or derived from them), for systems that work on combinations
+    // the first call builds the match list, from then on attaching and removing components keeps it current
+    template<typename... Ts>
+    SceneView<Ts...> view()
+    {
+        return SceneView<Ts...>(query({ComponentFilter::of<Ts>()...}));
+    }
+    // the same for filters only known at runtime (scripts), cached per list of filter types
+    const SceneQuery& query(const std::vector<ComponentFilter>& filters);
+
+    // called by the entities of the scene when they gain or lose a component
+    void addComponent(Component *comp);
+    void removeComponent(Component *comp);
 private:
+    // owner of an entity in the scene, free slots form a list through nextFree
+    struct ObjectSlot
+    {
+        std::shared_ptr<Entity> entity;
+        uint32_t generation;
+        uint32_t nextFree;
+        bool pending; // reserved, waiting for the spawn to be applied
+    };
+
+    // the slot of handle holds an entity, and that entity when one is given
+    bool owns(const EntityHandle& handle, const Entity *entity) const;
+    void applyChanges();
+    void spawnObject(uint32_t index);
+    void despawnObject(uint32_t index);
+    void refreshBounds();
+    std::vector<std::shared_ptr<Entity>> toObjects(const std::vector<Entity*>& entities) const;
+
     Camera3D m_camera;
-    // for now
-    std::unordered_map<uuids::uuid, std::shared_ptr<Entity>> m_objects;
+    ThreadPool& m_pool;
+    clean::EventBus m_events;
+    AnimationSystem m_animations;
+    TransformSystem m_transforms;
+    SpatialIndex m_spatial;
+    std::vector<uint32_t> m_slotProxies; // spatial proxy per transform slot
+    std::vector<uint32_t> m_boundsDirty; // transform slots
+    std::vector<std::unique_ptr<ComponentPoolBase>> m_pools; // update order
+    std::vector<ComponentUpdate> m_poolUpdates;             // per pool
+    std::unordered_map<std::type_index, ComponentPoolBase*> m_poolIndex;
+    std::map<std::vector<std::type_index>, std::unique_ptr<SceneQuery>> m_queries;
+    size_t m_unregisteredPools;
+    bool m_frustumCulling;
+    CullingStats m_cullingStats;
+    std::vector<ObjectSlot> m_objects; // indexed by EntityHandle::index
+    uint32_t m_freeObjects;            // first free slot, EntityHandle::NO_INDEX when there is none
+    size_t m_objectCount;
+    std::unordered_map<uuids::uuid, uint32_t> m_persistentIds; // object slots of the entities that have an id
+    std::vector<uint32_t> m_spawns;       // object slots, in the order of the calls
+    std::vector<EntityHandle> m_despawns;
+    bool m_deferChanges;                  // inside update()
 };
 
 #endif // SCENE3D_HPP
@@ -0,0 +1,106 @@
+#ifndef SCENE_QUERY_HPP
+#define SCENE_QUERY_HPP
+
+#include <vector>
+#include <cstdint>
+#include <typeindex>
+#include <utility>
+#include <tuple>
+
+#include "common/entities/component.hpp"
+#include "common/entities/entity.hpp"
+
+// matches components of type T or derived from it, so abstract interfaces like BodyComponent work as well
+struct ComponentFilter
+{
+    std::type_index type;
+    bool (*matches)(const Component *comp);
+
+    template<typename T>
+    static ComponentFilter of()
+    {
+        return ComponentFilter{std::type_index(typeid(T)), [](const Component *comp) { return dynamic_cast<const T*>(comp) != nullptr; }};
+    }
+};
+
+// scene entities with a component for every filter, the first attached one when an entity has several
+// the scene updates the match list whenever components are attached or removed, it isn't rebuilt per query
+// rows are packed: entities()[row], and the components of the row at components()[row * filterCount() + filter]
+// rows are swapped around on removal, so the order is unspecified
+class SceneQuery
+{
+public:
+    explicit SceneQuery(std::vector<ComponentFilter> filters);
+
+    size_t size() const;
+    size_t filterCount() const;
+    const std::vector<ComponentFilter> &filters() const;
+
+    const std::vector<Entity*> &entities() const;
+    const std::vector<Component*> &components() const;
+    Component *component(size_t row, size_t filter) const;
+
+    // comp matches one of the filters, so attaching or removing it may change the rows
+    bool involves(const Component *comp) const;
+    // re-evaluates an entity of the scene from its pooled components, so the scene calls it after the pool change
+    void refresh(Entity *entity);
+    void clear();
+
+private:
+    static constexpr uint32_t NO_ROW = UINT32_MAX;
+
+    std::vector<ComponentFilter> m_filters;
+    std::vector<Entity*> m_entities;
+    std::vector<Component*> m_components;
+    std::vector<uint32_t> m_rowOf; // by EntityHandle::index
+    std::vector<Component*> m_found;
+};
+
+// typed access to the rows of a query, see Scene3D::view
+// attaching or removing components of the matched types while iterating changes the rows
+template<typename... Ts>
+class SceneView
+{
+public:
+    explicit SceneView(const SceneQuery &query)
+        : m_query(&query)
+    { }
+
+    size_t size() const
+    {
+        return m_query->size();
+    }
+
+    Entity *entity(size_t row) const
+    {
+        return m_query->entities()[row];
+    }
+
+    template<size_t K>
+    auto *component(size_t row) const
+    {
+        using T = std::tuple_element_t<K, std::tuple<Ts...>>;
+        return static_cast<T*>(m_query->components()[row * sizeof...(Ts) + K]);
+    }
+
+    // fn(Entity&, Ts&...) for every row
+    template<typename F>
+    void each(F &&fn) const
+    {
+        eachRow(fn, std::index_sequence_for<Ts...>{});
+    }
+
+private:
+    template<typename F, size_t... K>
+    void eachRow(F &fn, std::index_sequence<K...>) const
+    {
+        const auto &entities = m_query->entities();
+        Component *const *components = m_query->components().data();
+        for(size_t row = 0; row < entities.size(); row++, components += sizeof...(Ts))
+            fn(*entities[row], *static_cast<std::tuple_element_t<K, std::tuple<Ts...>>*>(components[K])...);
+    }
+
+    const SceneQuery *m_query;
+};
+
+#endif // SCENE_QUERY_HPP
@@ -0,0 +1,96 @@
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "common/3d/trianglebvh.hpp"
+
+class Entity;
+
+struct SpatialBounds
+{
+    glm::vec3 min;
+    glm::vec3 max;
+
+    static SpatialBounds fromSphere(const glm::vec3& center, float radius);
+
+    SpatialBounds merged(const SpatialBounds& other) const;
+    bool contains(const SpatialBounds& other) const;
+    bool overlaps(const SpatialBounds& other) const;
+    float area() const; // half the surface area
+};
+
+struct SpatialRayHit
+{
+    Entity* entity;
+    float t; // where the segment enters the bounds, 0 when it starts inside
+};
+
+// dynamic AABB tree over entity bounds
+// leaves hold the bounds grown by a margin, so small moves don't touch the tree,
+// and the tree is kept balanced by rotations like an AVL tree
+class SpatialIndex
+{
+public:
+    static constexpr uint32_t NO_PROXY = UINT32_MAX;
+
+    explicit SpatialIndex(float margin = 0.5f);
+
+    uint32_t insert(const SpatialBounds& bounds, Entity* entity);
+    void remove(uint32_t proxy);
+    // reinserts only when the bounds left the grown ones, returns whether it did
+    bool move(uint32_t proxy, const SpatialBounds& bounds);
+    void clear();
+
+    Entity* entity(uint32_t proxy) const;
+    const SpatialBounds& bounds(uint32_t proxy) const;
+
+    // results are appended, tested against the exact bounds of the entities
+    void queryBox(const SpatialBounds& bounds, std::vector<Entity*>& result) const;
+    void querySphere(const glm::vec3& center, float radius, std::vector<Entity*>& result) const;
+    // planes taken from the view-projection matrix
+    void queryFrustum(const glm::mat4& viewProj, std::vector<Entity*>& result) const;
+    // sorted by t
+    void queryRay(const RaySegment& ray, std::vector<SpatialRayHit>& result) const;
+
+    size_t size() const;
+    size_t nodeCount() const;
+    uint32_t height() const;
+private:
+    struct Node
+    {
+        SpatialBounds bounds;
+        uint32_t parent; // next free node while unused
+        uint32_t left;   // NO_PROXY for leaves
+        uint32_t right;  // proxy of leaves
+        int32_t height;  // 0 for leaves
+    };
+    struct Proxy
+    {
+        SpatialBounds bounds;
+        uint32_t node; // next free proxy while unused
+        Entity* entity;
+    };
+
+    template<typename NodeTest, typename ProxyVisitor>
+    void traverse(NodeTest&& test, ProxyVisitor&& visit) const;
+
+    uint32_t allocateNode();
+    void freeNode(uint32_t node);
+    void insertLeaf(uint32_t leaf);
+    void removeLeaf(uint32_t leaf);
+    uint32_t balance(uint32_t node);
+    void refit(uint32_t node);
+
+    float m_margin;
+    std::vector<Node> m_nodes;
+    std::vector<Proxy> m_proxies;
+    uint32_t m_root;
+    uint32_t m_freeNodes;
+    uint32_t m_freeProxies;
+    size_t m_proxyCount;
+};
+
+#endif // SPATIAL_INDEX_HPP
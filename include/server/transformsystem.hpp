@@ -0,0 +1,93 @@
+#ifndef TRANSFORM_SYSTEM_HPP
+#define TRANSFORM_SYSTEM_HPP
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "common/threadpool.hpp"
+
+// position/rotation/scale (relative to the parent) and world matrix of every scene entity in contiguous arrays
+// setters only mark a slot dirty, update() recomposes the dirty local matrices four at a time and then
+// propagates world matrices through the dirty subtrees, both in parallel chunks on the pool
+class TransformSystem
+{
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    explicit TransformSystem(ThreadPool& pool=ThreadPool::global());
+
+    // slots stay valid until removed, removed ones are reused
+    uint32_t add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+    // children of the slot become roots
+    void remove(uint32_t slot);
+    size_t size() const; // live transforms
+    size_t slotCount() const; // slots, live or free
+    // makes room for count more slots, so adding them doesn't reallocate the arrays one by one
+    void reserve(size_t count);
+
+    void setPosition(uint32_t slot, const glm::vec3& position);
+    void setRotation(uint32_t slot, const glm::quat& rotation);
+    void setScale(uint32_t slot, const glm::vec3& scale);
+    bool isDirty(uint32_t slot) const;
+
+    // NO_SLOT detaches, throws when parent is the slot itself or one of its descendants
+    void setParent(uint32_t slot, uint32_t parent);
+    uint32_t parent(uint32_t slot) const;
+    uint32_t depth(uint32_t slot) const; // 0 for roots
+
+    // brings just this slot and its ancestors up to date when needed
+    // only reads while nothing is dirty, which is what parallel readers rely on after update()
+    const glm::mat4& world(uint32_t slot);
+    void update();
+
+    // world matrices recomputed by the last update() and on access since the update before
+    size_t lastRecomputed() const;
+    // slots whose world matrix changed in that time, may hold removed slots
+    const std::vector<uint32_t>& lastMoved() const;
+private:
+    enum Flags : uint8_t
+    {
+        ALIVE = 1,
+        LOCAL_DIRTY = 2,
+        WORLD_DIRTY = 4, // the world matrices of the slot and its whole subtree are stale
+        MOVED = 8
+    };
+
+    void markDirty(uint32_t slot, uint8_t flags);
+    void markMoved(uint32_t slot);
+    void unlink(uint32_t slot);
+    void updateDepths(uint32_t slot);
+    void composeWorld(uint32_t slot);
+    bool hasStaleAncestor(uint32_t slot) const;
+    void propagate(size_t rootBegin, size_t rootEnd);
+
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::quat> m_rotations;
+    std::vector<glm::vec3> m_scales;
+    std::vector<glm::mat4> m_locals;
+    std::vector<glm::mat4> m_worlds;
+    std::vector<uint8_t> m_flags;
+    std::vector<uint32_t> m_parents;
+    std::vector<uint32_t> m_firstChildren;
+    std::vector<uint32_t> m_nextSiblings;
+    std::vector<uint32_t> m_depths;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<uint32_t> m_dirtySlots; // may hold stale or repeated slots, m_flags decides
+    std::vector<uint32_t> m_moved;
+    std::vector<uint32_t> m_lastMoved;
+
+    // scratch of update() and world()
+    std::vector<uint32_t> m_batch;
+    std::vector<uint32_t> m_roots;
+    std::vector<uint32_t> m_queue;
+
+    ThreadPool& m_pool;
+    std::mutex m_movedMutex; // parallel propagation chunks
+    size_t m_recomputed;
+    size_t m_lastRecomputed;
+};
+
+#endif // TRANSFORM_SYSTEM_HPP
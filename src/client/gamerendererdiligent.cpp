@@ -105,7 +105,7 @@ void GameRendererDiligent::init(const VideoMode &mode)
     // Create dynamic uniform buffer that will store our transformation matrices
     // Dynamic buffers can be frequently updated by the CPU
     const int MAX_MESH_TRANSFORMS = 100;
-    CreateUniformBuffer(m_pDevice, sizeof(float4x4) * 2 + sizeof(float4) + sizeof(float4x4) * MAX_MESH_TRANSFORMS, "VS constants CB", &m_VSConstants);
+    CreateUniformBuffer(m_pDevice, sizeof(float4x4) * 2 + sizeof(float4) + sizeof(float4x4) * MAX_MESH_TRANSFORMS + sizeof(float4x4) * MAX_BONE_TRANSFORMS, "VS constants CB", &m_VSConstants);
     Barriers.emplace_back(m_VSConstants, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
 
     CreateTexturedPSO();
@@ -429,6 +429,7 @@ void GameRendererDiligent::Render(const RenderData& renderData, bool IsShadowPas
         float4x4 NormalTranform;
         float4   LightDirection;
         float4x4 MeshTransforms[100];
+        float4x4 BoneTransforms[MAX_BONE_TRANSFORMS];
     };
     MapHelper<ShaderConstants> CBConstants(m_pImmediateContext, m_VSConstants, MAP_WRITE, MAP_FLAG_DISCARD);
     
@@ -444,6 +445,10 @@ void GameRendererDiligent::Render(const RenderData& renderData, bool IsShadowPas
     CBConstants->NormalTranform = NormalMatrix;
     CBConstants->LightDirection = m_LightDirection;
 
+    size_t boneCount = std::min(renderData.boneMatrices.size(), static_cast<size_t>(MAX_BONE_TRANSFORMS));
+    if(boneCount > 0)
+        memcpy(CBConstants->BoneTransforms, renderData.boneMatrices.data(), sizeof(float4x4) * boneCount);
+
     // Bind vertex buffer
     const auto& model = m_models[renderData.modelId];
     for(auto meshId = 0; meshId < model.meshCount; meshId++)
@@ -452,8 +457,13 @@ void GameRendererDiligent::Render(const RenderData& renderData, bool IsShadowPas
         if(meshId < renderData.meshMatrices.size()) {
             CBConstants->MeshTransforms[meshId] = renderData.meshMatrices.at(meshId);
         }
+        if(!renderData.meshMask.empty() && !renderData.meshMask[meshId]) {
+            continue;
+        }
         //
-        const auto& vertexBuffer = model.vertexBuffers[meshId];
+        IBuffer* vertexBuffer = model.vertexBuffers[meshId];
+        if(meshId < renderData.vertexBuffers.size() && renderData.vertexBuffers[meshId] != nullptr)
+            vertexBuffer = renderData.vertexBuffers[meshId];
         const auto& indexBuffer  = model.indexBuffers[meshId];
         const auto& indexCount   = model.indexCounts[meshId];
 
@@ -480,27 +490,65 @@ void GameRendererDiligent::Render(const RenderData& renderData, bool IsShadowPas
     }
 }
 
-void GameRendererDiligent::queueRender(size_t modelId, const std::vector<size_t>& materialIds, const glm::mat4& modelMatrix)
+void GameRendererDiligent::queueRender(const RenderItem& item)
 {
-    float4x4 mx;
-    memcpy(mx.Data(), &modelMatrix[0][0], sizeof(float) * 16);
-    m_queuedRenderObjects.emplace_back(modelId, materialIds, mx, std::vector<float4x4>{});
-}
+    RenderData& renderData = m_queuedRenderObjects.emplace_back();
+    renderData.modelId = item.modelId;
+    renderData.materialIds.assign(item.materialIds.begin(), item.materialIds.end());
+    memcpy(renderData.modelMatrix.Data(), &item.modelMatrix[0][0], sizeof(float) * 16);
 
-void GameRendererDiligent::queueRender(size_t modelId, const std::vector<size_t>& materialIds, const glm::mat4& modelMatrix, const std::vector<glm::mat4>& meshMatrices)
-{
-    float4x4 mdmx;
-    memcpy(mdmx.Data(), &modelMatrix[0][0], sizeof(float) * 16);
+    renderData.meshMatrices.resize(item.meshMatrices.size());
+    if(!item.meshMatrices.empty())
+        memcpy(renderData.meshMatrices.data(), item.meshMatrices.data(), sizeof(float) * 16 * item.meshMatrices.size());
+
+    // bones past MAX_BONE_TRANSFORMS are dropped when the constants are uploaded, the importer draws meshes using them rigid
+    renderData.boneMatrices.resize(item.bonePalette.size());
+    if(!item.bonePalette.empty())
+        memcpy(renderData.boneMatrices.data(), item.bonePalette.data(), sizeof(float) * 16 * item.bonePalette.size());
 
-    std::vector<float4x4> meshmxs;
-    meshmxs.reserve(meshMatrices.size());
-    for(const auto& mx : meshMatrices)
+    if(item.modelId >= m_models.size())
+        return;
+    const auto& model = m_models[item.modelId];
+
+    // looked up per mesh in both passes, so resolved here once
+    if(!item.meshIds.empty())
     {
-        float4x4 m;
-        memcpy(m.Data(), &mx[0][0], sizeof(float) * 16);
-        meshmxs.emplace_back(m);
+        renderData.meshMask.assign(model.meshCount, false);
+        for(uint32_t meshId : item.meshIds)
+        {
+            if(meshId < renderData.meshMask.size())
+                renderData.meshMask[meshId] = true;
+        }
+    }
+
+    for(size_t meshId = 0; meshId < item.meshPositions.size() && meshId < model.meshCount; meshId++)
+    {
+        const auto& mesh = model.meshes[meshId];
+        if(item.meshPositions[meshId].size() != mesh->vertexCount())
+            continue;
+
+        Uint64 size = mesh->vertexCount() * mesh->vertexStride();
+        if(m_usedDynamicVertexBuffers == m_dynamicVertexBuffers.size())
+            m_dynamicVertexBuffers.emplace_back();
+        auto& buffer = m_dynamicVertexBuffers[m_usedDynamicVertexBuffers++];
+        if(buffer == nullptr || buffer->GetDesc().Size < size)
+        {
+            BufferDesc VertBuffDesc;
+            VertBuffDesc.Name           = "Morphed vertex buffer";
+            VertBuffDesc.Usage          = USAGE_DYNAMIC;
+            VertBuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
+            VertBuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+            VertBuffDesc.Size           = size;
+            buffer.Release();
+            m_pDevice->CreateBuffer(VertBuffDesc, nullptr, &buffer);
+        }
+
+        MapHelper<char> vertices(m_pImmediateContext, buffer, MAP_WRITE, MAP_FLAG_DISCARD);
+        mesh->writeVertexData(vertices, &item.meshPositions[meshId]);
+
+        renderData.vertexBuffers.resize(model.meshCount, nullptr);
+        renderData.vertexBuffers[meshId] = buffer;
     }
-    m_queuedRenderObjects.emplace_back(modelId, materialIds, mdmx, meshmxs);
 }
 
 void GameRendererDiligent::RenderShadowMapVis()
@@ -534,6 +582,7 @@ void GameRendererDiligent::draw()
 
     // clear render queue
     m_queuedRenderObjects.clear();
+    m_usedDynamicVertexBuffers = 0;
 
     // Draw UI
     ServiceLocator::getUIManager().draw();
@@ -565,7 +614,10 @@ size_t GameRendererDiligent::allocateModel(std::shared_ptr<ModelPrimitive> model
         indexCounts.emplace_back(mesh->indexCount());
     }
     m_pImmediateContext->TransitionResourceStates(static_cast<Uint32>(barriers.size()), barriers.data());
-    m_models.emplace_back(vertexBuffers, indexBuffers, indexCounts, model->meshCount());
+    std::vector<std::shared_ptr<MeshPrimitive>> meshes;
+    for(size_t i = 0; i < model->meshCount(); i++)
+        meshes.push_back(model->mesh(i));
+    m_models.emplace_back(vertexBuffers, indexBuffers, indexCounts, model->meshCount(), meshes);
     return m_models.size()-1;
 }
 
@@ -846,6 +898,8 @@ RefCntAutoPtr<IPipelineState> CreatePipelineState(const CreatePSOInfo& CreateInf
     if (CreateInfo.Components & VERTEX_COMPONENT_FLAG_TEXCOORD)
         InputLayout.Add(Attrib++, 0u, 2u, VT_FLOAT32, False);
     InputLayout.Add(Attrib++, 0u, 1u, VT_UINT32, False); // MeshId
+    InputLayout.Add(Attrib++, 0u, 4u, VT_UINT16, False); // BoneIndices
+    InputLayout.Add(Attrib++, 0u, 4u, VT_FLOAT32, False); // BoneWeights
 
     for (Uint32 i = 0; i < CreateInfo.NumExtraLayoutElements; ++i)
         InputLayout.Add(CreateInfo.ExtraLayoutElements[i]);
@@ -891,4 +945,4 @@ RefCntAutoPtr<IPipelineState> CreatePipelineState(const CreatePSOInfo& CreateInf
 
 } // namespace TexturedCube
 
-} // namespace Diligent
\ No newline at end of file
+} // namespace Diligent
\ No newline at end of file
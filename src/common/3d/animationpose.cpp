@@ -0,0 +1,203 @@
+#include <glm/gtx/quaternion.hpp>
+
+#include "common/3d/animationpose.hpp"
+#include "common/simd.hpp"
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::quat) == 4 * sizeof(float), "blending expects tightly packed glm types");
+
+static void interpolatePalette(const std::vector<glm::mat4>& from, const std::vector<glm::mat4>& to, float t, std::vector<glm::mat4>& out)
+{
+    // poses of another model layout can't be blended, show the newer one
+    if (from.size() != to.size())
+    {
+        out = to;
+        return;
+    }
+
+    out.resize(to.size());
+    for (size_t i = 0; i < to.size(); i++)
+        out[i] = from[i] + (to[i] - from[i]) * t;
+}
+
+void AnimationPose::evaluate(const AnimationPrimitive& anim, const ModelNodeTree* nodes, const ModelSkeleton* skeleton, double timecode, AnimationCursor* cursors)
+{
+    // channels overwrite the bind pose of the nodes and bones they drive
+    if (nodes)
+        nodeLocals = nodes->bindLocals();
+    if (skeleton)
+        boneLocals = skeleton->bindLocalTransforms();
+
+    // baked clips: two frame loads and a blend per channel
+    AnimationBakedSample baked{};
+    if (anim.baked())
+        baked = anim.sampleBaked(timecode);
+
+    for (uint32_t channelId = 0; channelId < anim.channelCount(); channelId++)
+    {
+        glm::mat4 transform = anim.baked() ? baked.channel(channelId)
+                                           : anim.sample(channelId, timecode, cursors ? &cursors[channelId] : nullptr).matrix();
+        const AnimationChannel& channel = anim.channel(channelId);
+        if (nodes && channel.node >= 0 && static_cast<size_t>(channel.node) < nodeLocals.size())
+            nodeLocals[channel.node] = transform;
+        if (skeleton && channel.bone >= 0 && static_cast<size_t>(channel.bone) < boneLocals.size())
+            boneLocals[channel.bone] = transform;
+    }
+
+    updatePalettes(nodes, skeleton);
+}
+
+static float* floats(std::vector<glm::vec3>& values)
+{
+    return reinterpret_cast<float*>(values.data());
+}
+
+static const float* floats(const std::vector<glm::vec3>& values)
+{
+    return reinterpret_cast<const float*>(values.data());
+}
+
+static float* floats(std::vector<glm::quat>& values)
+{
+    return reinterpret_cast<float*>(values.data());
+}
+
+static const float* floats(const std::vector<glm::quat>& values)
+{
+    return reinterpret_cast<const float*>(values.data());
+}
+
+// same sizes every frame, so the assignments reuse the existing storage
+static void resetLocalPose(AnimationLocalPose& pose, const std::vector<glm::vec3>& positions, const std::vector<glm::quat>& rotations,
+                           const std::vector<glm::vec3>& scales)
+{
+    pose.positions = positions;
+    pose.rotations = rotations;
+    pose.scales = scales;
+}
+
+// bind is only read by additive layers
+static void blendLocalPose(AnimationLocalPose& result, const AnimationLocalPose& layer, const std::vector<glm::vec3>& bindPositions,
+                           const std::vector<glm::quat>& bindRotations, const std::vector<glm::vec3>& bindScales, const AnimationLayer& params)
+{
+    size_t count = result.positions.size();
+    if (params.additive)
+    {
+        clean::simd::addScaledDifference(floats(result.positions), floats(layer.positions), floats(bindPositions), params.weight, count * 3);
+        clean::simd::addScaledDifference(floats(result.scales), floats(layer.scales), floats(bindScales), params.weight, count * 3);
+        const glm::quat identity(1.f, 0.f, 0.f, 0.f);
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::quat delta = glm::inverse(bindRotations[i]) * layer.rotations[i];
+            clean::simd::nlerpQuats(&delta.x, &identity.x, &delta.x, params.weight, 1);
+            result.rotations[i] = glm::normalize(result.rotations[i] * delta);
+        }
+    }
+    else
+    {
+        clean::simd::lerp(floats(result.positions), floats(result.positions), floats(layer.positions), params.weight, count * 3);
+        clean::simd::lerp(floats(result.scales), floats(result.scales), floats(layer.scales), params.weight, count * 3);
+        clean::simd::nlerpQuats(floats(result.rotations), floats(result.rotations), floats(layer.rotations), params.weight, count);
+    }
+}
+
+static void composeLocals(const AnimationLocalPose& pose, std::vector<glm::mat4>& locals)
+{
+    locals.resize(pose.positions.size());
+    for (size_t i = 0; i < locals.size(); i++)
+        locals[i] = AnimationTransform{pose.positions[i], pose.rotations[i], pose.scales[i]}.matrix();
+}
+
+void AnimationPose::evaluateBlend(const AnimationLayer* layers, size_t layerCount, const ModelNodeTree* nodes, const ModelSkeleton* skeleton)
+{
+    if (skeleton)
+    {
+        m_bindBones.positions.resize(skeleton->boneCount());
+        m_bindBones.rotations.resize(skeleton->boneCount());
+        m_bindBones.scales.assign(skeleton->boneCount(), glm::vec3(1.f));
+        for (size_t i = 0; i < skeleton->boneCount(); i++)
+        {
+            m_bindBones.positions[i] = skeleton->bone(i).translation;
+            m_bindBones.rotations[i] = skeleton->bone(i).rotation;
+        }
+        resetLocalPose(m_blendBones, m_bindBones.positions, m_bindBones.rotations, m_bindBones.scales);
+    }
+    if (nodes)
+        resetLocalPose(m_blendNodes, nodes->bindPositions(), nodes->bindRotations(), nodes->bindScales());
+
+    for (size_t layerId = 0; layerId < layerCount; layerId++)
+    {
+        const AnimationLayer& layer = layers[layerId];
+        if (layer.anim == nullptr || layer.weight <= 0.f)
+            continue;
+
+        // channels overwrite the bind pose of the nodes and bones they drive
+        if (nodes)
+            resetLocalPose(m_layerNodes, nodes->bindPositions(), nodes->bindRotations(), nodes->bindScales());
+        if (skeleton)
+            resetLocalPose(m_layerBones, m_bindBones.positions, m_bindBones.rotations, m_bindBones.scales);
+
+        // blending needs the components, so baked clips are sampled from their keys here
+        for (uint32_t channelId = 0; channelId < layer.anim->channelCount(); channelId++)
+        {
+            AnimationTransform transform = layer.anim->sample(channelId, layer.timecode, layer.cursors ? &layer.cursors[channelId] : nullptr);
+            const AnimationChannel& channel = layer.anim->channel(channelId);
+            if (nodes && channel.node >= 0 && static_cast<size_t>(channel.node) < m_layerNodes.positions.size())
+            {
+                m_layerNodes.positions[channel.node] = transform.position;
+                m_layerNodes.rotations[channel.node] = transform.rotation;
+                m_layerNodes.scales[channel.node] = transform.scale;
+            }
+            if (skeleton && channel.bone >= 0 && static_cast<size_t>(channel.bone) < m_layerBones.positions.size())
+            {
+                m_layerBones.positions[channel.bone] = transform.position;
+                m_layerBones.rotations[channel.bone] = transform.rotation;
+                m_layerBones.scales[channel.bone] = transform.scale;
+            }
+        }
+
+        // a full weight fade layer replaces everything below it, the swap keeps both buffers allocated
+        bool replace = !layer.additive && layer.weight >= 1.f;
+        if (nodes)
+        {
+            if (replace)
+                std::swap(m_blendNodes, m_layerNodes);
+            else
+                blendLocalPose(m_blendNodes, m_layerNodes, nodes->bindPositions(), nodes->bindRotations(), nodes->bindScales(), layer);
+        }
+        if (skeleton)
+        {
+            if (replace)
+                std::swap(m_blendBones, m_layerBones);
+            else
+                blendLocalPose(m_blendBones, m_layerBones, m_bindBones.positions, m_bindBones.rotations, m_bindBones.scales, layer);
+        }
+    }
+
+    if (nodes)
+        composeLocals(m_blendNodes, nodeLocals);
+    if (skeleton)
+        composeLocals(m_blendBones, boneLocals);
+    updatePalettes(nodes, skeleton);
+}
+
+void AnimationPose::interpolate(const AnimationPose& from, const AnimationPose& to, float t)
+{
+    interpolatePalette(from.meshTransforms, to.meshTransforms, t, meshTransforms);
+    interpolatePalette(from.bonePalette, to.bonePalette, t, bonePalette);
+}
+
+void AnimationPose::updatePalettes(const ModelNodeTree* nodes, const ModelSkeleton* skeleton)
+{
+    if (nodes)
+    {
+        nodes->computeGlobals(nodeLocals, nodeGlobals);
+        nodes->computeMeshPalette(nodeGlobals, meshTransforms);
+    }
+    else
+        meshTransforms.clear();
+
+    if (skeleton)
+        skeleton->computePalette(boneLocals, bonePalette);
+    else
+        bonePalette.clear();
+}
@@ -1,13 +1,168 @@
 #include <stdexcept>
-#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
 
 #include <glm/gtx/quaternion.hpp>
-#include <glm/gtx/matrix_decompose.hpp>
-#include <glm/gtx/matrix_interpolation.hpp>
 
 #include "common/3d/animationprimitive.hpp"
 
 
+glm::mat4 AnimationTransform::matrix() const
+{
+    glm::mat4 result = glm::toMat4(rotation);
+    result[0] *= scale.x;
+    result[1] *= scale.y;
+    result[2] *= scale.z;
+    result[3] = glm::vec4(position, 1.f);
+    return result;
+}
+
+// index i of the key pair [i-1; i) containing timecode, times[0] < timecode < times.back()
+static uint32_t findKey(const float* times, uint32_t count, double timecode, uint32_t* cursor)
+{
+    uint32_t i = 0;
+    if (cursor != nullptr && *cursor > 0 && *cursor < count && times[*cursor - 1] <= timecode)
+    {
+        // playback moves forward, usually staying in the same pair or stepping to the next one
+        i = *cursor;
+        for (int step = 0; step < 2 && times[i] <= timecode; step++)
+            i++;
+        if (times[i] <= timecode)
+            i = 0;
+    }
+    if (i == 0)
+        i = static_cast<uint32_t>(std::upper_bound(times, times + count, timecode) - times);
+    if (cursor != nullptr)
+        *cursor = i;
+    return i;
+}
+
+template<typename T, typename Fetch, typename Interpolate>
+static T sampleTrack(const float* times, uint32_t count, double timecode, uint32_t* cursor, const T& identity, Fetch fetch, Interpolate interpolate)
+{
+    if (count == 0)
+        return identity;
+    if (timecode <= times[0])
+        return fetch(0);
+    if (timecode >= times[count - 1])
+        return fetch(count - 1);
+
+    uint32_t i = findKey(times, count, timecode, cursor);
+    float dt = static_cast<float>((timecode - times[i - 1]) / (times[i] - times[i - 1]));
+    return interpolate(fetch(i - 1), fetch(i), dt);
+}
+
+static glm::vec3 lerpVec3(const glm::vec3& a, const glm::vec3& b, float t)
+{
+    return glm::mix(a, b, t);
+}
+
+static glm::quat slerpQuat(const glm::quat& a, const glm::quat& b, float t)
+{
+    return glm::slerp(a, b, t);
+}
+
+static float rotationAngle(const glm::quat& a, const glm::quat& b)
+{
+    // from the chord between the unit quaternions, acos(dot) loses small angles to float precision
+    float chord = glm::length(glm::dot(a, b) < 0.f ? a + b : a - b);
+    return 4.f * std::asin(std::min(chord * 0.5f, 1.f));
+}
+
+static const float SMALLEST_THREE_RANGE = 0.70710678f; // the components besides the largest are within +-1/sqrt(2)
+
+static PackedQuat packQuat(const glm::quat& rotation)
+{
+    glm::quat q = glm::normalize(rotation);
+    float components[4] = {q.x, q.y, q.z, q.w};
+    int largest = 0;
+    for (int i = 1; i < 4; i++)
+    {
+        if (std::abs(components[i]) > std::abs(components[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation, the dropped component is restored as positive
+    float sign = components[largest] < 0.f ? -1.f : 1.f;
+
+    PackedQuat packed{};
+    for (int i = 0, j = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        float normalized = (components[i] * sign / SMALLEST_THREE_RANGE) * 0.5f + 0.5f;
+        packed.data[j++] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.f, 1.f) * 32767.f));
+    }
+    packed.data[0] |= static_cast<uint16_t>((largest & 1) << 15);
+    packed.data[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+    return packed;
+}
+
+static glm::quat unpackQuat(const PackedQuat& packed)
+{
+    int largest = (packed.data[0] >> 15) | ((packed.data[1] >> 15) << 1);
+    float components[4];
+    float sum = 0.f;
+    for (int i = 0, j = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        float value = ((packed.data[j++] & 0x7fff) / 32767.f * 2.f - 1.f) * SMALLEST_THREE_RANGE;
+        components[i] = value;
+        sum += value * value;
+    }
+    components[largest] = std::sqrt(std::max(1.f - sum, 0.f));
+    return glm::quat(components[3], components[0], components[1], components[2]);
+}
+
+static glm::vec3 unpackPosition(const AnimationChannel& channel, const PackedVec3& packed)
+{
+    return channel.positionMin + glm::vec3(packed.data[0], packed.data[1], packed.data[2]) * channel.positionStep;
+}
+
+// keeps the keys linear interpolation between the kept neighbours can't reproduce within tolerance
+template<typename T, typename Interpolate, typename Distance>
+static void reduceKeys(std::vector<float>& times, std::vector<T>& values, float tolerance, Interpolate interpolate, Distance distance)
+{
+    if (values.size() <= 1)
+        return;
+
+    // constant tracks need a single key
+    bool constant = true;
+    for (size_t i = 1; i < values.size() && constant; i++)
+        constant = distance(values[0], values[i]) <= tolerance;
+    if (constant)
+    {
+        times.resize(1);
+        values.resize(1);
+        return;
+    }
+
+    std::vector<float> keptTimes{times[0]};
+    std::vector<T> keptValues{values[0]};
+    size_t anchor = 0;
+    for (size_t candidate = 2; candidate < values.size(); candidate++)
+    {
+        // can the keys between anchor and candidate be dropped?
+        bool fits = true;
+        for (size_t i = anchor + 1; i < candidate && fits; i++)
+        {
+            float t = (times[i] - times[anchor]) / (times[candidate] - times[anchor]);
+            fits = distance(interpolate(values[anchor], values[candidate], t), values[i]) <= tolerance;
+        }
+        if (!fits)
+        {
+            anchor = candidate - 1;
+            keptTimes.push_back(times[anchor]);
+            keptValues.push_back(values[anchor]);
+        }
+    }
+    keptTimes.push_back(times.back());
+    keptValues.push_back(values.back());
+    times = std::move(keptTimes);
+    values = std::move(keptValues);
+}
+
 AnimationPrimitive::AnimationPrimitive(const std::string& name, double duration)
     : m_name(name), m_duration(duration)
 {}
@@ -32,159 +187,294 @@ double AnimationPrimitive::duration() const
     return m_duration;
 }
 
-size_t AnimationPrimitive::channelCount() const
+uint32_t AnimationPrimitive::addChannel(const AnimationChannelKeys& keys, int32_t node, int32_t bone)
 {
-    return m_keyframes.size();
+    clearBake(); // the baked frames would miss the new channel
+
+    if (keys.positionTimes.size() != keys.positions.size() ||
+        keys.rotationTimes.size() != keys.rotations.size() ||
+        keys.scaleTimes.size() != keys.scales.size())
+        throw std::runtime_error(fmt::format("Animation '{}' channel {} has mismatched key times", m_name, m_channels.size()));
+
+    AnimationChannel channel{};
+    channel.positionOffset = static_cast<uint32_t>(m_compressed ? m_packedPositions.size() : m_positions.size());
+    channel.positionCount = static_cast<uint32_t>(keys.positions.size());
+    channel.rotationOffset = static_cast<uint32_t>(m_compressed ? m_packedRotations.size() : m_rotations.size());
+    channel.rotationCount = static_cast<uint32_t>(keys.rotations.size());
+    channel.scaleOffset = static_cast<uint32_t>(m_scales.size());
+    channel.scaleCount = static_cast<uint32_t>(keys.scales.size());
+    channel.node = node;
+    channel.bone = bone;
+    channel.positionMin = glm::vec3(0.f);
+    channel.positionStep = glm::vec3(0.f);
+
+    m_positionTimes.insert(m_positionTimes.end(), keys.positionTimes.begin(), keys.positionTimes.end());
+    m_rotationTimes.insert(m_rotationTimes.end(), keys.rotationTimes.begin(), keys.rotationTimes.end());
+    m_scaleTimes.insert(m_scaleTimes.end(), keys.scaleTimes.begin(), keys.scaleTimes.end());
+    m_scales.insert(m_scales.end(), keys.scales.begin(), keys.scales.end());
+
+    if (!m_compressed)
+    {
+        m_positions.insert(m_positions.end(), keys.positions.begin(), keys.positions.end());
+        m_rotations.insert(m_rotations.end(), keys.rotations.begin(), keys.rotations.end());
+    }
+    else
+    {
+        // positions are quantized inside the channel's bounding box, min and max land exactly on codes 0 and 65535
+        if (!keys.positions.empty())
+        {
+            glm::vec3 maxPosition = keys.positions[0];
+            channel.positionMin = keys.positions[0];
+            for (const auto& position : keys.positions)
+            {
+                channel.positionMin = glm::min(channel.positionMin, position);
+                maxPosition = glm::max(maxPosition, position);
+            }
+            channel.positionStep = (maxPosition - channel.positionMin) / 65535.f;
+        }
+        for (const auto& position : keys.positions)
+        {
+            PackedVec3 packed{};
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float code = channel.positionStep[axis] > 0.f ? (position[axis] - channel.positionMin[axis]) / channel.positionStep[axis] : 0.f;
+                packed.data[axis] = static_cast<uint16_t>(std::lround(std::clamp(code, 0.f, 65535.f)));
+            }
+            m_packedPositions.push_back(packed);
+        }
+        for (const auto& rotation : keys.rotations)
+            m_packedRotations.push_back(packQuat(rotation));
+    }
+
+    m_channels.push_back(channel);
+    return static_cast<uint32_t>(m_channels.size() - 1);
 }
 
-void AnimationPrimitive::setMeshIds(uint32_t channelId, const std::vector<uint32_t>& meshIds)
+size_t AnimationPrimitive::channelCount() const
 {
-    m_meshIdsPerChannel.emplace(channelId, meshIds);
+    return m_channels.size();
 }
 
-const std::vector<uint32_t>& AnimationPrimitive::affectedMeshIds(uint32_t channelId) const
+const AnimationChannel& AnimationPrimitive::channel(uint32_t channelId) const
 {
-    auto meshIdsIt = m_meshIdsPerChannel.find(channelId);
-    if (meshIdsIt == m_meshIdsPerChannel.end())
-        throw std::runtime_error(fmt::format("Model has no channelID {}", channelId));
-    return meshIdsIt->second;
+    if (channelId >= m_channels.size())
+        throw std::runtime_error(fmt::format("Animation '{}' has no channel {}", m_name, channelId));
+    return m_channels[channelId];
 }
 
-void AnimationPrimitive::addKeyframe(uint32_t channelId, AnimationKeyFrame keyFrame)
+AnimationChannelKeys AnimationPrimitive::channelKeys(uint32_t channelId) const
 {
-    auto channelIt = m_keyframes.find(channelId);
-    if (channelIt == m_keyframes.end()) // new channel
+    const auto& ch = channel(channelId);
+    AnimationChannelKeys keys;
+    keys.positionTimes.assign(m_positionTimes.begin() + ch.positionOffset, m_positionTimes.begin() + ch.positionOffset + ch.positionCount);
+    keys.rotationTimes.assign(m_rotationTimes.begin() + ch.rotationOffset, m_rotationTimes.begin() + ch.rotationOffset + ch.rotationCount);
+    keys.scaleTimes.assign(m_scaleTimes.begin() + ch.scaleOffset, m_scaleTimes.begin() + ch.scaleOffset + ch.scaleCount);
+    keys.scales.assign(m_scales.begin() + ch.scaleOffset, m_scales.begin() + ch.scaleOffset + ch.scaleCount);
+    if (!m_compressed)
     {
-        m_keyframes.emplace(channelId, std::vector<AnimationKeyFrame>{keyFrame});
+        keys.positions.assign(m_positions.begin() + ch.positionOffset, m_positions.begin() + ch.positionOffset + ch.positionCount);
+        keys.rotations.assign(m_rotations.begin() + ch.rotationOffset, m_rotations.begin() + ch.rotationOffset + ch.rotationCount);
     }
-    else // existing channel
+    else
     {
-        channelIt->second.push_back(keyFrame);
+        for (uint32_t i = 0; i < ch.positionCount; i++)
+            keys.positions.push_back(unpackPosition(ch, m_packedPositions[ch.positionOffset + i]));
+        for (uint32_t i = 0; i < ch.rotationCount; i++)
+            keys.rotations.push_back(unpackQuat(m_packedRotations[ch.rotationOffset + i]));
     }
+    return keys;
 }
 
-AnimationKeyFrame AnimationPrimitive::keyframe(uint32_t channelId, double timecode) const
+int32_t AnimationPrimitive::channelNode(uint32_t channelId) const
 {
-    auto channelIt = m_keyframes.find(channelId);
-    if(channelIt == m_keyframes.end())
-        return AnimationKeyFrame();
+    return channel(channelId).node;
+}
 
-    const auto& keyframes = channelIt->second;
-    if (keyframes.size() == 0)
-        return AnimationKeyFrame();
-    if (timecode <= keyframes[0].time())
-    {
-        return keyframes[0];
-    }
-    if (timecode >= keyframes.back().time())
+int32_t AnimationPrimitive::channelBone(uint32_t channelId) const
+{
+    return channel(channelId).bone;
+}
+
+AnimationTransform AnimationPrimitive::sample(uint32_t channelId, double timecode, AnimationCursor* cursor) const
+{
+    const auto& ch = channel(channelId);
+    AnimationTransform result;
+    if (!m_compressed)
     {
-        return keyframes.back();
+        const glm::vec3* positions = m_positions.data() + ch.positionOffset;
+        const glm::quat* rotations = m_rotations.data() + ch.rotationOffset;
+        result.position = sampleTrack(m_positionTimes.data() + ch.positionOffset, ch.positionCount, timecode, cursor ? &cursor->position : nullptr,
+                                      result.position, [positions](uint32_t i) { return positions[i]; }, lerpVec3);
+        result.rotation = sampleTrack(m_rotationTimes.data() + ch.rotationOffset, ch.rotationCount, timecode, cursor ? &cursor->rotation : nullptr,
+                                      result.rotation, [rotations](uint32_t i) { return rotations[i]; }, slerpQuat);
     }
-
-    AnimationKeyFrame result;
-    for(size_t i = 1; i < keyframes.size(); i++)
+    else
     {
-        const auto& kf0 = keyframes.at(i-1);
-        const auto& kf1 = keyframes.at(i);
-
-        if (timecode >= kf0.time() && timecode < kf1.time())
-        {
-            float dt = static_cast<float>((timecode - kf0.time()) / (kf1.time() - kf0.time()));
-
-            glm::vec3 pos0, pos1;
-            glm::quat rot0, rot1;
-            glm::vec3 scl0, scl1;
-            glm::vec3 t0;
-            glm::vec4 t1;
-            glm::decompose(kf0.transform(), scl0, rot0, pos0, t0, t1);
-            glm::decompose(kf1.transform(), scl1, rot1, pos1, t0, t1);
-
-            glm::vec3 pos = glm::mix(pos0, pos1, dt);
-            glm::quat rot = glm::slerp(rot0, rot1, dt);
-            glm::vec3 scl = glm::mix(scl0, scl1, dt);
-
-            glm::mat4 trs = glm::translate(glm::mat4(1.f), pos) * glm::toMat4(rot) * glm::scale(glm::mat4(1.f), scl);
-            result = AnimationKeyFrame(trs, timecode);
-            break;
-        }
+        const PackedVec3* positions = m_packedPositions.data() + ch.positionOffset;
+        const PackedQuat* rotations = m_packedRotations.data() + ch.rotationOffset;
+        result.position = sampleTrack(m_positionTimes.data() + ch.positionOffset, ch.positionCount, timecode, cursor ? &cursor->position : nullptr,
+                                      result.position, [&ch, positions](uint32_t i) { return unpackPosition(ch, positions[i]); }, lerpVec3);
+        result.rotation = sampleTrack(m_rotationTimes.data() + ch.rotationOffset, ch.rotationCount, timecode, cursor ? &cursor->rotation : nullptr,
+                                      result.rotation, [rotations](uint32_t i) { return unpackQuat(rotations[i]); }, slerpQuat);
     }
+    const glm::vec3* scales = m_scales.data() + ch.scaleOffset;
+    result.scale = sampleTrack(m_scaleTimes.data() + ch.scaleOffset, ch.scaleCount, timecode, cursor ? &cursor->scale : nullptr,
+                               result.scale, [scales](uint32_t i) { return scales[i]; }, lerpVec3);
     return result;
 }
 
-AnimationKeyFrame::AnimationKeyFrame(const glm::mat4& trs, double time)
-    : m_time(time)
+AnimationCompressionReport AnimationPrimitive::compress(const AnimationCompressionSettings& settings)
 {
-    glm::vec3 pos;
-    glm::quat rot;
-    glm::vec3 scl;
-    
-    pos = trs[3];
-    for (int i = 0; i < 3; i++)
-        scl[i] = glm::length(glm::vec3(trs[i]));
-    const glm::mat3 rotMtx(
-        glm::vec3(trs[0]) / scl[0],
-        glm::vec3(trs[1]) / scl[1],
-        glm::vec3(trs[2]) / scl[2]);
-    rot = glm::quat_cast(rotMtx);
-
-    m_position = pos;
-    m_rotation = rot;
-    m_scale    = scl;
-}
+    AnimationCompressionReport report{};
+    report.bytesBefore = memoryUsage();
+    const AnimationPrimitive original = *this;
+
+    std::vector<AnimationChannelKeys> channelKeys(m_channels.size());
+    std::vector<int32_t> nodes(m_channels.size());
+    std::vector<int32_t> bones(m_channels.size());
+    for (uint32_t channelId = 0; channelId < m_channels.size(); channelId++)
+    {
+        channelKeys[channelId] = this->channelKeys(channelId);
+        nodes[channelId] = m_channels[channelId].node;
+        bones[channelId] = m_channels[channelId].bone;
+        report.keysBefore += m_channels[channelId].positionCount + m_channels[channelId].rotationCount + m_channels[channelId].scaleCount;
+    }
 
-AnimationKeyFrame::AnimationKeyFrame(double time)
-    : m_time(time)
-{}
+    // rebuild the flat arrays with the reduced keys, addChannel quantizes them
+    m_channels = {};
+    m_positionTimes = {};
+    m_positions = {};
+    m_rotationTimes = {};
+    m_rotations = {};
+    m_scaleTimes = {};
+    m_scales = {};
+    m_packedPositions = {};
+    m_packedRotations = {};
+    m_compressed = true;
+
+    auto vec3Distance = [](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); };
+    for (uint32_t channelId = 0; channelId < channelKeys.size(); channelId++)
+    {
+        auto& keys = channelKeys[channelId];
+        reduceKeys(keys.positionTimes, keys.positions, settings.positionTolerance, lerpVec3, vec3Distance);
+        reduceKeys(keys.rotationTimes, keys.rotations, settings.rotationTolerance, slerpQuat, rotationAngle);
+        reduceKeys(keys.scaleTimes, keys.scales, settings.scaleTolerance, lerpVec3, vec3Distance);
+        addChannel(keys, nodes[channelId], bones[channelId]);
+        report.keysAfter += static_cast<uint32_t>(keys.positions.size() + keys.rotations.size() + keys.scales.size());
+    }
+    report.bytesAfter = memoryUsage();
 
-void AnimationKeyFrame::setTime(double t)
-{
-    m_time = t;
+    // the source keys are where the reduced tracks deviate most
+    for (uint32_t channelId = 0; channelId < m_channels.size(); channelId++)
+    {
+        const auto& ch = original.m_channels[channelId];
+        auto compare = [&](double time) {
+            AnimationTransform exact = original.sample(channelId, time);
+            AnimationTransform approx = sample(channelId, time);
+            report.maxPositionError = std::max(report.maxPositionError, glm::length(exact.position - approx.position));
+            report.maxRotationError = std::max(report.maxRotationError, rotationAngle(exact.rotation, approx.rotation));
+            report.maxScaleError = std::max(report.maxScaleError, glm::length(exact.scale - approx.scale));
+        };
+        for (uint32_t i = 0; i < ch.positionCount; i++)
+            compare(original.m_positionTimes[ch.positionOffset + i]);
+        for (uint32_t i = 0; i < ch.rotationCount; i++)
+            compare(original.m_rotationTimes[ch.rotationOffset + i]);
+        for (uint32_t i = 0; i < ch.scaleCount; i++)
+            compare(original.m_scaleTimes[ch.scaleOffset + i]);
+    }
+    return report;
 }
 
-double AnimationKeyFrame::time() const
+bool AnimationPrimitive::compressed() const
 {
-    return m_time;
+    return m_compressed;
 }
 
-void AnimationKeyFrame::setPosition(const glm::vec3& pos)
+AnimationBakeReport AnimationPrimitive::bake(double rate)
 {
-    m_position = pos;
-}
+    if (rate <= 0.0)
+        throw std::runtime_error(fmt::format("Animation '{}' bake rate must be positive, got {}", m_name, rate));
+
+    clearBake();
+    AnimationBakeReport report{};
+    report.rate = rate;
+    report.keyBytes = memoryUsage();
+
+    // the last frame lands on or after the end of the clip, sampling clamps to the last keys
+    const uint32_t frames = static_cast<uint32_t>(std::ceil(m_duration * rate)) + 1;
+    const size_t channels = m_channels.size();
+    std::vector<glm::mat4> baked(frames * channels);
+    std::vector<AnimationCursor> cursors(channels);
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        double time = frame / rate;
+        for (uint32_t channelId = 0; channelId < channels; channelId++)
+            baked[frame * channels + channelId] = sample(channelId, time, &cursors[channelId]).matrix();
+    }
+    m_baked = std::move(baked);
+    m_bakedFrames = frames;
+    m_bakeRate = rate;
 
-const std::optional<glm::vec3>& AnimationKeyFrame::position() const
-{
-    return m_position;
+    report.frames = frames;
+    report.bakedBytes = m_baked.size() * sizeof(glm::mat4);
+    for (uint32_t frame = 0; frame + 1 < frames; frame++)
+    {
+        double time = (frame + 0.5) / rate;
+        AnimationBakedSample blended = sampleBaked(time);
+        for (uint32_t channelId = 0; channelId < channels; channelId++)
+        {
+            glm::mat4 exact = sample(channelId, time).matrix();
+            glm::mat4 approx = blended.channel(channelId);
+            report.maxTranslationError = std::max(report.maxTranslationError, glm::length(glm::vec3(exact[3] - approx[3])));
+            for (int column = 0; column < 3; column++)
+            {
+                glm::vec3 diff = glm::abs(glm::vec3(exact[column] - approx[column]));
+                report.maxMatrixError = std::max(report.maxMatrixError, std::max(diff.x, std::max(diff.y, diff.z)));
+            }
+        }
+    }
+    return report;
 }
 
-void AnimationKeyFrame::setRotation(const glm::quat& rot)
+void AnimationPrimitive::clearBake()
 {
-    m_rotation = rot;
+    m_baked.clear();
+    m_baked.shrink_to_fit();
+    m_bakedFrames = 0;
+    m_bakeRate = 0.0;
 }
 
-const std::optional<glm::quat>& AnimationKeyFrame::rotation() const
+bool AnimationPrimitive::baked() const
 {
-    return m_rotation;
+    return m_bakedFrames > 0;
 }
 
-void AnimationKeyFrame::setScale(const glm::vec3& scl)
+double AnimationPrimitive::bakeRate() const
 {
-    m_scale = scl;
+    return m_bakeRate;
 }
 
-const std::optional<glm::vec3>& AnimationKeyFrame::scale() const
+AnimationBakedSample AnimationPrimitive::sampleBaked(double timecode) const
 {
-    return m_scale;
+    if (!baked())
+        throw std::runtime_error(fmt::format("Animation '{}' is not baked", m_name));
+
+    const size_t channels = m_channels.size();
+    double position = std::clamp(timecode * m_bakeRate, 0.0, static_cast<double>(m_bakedFrames - 1));
+    uint32_t frame = std::min(static_cast<uint32_t>(position), m_bakedFrames - 1);
+    uint32_t next = std::min(frame + 1, m_bakedFrames - 1);
+    return AnimationBakedSample{m_baked.data() + frame * channels, m_baked.data() + next * channels,
+                                static_cast<float>(position - frame)};
 }
 
-glm::mat4 AnimationKeyFrame::transform() const
+size_t AnimationPrimitive::memoryUsage() const
 {
-    glm::mat4 result(1.f); // will contain TRS transformation matrix
-    if (m_position.has_value())
-        result = glm::translate(result, m_position.value());
-    if (m_rotation.has_value())
-        result *= glm::toMat4(m_rotation.value());
-    if (m_scale.has_value())
-        result = glm::scale(result, m_scale.value());
-
-    return result;
+    return m_baked.size() * sizeof(glm::mat4) +
+           m_channels.size() * sizeof(AnimationChannel) +
+           (m_positionTimes.size() + m_rotationTimes.size() + m_scaleTimes.size()) * sizeof(float) +
+           m_positions.size() * sizeof(glm::vec3) +
+           m_rotations.size() * sizeof(glm::quat) +
+           m_scales.size() * sizeof(glm::vec3) +
+           m_packedPositions.size() * sizeof(PackedVec3) +
+           m_packedRotations.size() * sizeof(PackedQuat);
 }
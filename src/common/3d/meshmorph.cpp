@@ -0,0 +1,132 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+
+#include "common/3d/meshmorph.hpp"
+
+MorphKey MeshMorph::makeKey(float amount, const std::vector<glm::vec3>& base, const std::vector<glm::vec3>& target)
+{
+    if(base.size() != target.size())
+        throw std::runtime_error(fmt::format("Morph target has {} vertices, base mesh has {}", target.size(), base.size()));
+
+    MorphKey key{};
+    key.amount = amount;
+
+    glm::vec3 maxOffset(0.f);
+    for(size_t i = 0; i < base.size(); i++)
+        maxOffset = glm::max(maxOffset, glm::abs(target[i] - base[i]));
+    // unused axes keep a non-zero scale, their offsets quantize to 0
+    key.scale = glm::max(maxOffset, glm::vec3(DELTA_EPSILON)) / 32767.f;
+
+    for(size_t i = 0; i < base.size(); i++)
+    {
+        glm::vec3 offset = target[i] - base[i];
+        glm::vec3 distance = glm::abs(offset);
+        if(distance.x <= DELTA_EPSILON && distance.y <= DELTA_EPSILON && distance.z <= DELTA_EPSILON)
+            continue;
+
+        glm::vec3 quantized = glm::round(offset / key.scale);
+        MorphDelta delta{};
+        delta.vertex = static_cast<uint32_t>(i);
+        for(int axis = 0; axis < 3; axis++)
+            delta.offset[axis] = static_cast<int16_t>(std::clamp(quantized[axis], -32767.f, 32767.f));
+        key.deltas.push_back(delta);
+    }
+    return key;
+}
+
+void MeshMorph::addTarget(const MorphTarget& target)
+{
+    MorphTarget sorted = target;
+    std::stable_sort(sorted.keys.begin(), sorted.keys.end(), [](const MorphKey& a, const MorphKey& b) {
+        return a.amount < b.amount;
+    });
+    m_targets.push_back(std::move(sorted));
+}
+
+size_t MeshMorph::targetCount() const
+{
+    return m_targets.size();
+}
+
+const MorphTarget& MeshMorph::target(size_t index) const
+{
+    if(index >= m_targets.size())
+        throw std::out_of_range("MeshMorph::target: index out of range");
+    return m_targets[index];
+}
+
+int32_t MeshMorph::findTarget(const std::string& name) const
+{
+    for(size_t i = 0; i < m_targets.size(); i++)
+    {
+        if(m_targets[i].name == name)
+            return static_cast<int32_t>(i);
+    }
+    return -1;
+}
+
+void MeshMorph::blend(uint32_t target, float amount, float weight, std::vector<MorphWeight>& weights) const
+{
+    const auto& keys = this->target(target).keys;
+    if(keys.empty() || amount <= 0.f || weight == 0.f)
+        return;
+
+    auto next = std::lower_bound(keys.begin(), keys.end(), amount, [](const MorphKey& key, float value) {
+        return key.amount < value;
+    });
+    if(next == keys.end())
+    {
+        weights.push_back(MorphWeight{target, static_cast<uint32_t>(keys.size() - 1), weight});
+        return;
+    }
+
+    uint32_t nextIdx = static_cast<uint32_t>(next - keys.begin());
+    // before the first key the target fades in from the base mesh
+    float prevAmount = nextIdx > 0 ? keys[nextIdx - 1].amount : 0.f;
+    float t = next->amount > prevAmount ? (amount - prevAmount) / (next->amount - prevAmount) : 1.f;
+    if(nextIdx > 0 && t < 1.f)
+        weights.push_back(MorphWeight{target, nextIdx - 1, weight * (1.f - t)});
+    weights.push_back(MorphWeight{target, nextIdx, weight * t});
+}
+
+void MeshMorph::apply(const std::vector<MorphWeight>& weights, std::vector<glm::vec3>& positions) const
+{
+    for(const auto& weight : weights)
+    {
+        const auto& key = target(weight.target).keys.at(weight.key);
+        if(!key.deltas.empty() && key.deltas.back().vertex >= positions.size())
+            throw std::runtime_error(fmt::format("Morph target '{}' needs {} vertices, got {}", m_targets[weight.target].name, key.deltas.back().vertex + 1, positions.size()));
+
+        // dequantization and weight folded into one multiply per axis
+        const glm::vec3 scale = key.scale * weight.weight;
+        for(const auto& delta : key.deltas)
+        {
+            positions[delta.vertex] += glm::vec3(delta.offset[0], delta.offset[1], delta.offset[2]) * scale;
+        }
+    }
+}
+
+size_t MeshMorph::deltaCount() const
+{
+    size_t count = 0;
+    for(const auto& target : m_targets)
+    {
+        for(const auto& key : target.keys)
+            count += key.deltas.size();
+    }
+    return count;
+}
+
+size_t MeshMorph::memoryUsage() const
+{
+    size_t bytes = 0;
+    for(const auto& target : m_targets)
+    {
+        bytes += target.name.size() + target.keys.size() * sizeof(MorphKey);
+        for(const auto& key : target.keys)
+            bytes += key.deltas.size() * sizeof(MorphDelta);
+    }
+    return bytes;
+}
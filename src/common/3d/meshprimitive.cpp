@@ -1,8 +1,31 @@
 #include <memory>
+#include <cstring>
+#include <algorithm>
+#include <limits>
 
 #include "common/3d/meshprimitive.hpp"
 
 
+BoundingVolume BoundingVolume::fromPoints(const std::vector<glm::vec3>& points)
+{
+    BoundingVolume bounds;
+    if(points.empty())
+        return bounds;
+
+    bounds.min = glm::vec3(std::numeric_limits<float>::max());
+    bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+    for(const auto& p : points)
+    {
+        bounds.min = glm::min(bounds.min, p);
+        bounds.max = glm::max(bounds.max, p);
+    }
+
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+    for(const auto& p : points)
+        bounds.radius = std::max(bounds.radius, glm::distance(bounds.center, p));
+    return bounds;
+}
+
 VertexPrimitive::VertexPrimitive(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoord)
     : m_position(position), m_normal(normal), m_texCoord(texCoord), m_type(VertexType::eTexture)
 {}
@@ -78,20 +101,48 @@ size_t MeshPrimitive::vertexCount() const
     return m_vertices.size();
 }
 
+const std::vector<VertexPrimitive>& MeshPrimitive::vertices() const
+{
+    return m_vertices;
+}
+
+size_t MeshPrimitive::vertexStride() const
+{
+    // position, normal, uv, meshId, bone indices, bone weights
+    return sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(uint32_t) +
+           sizeof(VertexInfluence::bones) + sizeof(VertexInfluence::weights);
+}
+
 const std::vector<char> MeshPrimitive::vertexData() const
 {
-    std::vector<char> dataBuffer(m_vertices.size() * (sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(uint32_t)));
+    std::vector<char> dataBuffer(m_vertices.size() * vertexStride());
+    writeVertexData(dataBuffer.data());
+    return dataBuffer;
+}
 
+void MeshPrimitive::writeVertexData(char* data, const std::vector<glm::vec3>* positions) const
+{
+    const size_t stride = vertexStride();
     uint32_t meshId = m_id;
+    const VertexInfluence rigid{};
 
     size_t offset = 0;
-    for (const auto& vertex : m_vertices)
+    for (size_t i = 0; i < m_vertices.size(); i++)
     {
-        memcpy(dataBuffer.data() + offset, vertex.data(), vertex.size());
-        memcpy(dataBuffer.data() + offset + vertex.size(), &meshId, sizeof(uint32_t));
-        offset += vertex.size() + sizeof(uint32_t);
+        const auto& vertex = m_vertices[i];
+        const auto& influence = m_influences.empty() ? rigid : m_influences[i];
+        char* dst = data + offset;
+        memcpy(dst, vertex.data(), vertex.size());
+        if (positions != nullptr)
+            memcpy(dst, &(*positions)[i], sizeof(glm::vec3));
+        dst += vertex.size();
+        memcpy(dst, &meshId, sizeof(uint32_t));
+        dst += sizeof(uint32_t);
+        memcpy(dst, influence.bones, sizeof(influence.bones));
+        dst += sizeof(influence.bones);
+        memcpy(dst, influence.weights, sizeof(influence.weights));
+        offset += stride;
     }
-    return dataBuffer;
 }
 
 void MeshPrimitive::addIndex(unsigned int index)
@@ -104,9 +155,59 @@ size_t MeshPrimitive::indexCount() const
     return m_indices.size();
 }
 
+const std::vector<uint32_t>& MeshPrimitive::indices() const
+{
+    return m_indices;
+}
+
 const std::vector<char> MeshPrimitive::indexData() const
 {
     std::vector<char> data(m_indices.size() * sizeof(uint32_t));
     memcpy(data.data(), m_indices.data(), data.size());
     return data;
-}
\ No newline at end of file
+}
+
+void MeshPrimitive::addInfluence(const VertexInfluence& influence)
+{
+    m_influences.push_back(influence);
+    for (int i = 0; i < 4; i++)
+    {
+        if (influence.weights[i] != 0.f)
+            m_requiredBoneCount = std::max(m_requiredBoneCount, static_cast<uint32_t>(influence.bones[i]) + 1);
+    }
+}
+
+bool MeshPrimitive::isSkinned() const
+{
+    return !m_influences.empty();
+}
+
+const std::vector<VertexInfluence>& MeshPrimitive::influences() const
+{
+    return m_influences;
+}
+
+uint32_t MeshPrimitive::requiredBoneCount() const
+{
+    return m_requiredBoneCount;
+}
+
+void MeshPrimitive::setMorph(std::shared_ptr<MeshMorph> morph)
+{
+    m_morph = morph;
+}
+
+std::shared_ptr<MeshMorph> MeshPrimitive::morph() const
+{
+    return m_morph;
+}
+
+void MeshPrimitive::setBounds(const BoundingVolume& bounds)
+{
+    m_bounds = bounds;
+}
+
+const BoundingVolume& MeshPrimitive::bounds() const
+{
+    return m_bounds;
+}
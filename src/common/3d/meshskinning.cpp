@@ -0,0 +1,143 @@
+#include <stdexcept>
+#include <fmt/format.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SKINNING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SKINNING_SSE
+#endif
+
+#include "common/3d/meshskinning.hpp"
+
+#if defined(SKINNING_AVX)
+// matrix as two halves: columns 0|1 and 2|3
+static inline void blendMatrix(const VertexInfluence& influence, const float* palette, __m256& lo, __m256& hi)
+{
+    const float* src = palette + influence.bones[0] * 16;
+    __m256 w = _mm256_set1_ps(influence.weights[0]);
+    lo = _mm256_mul_ps(_mm256_loadu_ps(src), w);
+    hi = _mm256_mul_ps(_mm256_loadu_ps(src + 8), w);
+    for (int k = 1; k < 4; k++)
+    {
+        if (influence.weights[k] == 0.f)
+            continue;
+        src = palette + influence.bones[k] * 16;
+        w = _mm256_set1_ps(influence.weights[k]);
+        lo = _mm256_add_ps(lo, _mm256_mul_ps(_mm256_loadu_ps(src), w));
+        hi = _mm256_add_ps(hi, _mm256_mul_ps(_mm256_loadu_ps(src + 8), w));
+    }
+}
+
+static inline __m256 splat2(float a, float b)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(a)), _mm_set1_ps(b), 1);
+}
+
+static inline glm::vec3 transform(const __m256& lo, const __m256& hi, const glm::vec3& v, float w)
+{
+    __m256 sum = _mm256_add_ps(_mm256_mul_ps(lo, splat2(v.x, v.y)), _mm256_mul_ps(hi, splat2(v.z, w)));
+    __m128 r = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    alignas(16) float out[4];
+    _mm_store_ps(out, r);
+    return glm::vec3(out[0], out[1], out[2]);
+}
+#elif defined(SKINNING_SSE)
+static inline void blendMatrix(const VertexInfluence& influence, const float* palette, __m128 m[4])
+{
+    const float* src = palette + influence.bones[0] * 16;
+    __m128 w = _mm_set1_ps(influence.weights[0]);
+    for (int c = 0; c < 4; c++)
+        m[c] = _mm_mul_ps(_mm_loadu_ps(src + c * 4), w);
+    for (int k = 1; k < 4; k++)
+    {
+        if (influence.weights[k] == 0.f)
+            continue;
+        src = palette + influence.bones[k] * 16;
+        w = _mm_set1_ps(influence.weights[k]);
+        for (int c = 0; c < 4; c++)
+            m[c] = _mm_add_ps(m[c], _mm_mul_ps(_mm_loadu_ps(src + c * 4), w));
+    }
+}
+
+static inline glm::vec3 transform(const __m128 m[4], const glm::vec3& v, float w)
+{
+    __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], _mm_set1_ps(v.x)), _mm_mul_ps(m[1], _mm_set1_ps(v.y))),
+                          _mm_add_ps(_mm_mul_ps(m[2], _mm_set1_ps(v.z)), _mm_mul_ps(m[3], _mm_set1_ps(w))));
+    alignas(16) float out[4];
+    _mm_store_ps(out, r);
+    return glm::vec3(out[0], out[1], out[2]);
+}
+#else
+static inline glm::mat4 blendMatrix(const VertexInfluence& influence, const std::vector<glm::mat4>& palette)
+{
+    glm::mat4 m = palette[influence.bones[0]] * influence.weights[0];
+    for (int k = 1; k < 4; k++)
+    {
+        if (influence.weights[k] != 0.f)
+            m += palette[influence.bones[k]] * influence.weights[k];
+    }
+    return m;
+}
+#endif
+
+void MeshSkinning::skin(const MeshPrimitive& mesh, const std::vector<glm::mat4>& palette,
+                        std::vector<glm::vec3>& positions, std::vector<glm::vec3>* normals)
+{
+    const auto& vertices = mesh.vertices();
+    positions.resize(vertices.size());
+    if (normals)
+        normals->resize(vertices.size());
+
+    if (!mesh.isSkinned())
+    {
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            positions[i] = vertices[i].position();
+            if (normals)
+                (*normals)[i] = vertices[i].normal();
+        }
+        return;
+    }
+
+    if (palette.size() < mesh.requiredBoneCount())
+        throw std::runtime_error(fmt::format("Mesh '{}' needs {} bones, palette has {}", mesh.name(), mesh.requiredBoneCount(), palette.size()));
+
+    const auto& influences = mesh.influences();
+#if defined(SKINNING_AVX) || defined(SKINNING_SSE)
+    const float* paletteData = &palette[0][0][0];
+#endif
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+#if defined(SKINNING_AVX)
+        __m256 lo, hi;
+        blendMatrix(influences[i], paletteData, lo, hi);
+        positions[i] = transform(lo, hi, vertices[i].position(), 1.f);
+        if (normals)
+            (*normals)[i] = glm::normalize(transform(lo, hi, vertices[i].normal(), 0.f));
+#elif defined(SKINNING_SSE)
+        __m128 m[4];
+        blendMatrix(influences[i], paletteData, m);
+        positions[i] = transform(m, vertices[i].position(), 1.f);
+        if (normals)
+            (*normals)[i] = glm::normalize(transform(m, vertices[i].normal(), 0.f));
+#else
+        glm::mat4 m = blendMatrix(influences[i], palette);
+        positions[i] = glm::vec3(m * glm::vec4(vertices[i].position(), 1.f));
+        if (normals)
+            (*normals)[i] = glm::normalize(glm::vec3(m * glm::vec4(vertices[i].normal(), 0.f)));
+#endif
+    }
+}
+
+const char* MeshSkinning::simdPath()
+{
+#if defined(SKINNING_AVX)
+    return "avx";
+#elif defined(SKINNING_SSE)
+    return "sse";
+#else
+    return "scalar";
+#endif
+}
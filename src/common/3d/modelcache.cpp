@@ -0,0 +1,418 @@
+#include <stdexcept>
+#include <cstring>
+#include <cctype>
+#include <type_traits>
+#include <fmt/format.h>
+
+#include "common/3d/modelcache.hpp"
+#include "common/3d/meshskinning.hpp"
+
+namespace
+{
+class CacheWriter
+{
+public:
+    template<typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        m_data.insert(m_data.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    void writeVector(const std::vector<T>& values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write(static_cast<uint32_t>(values.size()));
+        const char* bytes = reinterpret_cast<const char*>(values.data());
+        m_data.insert(m_data.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    void writeString(const std::string& value)
+    {
+        write(static_cast<uint32_t>(value.size()));
+        m_data.insert(m_data.end(), value.begin(), value.end());
+    }
+
+    std::vector<char>& data() { return m_data; }
+private:
+    std::vector<char> m_data;
+};
+
+class CacheReader
+{
+public:
+    CacheReader(const std::vector<char>& data)
+        : m_data(data), m_offset(0)
+    {}
+
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    std::vector<T> readVector()
+    {
+        uint32_t count = read<uint32_t>();
+        // checked before allocating, a corrupt count must not reserve gigabytes
+        const char* bytes = take(count * sizeof(T));
+        std::vector<T> values(count);
+        std::memcpy(values.data(), bytes, count * sizeof(T));
+        return values;
+    }
+
+    std::string readString()
+    {
+        uint32_t length = read<uint32_t>();
+        return std::string(take(length), length);
+    }
+private:
+    const char* take(size_t size)
+    {
+        if(m_offset + size > m_data.size())
+            throw std::runtime_error("Unexpected end of cooked model data");
+        const char* ptr = m_data.data() + m_offset;
+        m_offset += size;
+        return ptr;
+    }
+
+    const std::vector<char>& m_data;
+    size_t m_offset;
+};
+}
+
+std::string ModelCache::cookedPath(const std::string& sourcePath)
+{
+    std::string result = "cooked/";
+    result.reserve(result.size() + sourcePath.size() + 5);
+    for(char c : sourcePath)
+        result.push_back(c == '\\' ? '/' : static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    return result + ".cmdl";
+}
+
+std::vector<char> ModelCache::serialize(const ModelPrimitive& model)
+{
+    CacheWriter writer;
+    writer.data().insert(writer.data().end(), MODEL_CACHE_MAGIC, MODEL_CACHE_MAGIC + 4);
+    writer.write(VERSION);
+
+    writer.write(model.bounds());
+
+    auto skeleton = model.skeleton();
+    writer.write(static_cast<uint32_t>(skeleton ? skeleton->boneCount() : 0));
+    if(skeleton)
+    {
+        writer.write(skeleton->rootTransform());
+        for(size_t i = 0; i < skeleton->boneCount(); i++)
+        {
+            const auto& bone = skeleton->bone(i);
+            writer.writeString(bone.name);
+            writer.write(bone.parent);
+            writer.write(bone.translation);
+            writer.write(bone.rotation);
+            writer.write(bone.offset);
+        }
+    }
+
+    auto nodes = model.nodeTree();
+    writer.write(static_cast<uint32_t>(nodes ? nodes->nodeCount() : 0));
+    if(nodes)
+    {
+        for(size_t i = 0; i < nodes->nodeCount(); i++)
+        {
+            writer.writeString(nodes->nodeName(i));
+            writer.write(nodes->parents()[i]);
+            writer.write(nodes->bindLocals()[i]);
+        }
+        std::vector<int32_t> meshNodes(nodes->meshCount());
+        for(size_t slot = 0; slot < meshNodes.size(); slot++)
+            meshNodes[slot] = nodes->meshNode(static_cast<uint32_t>(slot));
+        writer.writeVector(meshNodes);
+    }
+
+    writer.write(static_cast<uint32_t>(model.meshCount()));
+    for(size_t i = 0; i < model.meshCount(); i++)
+    {
+        auto mesh = model.mesh(i);
+        writer.writeString(mesh->name());
+        writer.write(mesh->id());
+        writer.write(mesh->bounds());
+
+        writer.write(static_cast<uint32_t>(mesh->vertexCount()));
+        for(const auto& vertex : mesh->vertices())
+        {
+            writer.write(vertex.position());
+            writer.write(vertex.normal());
+            writer.write(vertex.texCoord());
+        }
+        writer.writeVector(mesh->indices());
+        writer.writeVector(mesh->influences());
+
+        auto morph = mesh->morph();
+        writer.write(static_cast<uint32_t>(morph ? morph->targetCount() : 0));
+        for(size_t t = 0; morph && t < morph->targetCount(); t++)
+        {
+            const auto& target = morph->target(t);
+            writer.writeString(target.name);
+            writer.write(static_cast<uint32_t>(target.keys.size()));
+            for(const auto& key : target.keys)
+            {
+                writer.write(key.amount);
+                writer.write(key.scale);
+                writer.writeVector(key.deltas);
+            }
+        }
+
+        auto bvh = model.meshBVH(i);
+        if(bvh && !bvh->empty())
+        {
+            writer.writeVector(bvh->nodes());
+            writer.writeVector(bvh->triangleOrder());
+        }
+        else
+        {
+            writer.write(uint32_t(0));
+            writer.write(uint32_t(0));
+        }
+    }
+
+    writer.write(static_cast<uint32_t>(model.lodCount()));
+    for(size_t i = 0; i < model.lodCount(); i++)
+    {
+        writer.write(model.lod(i).maxScreenSize);
+        writer.writeVector(model.lod(i).meshIds);
+    }
+
+    writer.write(static_cast<uint32_t>(model.animationCount()));
+    for(size_t i = 0; i < model.animationCount(); i++)
+    {
+        auto anim = model.animation(i);
+        writer.writeString(anim->name());
+        writer.write(anim->duration());
+        writer.write(static_cast<uint8_t>(anim->compressed()));
+
+        writer.write(static_cast<uint32_t>(anim->channelCount()));
+        for(uint32_t channelId = 0; channelId < anim->channelCount(); channelId++)
+        {
+            writer.write(anim->channelNode(channelId));
+            writer.write(anim->channelBone(channelId));
+
+            AnimationChannelKeys keys = anim->channelKeys(channelId);
+            writer.writeVector(keys.positionTimes);
+            writer.writeVector(keys.positions);
+            writer.writeVector(keys.rotationTimes);
+            writer.writeVector(keys.rotations);
+            writer.writeVector(keys.scaleTimes);
+            writer.writeVector(keys.scales);
+        }
+    }
+
+    writer.write(static_cast<uint32_t>(model.morphAnimationCount()));
+    for(size_t i = 0; i < model.morphAnimationCount(); i++)
+    {
+        auto anim = model.morphAnimation(i);
+        writer.writeString(anim->name());
+        writer.write(anim->duration());
+        writer.write(static_cast<uint32_t>(anim->trackCount()));
+        for(size_t t = 0; t < anim->trackCount(); t++)
+        {
+            const auto& track = anim->track(t);
+            writer.write(track.mesh);
+            writer.write(track.target);
+            writer.writeVector(track.times);
+            writer.writeVector(track.poses);
+        }
+    }
+    return std::move(writer.data());
+}
+
+std::shared_ptr<ModelPrimitive> ModelCache::deserialize(const std::vector<char>& data)
+{
+    if(data.size() < 8 || std::memcmp(data.data(), MODEL_CACHE_MAGIC, 4) != 0)
+        throw std::runtime_error("Invalid cooked model data");
+
+    CacheReader reader(data);
+    reader.read<uint32_t>(); // magic
+    uint32_t version = reader.read<uint32_t>();
+    if(version != VERSION)
+        throw std::runtime_error(fmt::format("Cooked model version {} is not supported (expected {})", version, VERSION));
+
+    auto model = std::make_shared<ModelPrimitive>();
+    model->setBounds(reader.read<BoundingVolume>());
+
+    uint32_t boneCount = reader.read<uint32_t>();
+    if(boneCount > 0)
+    {
+        auto skeleton = std::make_shared<ModelSkeleton>();
+        skeleton->setRootTransform(reader.read<glm::mat4>());
+        for(uint32_t i = 0; i < boneCount; i++)
+        {
+            SkeletonBone bone{};
+            bone.name = reader.readString();
+            bone.parent = reader.read<int32_t>();
+            bone.translation = reader.read<glm::vec3>();
+            bone.rotation = reader.read<glm::quat>();
+            bone.offset = reader.read<glm::mat4>();
+            skeleton->addBone(bone);
+        }
+        model->setSkeleton(skeleton);
+    }
+
+    uint32_t nodeCount = reader.read<uint32_t>();
+    if(nodeCount > 0)
+    {
+        auto nodes = std::make_shared<ModelNodeTree>();
+        for(uint32_t i = 0; i < nodeCount; i++)
+        {
+            std::string name = reader.readString();
+            int32_t parent = reader.read<int32_t>();
+            nodes->addNode(name, parent, reader.read<glm::mat4>());
+        }
+        auto meshNodes = reader.readVector<int32_t>();
+        for(size_t slot = 0; slot < meshNodes.size(); slot++)
+        {
+            if(meshNodes[slot] >= static_cast<int32_t>(nodeCount))
+                throw std::runtime_error(fmt::format("Cooked mesh {} is attached to missing node {}", slot, meshNodes[slot]));
+            nodes->attachMesh(static_cast<uint32_t>(slot), meshNodes[slot]);
+        }
+        model->setNodeTree(nodes);
+    }
+
+    uint32_t meshCount = reader.read<uint32_t>();
+    for(uint32_t i = 0; i < meshCount; i++)
+    {
+        std::string name = reader.readString();
+        uint32_t id = reader.read<uint32_t>();
+        auto mesh = std::make_shared<MeshPrimitive>(name, id);
+        mesh->setBounds(reader.read<BoundingVolume>());
+
+        uint32_t vertexCount = reader.read<uint32_t>();
+        for(uint32_t j = 0; j < vertexCount; j++)
+        {
+            glm::vec3 pos = reader.read<glm::vec3>();
+            glm::vec3 norm = reader.read<glm::vec3>();
+            glm::vec2 tex = reader.read<glm::vec2>();
+            mesh->addVertex(VertexPrimitive(pos, norm, tex));
+        }
+        for(uint32_t index : reader.readVector<uint32_t>())
+        {
+            if(index >= vertexCount)
+                throw std::runtime_error(fmt::format("Cooked mesh '{}' references vertex {} of {}", name, index, vertexCount));
+            mesh->addIndex(index);
+        }
+        for(const auto& influence : reader.readVector<VertexInfluence>())
+            mesh->addInfluence(influence);
+
+        uint32_t targetCount = reader.read<uint32_t>();
+        if(targetCount > 0)
+        {
+            auto morph = std::make_shared<MeshMorph>();
+            for(uint32_t t = 0; t < targetCount; t++)
+            {
+                MorphTarget target{};
+                target.name = reader.readString();
+                uint32_t keyCount = reader.read<uint32_t>();
+                for(uint32_t k = 0; k < keyCount; k++)
+                {
+                    MorphKey key{};
+                    key.amount = reader.read<float>();
+                    key.scale = reader.read<glm::vec3>();
+                    key.deltas = reader.readVector<MorphDelta>();
+                    target.keys.push_back(std::move(key));
+                }
+                morph->addTarget(target);
+            }
+            mesh->setMorph(morph);
+        }
+
+        auto nodes = reader.readVector<BVHNode>();
+        auto triangleOrder = reader.readVector<uint32_t>();
+        model->addMesh(mesh);
+
+        // BVHs are refit to the bind pose of skinned meshes
+        std::vector<glm::vec3> positions;
+        MeshSkinning::skin(*mesh, model->skeleton() ? model->skeleton()->bindPalette() : std::vector<glm::mat4>{}, positions);
+
+        auto bvh = std::make_shared<TriangleBVH>();
+        if(!nodes.empty())
+            bvh->build(positions, mesh->indices(), nodes, triangleOrder);
+        else
+            bvh->build(positions, mesh->indices());
+        model->setMeshBVH(i, bvh);
+    }
+
+    // slots attached to the node tree are looked up per mesh when drawing and raycasting
+    if(model->nodeTree() && model->nodeTree()->meshCount() > meshCount)
+        throw std::runtime_error(fmt::format("Cooked node tree attaches mesh {} of {}", model->nodeTree()->meshCount() - 1, meshCount));
+
+    uint32_t lodCount = reader.read<uint32_t>();
+    for(uint32_t i = 0; i < lodCount; i++)
+    {
+        ModelLOD lod{};
+        lod.maxScreenSize = reader.read<float>();
+        lod.meshIds = reader.readVector<uint32_t>();
+        for(uint32_t meshId : lod.meshIds)
+        {
+            if(meshId >= meshCount)
+                throw std::runtime_error(fmt::format("Cooked LOD {} references mesh {} of {}", i, meshId, meshCount));
+        }
+        model->addLOD(lod);
+    }
+
+    uint32_t animationCount = reader.read<uint32_t>();
+    for(uint32_t i = 0; i < animationCount; i++)
+    {
+        std::string name = reader.readString();
+        double duration = reader.read<double>();
+        auto anim = std::make_shared<AnimationPrimitive>(name, duration);
+        // keys were reduced when cooking, compressing the empty clip only makes addChannel quantize them again
+        if(reader.read<uint8_t>() != 0)
+            anim->compress(AnimationCompressionSettings{});
+
+        uint32_t channelCount = reader.read<uint32_t>();
+        for(uint32_t j = 0; j < channelCount; j++)
+        {
+            int32_t node = reader.read<int32_t>();
+            int32_t bone = reader.read<int32_t>();
+
+            AnimationChannelKeys keys;
+            keys.positionTimes = reader.readVector<float>();
+            keys.positions = reader.readVector<glm::vec3>();
+            keys.rotationTimes = reader.readVector<float>();
+            keys.rotations = reader.readVector<glm::quat>();
+            keys.scaleTimes = reader.readVector<float>();
+            keys.scales = reader.readVector<glm::vec3>();
+            anim->addChannel(keys, node, bone);
+        }
+        model->addAnimation(anim);
+    }
+
+    uint32_t morphAnimationCount = reader.read<uint32_t>();
+    for(uint32_t i = 0; i < morphAnimationCount; i++)
+    {
+        std::string name = reader.readString();
+        double duration = reader.read<double>();
+        auto anim = std::make_shared<MorphAnimation>(name, duration);
+        uint32_t trackCount = reader.read<uint32_t>();
+        for(uint32_t j = 0; j < trackCount; j++)
+        {
+            MorphTrack track{};
+            track.mesh = reader.read<uint32_t>();
+            track.target = reader.read<uint32_t>();
+            track.times = reader.readVector<float>();
+            track.poses = reader.readVector<uint32_t>();
+            auto mesh = track.mesh < model->meshCount() ? model->mesh(track.mesh) : nullptr;
+            if(mesh == nullptr || mesh->morph() == nullptr || track.target >= mesh->morph()->targetCount())
+                throw std::runtime_error(fmt::format("Morph animation '{}' references missing target {} of mesh {}", name, track.target, track.mesh));
+            anim->addTrack(track);
+        }
+        model->addMorphAnimation(anim);
+    }
+    return model;
+}
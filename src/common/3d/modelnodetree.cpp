@@ -0,0 +1,122 @@
+#include <stdexcept>
+#include <fmt/format.h>
+#include <glm/gtx/matrix_decompose.hpp>
+
+#include "common/3d/modelnodetree.hpp"
+
+uint32_t ModelNodeTree::addNode(const std::string& name, int32_t parent, const glm::mat4& local)
+{
+    if (parent >= static_cast<int32_t>(m_parents.size()))
+        throw std::runtime_error(fmt::format("Node '{}' is added before its parent {}", name, parent));
+
+    glm::mat4 global = parent < 0 ? local : m_bindGlobals[parent] * local;
+    m_names.push_back(name);
+    m_parents.push_back(parent);
+    m_bindLocals.push_back(local);
+    m_bindGlobals.push_back(global);
+    m_inverseBindGlobals.push_back(glm::inverse(global));
+
+    glm::vec3 position, scale, skew;
+    glm::quat rotation;
+    glm::vec4 perspective;
+    glm::decompose(local, scale, rotation, position, skew, perspective);
+    m_bindPositions.push_back(position);
+    m_bindRotations.push_back(glm::normalize(rotation));
+    m_bindScales.push_back(scale);
+    return static_cast<uint32_t>(m_parents.size() - 1);
+}
+
+size_t ModelNodeTree::nodeCount() const
+{
+    return m_parents.size();
+}
+
+const std::string& ModelNodeTree::nodeName(size_t index) const
+{
+    if (index >= m_names.size())
+        throw std::runtime_error(fmt::format("Node tree doesn't contain node {}", index));
+    return m_names[index];
+}
+
+int32_t ModelNodeTree::findNode(const std::string& name) const
+{
+    for (size_t i = 0; i < m_names.size(); i++)
+    {
+        if (m_names[i] == name)
+            return static_cast<int32_t>(i);
+    }
+    return -1;
+}
+
+const std::vector<int32_t>& ModelNodeTree::parents() const
+{
+    return m_parents;
+}
+
+const std::vector<glm::mat4>& ModelNodeTree::bindLocals() const
+{
+    return m_bindLocals;
+}
+
+const std::vector<glm::mat4>& ModelNodeTree::bindGlobals() const
+{
+    return m_bindGlobals;
+}
+
+const std::vector<glm::vec3>& ModelNodeTree::bindPositions() const
+{
+    return m_bindPositions;
+}
+
+const std::vector<glm::quat>& ModelNodeTree::bindRotations() const
+{
+    return m_bindRotations;
+}
+
+const std::vector<glm::vec3>& ModelNodeTree::bindScales() const
+{
+    return m_bindScales;
+}
+
+void ModelNodeTree::attachMesh(uint32_t meshSlot, int32_t node)
+{
+    if (node >= static_cast<int32_t>(m_parents.size()))
+        throw std::runtime_error(fmt::format("Mesh {} is attached to missing node {}", meshSlot, node));
+    if (meshSlot >= m_meshNodes.size())
+        m_meshNodes.resize(meshSlot + 1, -1);
+    m_meshNodes[meshSlot] = node;
+}
+
+int32_t ModelNodeTree::meshNode(uint32_t meshSlot) const
+{
+    return meshSlot < m_meshNodes.size() ? m_meshNodes[meshSlot] : -1;
+}
+
+size_t ModelNodeTree::meshCount() const
+{
+    return m_meshNodes.size();
+}
+
+void ModelNodeTree::computeGlobals(const std::vector<glm::mat4>& locals, std::vector<glm::mat4>& globals) const
+{
+    if (locals.size() < m_parents.size())
+        throw std::runtime_error(fmt::format("Node tree needs {} local transforms, got {}", m_parents.size(), locals.size()));
+
+    // parents come first, their globals are final when a child reads them
+    globals.resize(m_parents.size());
+    for (size_t i = 0; i < m_parents.size(); i++)
+    {
+        int32_t parent = m_parents[i];
+        globals[i] = parent < 0 ? locals[i] : globals[parent] * locals[i];
+    }
+}
+
+void ModelNodeTree::computeMeshPalette(const std::vector<glm::mat4>& globals, std::vector<glm::mat4>& meshTransforms) const
+{
+    meshTransforms.resize(m_meshNodes.size());
+    for (size_t slot = 0; slot < m_meshNodes.size(); slot++)
+    {
+        int32_t node = m_meshNodes[slot];
+        meshTransforms[slot] = node < 0 ? glm::mat4(1.f) : globals[node] * m_inverseBindGlobals[node];
+    }
+}
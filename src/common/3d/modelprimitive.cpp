@@ -7,6 +7,7 @@
 void ModelPrimitive::addMesh(std::shared_ptr<MeshPrimitive> mesh)
 {
     m_meshes.push_back(mesh);
+    m_meshBVHs.push_back(nullptr);
 }
 
 void ModelPrimitive::addAnimation(std::shared_ptr<AnimationPrimitive> anim)
@@ -72,3 +73,144 @@ std::shared_ptr<AnimationPrimitive> ModelPrimitive::animation(const std::string&
     throw std::runtime_error(fmt::format("Model doesn't contain animation '{}'", name));
 }
 
+void ModelPrimitive::addMorphAnimation(std::shared_ptr<MorphAnimation> anim)
+{
+    m_morphAnimations.push_back(anim);
+}
+
+size_t ModelPrimitive::morphAnimationCount() const
+{
+    return m_morphAnimations.size();
+}
+
+std::shared_ptr<MorphAnimation> ModelPrimitive::morphAnimation(size_t index) const
+{
+    if (index >= m_morphAnimations.size())
+        throw std::runtime_error(fmt::format("Model doesn't contain morph animID {}", index));
+    return m_morphAnimations.at(index);
+}
+
+std::shared_ptr<MorphAnimation> ModelPrimitive::morphAnimation(const std::string& name) const
+{
+    for (auto anim : m_morphAnimations)
+    {
+        if (anim->name() == name)
+            return anim;
+    }
+    throw std::runtime_error(fmt::format("Model doesn't contain morph animation '{}'", name));
+}
+
+void ModelPrimitive::addLOD(const ModelLOD& lod)
+{
+    m_lods.push_back(lod);
+}
+
+size_t ModelPrimitive::lodCount() const
+{
+    return m_lods.size();
+}
+
+const ModelLOD& ModelPrimitive::lod(size_t index) const
+{
+    if (index >= m_lods.size())
+        throw std::runtime_error(fmt::format("Model doesn't contain LOD {}", index));
+    return m_lods.at(index);
+}
+
+size_t ModelPrimitive::selectLOD(float screenSize) const
+{
+    // pick the cheapest level whose screen size limit is not exceeded
+    for (size_t i = 0; i < m_lods.size(); i++)
+    {
+        if (screenSize <= m_lods[i].maxScreenSize)
+            return i;
+    }
+    return m_lods.empty() ? 0 : m_lods.size() - 1;
+}
+
+void ModelPrimitive::setBounds(const BoundingVolume& bounds)
+{
+    m_bounds = bounds;
+}
+
+const BoundingVolume& ModelPrimitive::bounds() const
+{
+    return m_bounds;
+}
+
+const glm::vec3& ModelPrimitive::boundingCenter() const
+{
+    return m_bounds.center;
+}
+
+float ModelPrimitive::boundingRadius() const
+{
+    return m_bounds.radius;
+}
+
+void ModelPrimitive::setSkeleton(std::shared_ptr<ModelSkeleton> skeleton)
+{
+    m_skeleton = skeleton;
+}
+
+std::shared_ptr<ModelSkeleton> ModelPrimitive::skeleton() const
+{
+    return m_skeleton;
+}
+
+void ModelPrimitive::setNodeTree(std::shared_ptr<ModelNodeTree> nodes)
+{
+    m_nodeTree = nodes;
+}
+
+std::shared_ptr<ModelNodeTree> ModelPrimitive::nodeTree() const
+{
+    return m_nodeTree;
+}
+
+void ModelPrimitive::setMeshBVH(size_t index, std::shared_ptr<TriangleBVH> bvh)
+{
+    if (index >= m_meshBVHs.size())
+        throw std::runtime_error(fmt::format("Model doesn't contain meshID {}", index));
+    m_meshBVHs[index] = bvh;
+}
+
+std::shared_ptr<TriangleBVH> ModelPrimitive::meshBVH(size_t index) const
+{
+    if (index >= m_meshBVHs.size())
+        throw std::runtime_error(fmt::format("Model doesn't contain meshID {}", index));
+    return m_meshBVHs.at(index);
+}
+
+bool ModelPrimitive::raycast(const RaySegment& ray, ModelRayHit& hit) const
+{
+    RaySegment segment = ray;
+    bool found = false;
+    auto testMesh = [&](uint32_t meshId) {
+        // LOD lists may name meshes the model doesn't have
+        if (meshId >= m_meshBVHs.size())
+            return;
+        const auto& bvh = m_meshBVHs[meshId];
+        TriangleHit triHit;
+        if (bvh == nullptr || !bvh->intersect(segment, triHit))
+            return;
+        segment.maxT = triHit.t;
+        hit.t = triHit.t;
+        hit.meshId = meshId;
+        hit.triangle = triHit.triangle;
+        hit.point = triHit.point;
+        found = true;
+    };
+
+    if (m_lods.empty())
+    {
+        for (uint32_t meshId = 0; meshId < m_meshBVHs.size(); meshId++)
+            testMesh(meshId);
+    }
+    else
+    {
+        for (uint32_t meshId : m_lods.back().meshIds)
+            testMesh(meshId);
+    }
+    return found;
+}
@@ -0,0 +1,78 @@
+#include <stdexcept>
+#include <fmt/format.h>
+#include <glm/gtx/quaternion.hpp>
+
+#include "common/3d/modelskeleton.hpp"
+
+void ModelSkeleton::addBone(const SkeletonBone& bone)
+{
+    if (bone.parent >= static_cast<int32_t>(m_bones.size()))
+        throw std::runtime_error(fmt::format("Bone '{}' is added before its parent {}", bone.name, bone.parent));
+    m_bones.push_back(bone);
+    m_bindLocals.push_back(glm::translate(glm::mat4(1.f), bone.translation) * glm::toMat4(bone.rotation));
+    updateBindPalette();
+}
+
+size_t ModelSkeleton::boneCount() const
+{
+    return m_bones.size();
+}
+
+const SkeletonBone& ModelSkeleton::bone(size_t index) const
+{
+    if (index >= m_bones.size())
+        throw std::runtime_error(fmt::format("Skeleton doesn't contain bone {}", index));
+    return m_bones[index];
+}
+
+int32_t ModelSkeleton::findBone(const std::string& name) const
+{
+    for (size_t i = 0; i < m_bones.size(); i++)
+    {
+        if (m_bones[i].name == name)
+            return static_cast<int32_t>(i);
+    }
+    return -1;
+}
+
+void ModelSkeleton::setRootTransform(const glm::mat4& transform)
+{
+    m_rootTransform = transform;
+    updateBindPalette();
+}
+
+const glm::mat4& ModelSkeleton::rootTransform() const
+{
+    return m_rootTransform;
+}
+
+const std::vector<glm::mat4>& ModelSkeleton::bindLocalTransforms() const
+{
+    return m_bindLocals;
+}
+
+void ModelSkeleton::computePalette(const std::vector<glm::mat4>& locals, std::vector<glm::mat4>& palette) const
+{
+    if (locals.size() < m_bones.size())
+        throw std::runtime_error(fmt::format("Skeleton needs {} local transforms, got {}", m_bones.size(), locals.size()));
+
+    // parents come first, so the palette holds root * global transforms when a child reads it
+    palette.resize(m_bones.size());
+    for (size_t i = 0; i < m_bones.size(); i++)
+    {
+        int32_t parent = m_bones[i].parent;
+        palette[i] = (parent < 0 ? m_rootTransform : palette[parent]) * locals[i];
+    }
+    for (size_t i = 0; i < m_bones.size(); i++)
+        palette[i] = palette[i] * m_bones[i].offset;
+}
+
+const std::vector<glm::mat4>& ModelSkeleton::bindPalette() const
+{
+    return m_bindPalette;
+}
+
+void ModelSkeleton::updateBindPalette()
+{
+    computePalette(m_bindLocals, m_bindPalette);
+}
@@ -0,0 +1,93 @@
+#include <stdexcept>
+#include <algorithm>
+#include <fmt/format.h>
+
+#include "common/3d/morphanimation.hpp"
+
+MorphAnimation::MorphAnimation(const std::string& name, double duration)
+    : m_name(name), m_duration(duration)
+{
+}
+
+const std::string& MorphAnimation::name() const
+{
+    return m_name;
+}
+
+double MorphAnimation::duration() const
+{
+    return m_duration;
+}
+
+void MorphAnimation::addTrack(const MorphTrack& track)
+{
+    if(track.times.size() != track.poses.size())
+        throw std::runtime_error(fmt::format("Morph animation '{}' track has {} times and {} poses", m_name, track.times.size(), track.poses.size()));
+    if(!std::is_sorted(track.times.begin(), track.times.end()))
+        throw std::runtime_error(fmt::format("Morph animation '{}' track times are not ascending", m_name));
+    m_tracks.push_back(track);
+}
+
+size_t MorphAnimation::trackCount() const
+{
+    return m_tracks.size();
+}
+
+const MorphTrack& MorphAnimation::track(size_t index) const
+{
+    if(index >= m_tracks.size())
+        throw std::out_of_range("MorphAnimation::track: index out of range");
+    return m_tracks[index];
+}
+
+bool MorphAnimation::drives(uint32_t mesh) const
+{
+    return std::any_of(m_tracks.begin(), m_tracks.end(), [mesh](const MorphTrack& track) { return track.mesh == mesh; });
+}
+
+static void addPose(const MorphTrack& track, uint32_t pose, float weight, std::vector<MorphWeight>& weights)
+{
+    // the base mesh adds nothing
+    if(pose > 0 && weight > 0.f)
+        weights.push_back(MorphWeight{track.target, pose - 1, weight});
+}
+
+void MorphAnimation::sample(uint32_t mesh, double timecode, std::vector<MorphWeight>& weights) const
+{
+    float time = static_cast<float>(timecode);
+    for(const auto& track : m_tracks)
+    {
+        if(track.mesh != mesh || track.times.empty())
+            continue;
+
+        auto next = std::upper_bound(track.times.begin(), track.times.end(), time);
+        if(next == track.times.begin())
+        {
+            addPose(track, track.poses.front(), 1.f, weights);
+            continue;
+        }
+        if(next == track.times.end())
+        {
+            addPose(track, track.poses.back(), 1.f, weights);
+            continue;
+        }
+
+        size_t nextIdx = static_cast<size_t>(next - track.times.begin());
+        float t = (time - track.times[nextIdx - 1]) / (track.times[nextIdx] - track.times[nextIdx - 1]);
+        if(track.poses[nextIdx - 1] == track.poses[nextIdx])
+        {
+            addPose(track, track.poses[nextIdx], 1.f, weights);
+            continue;
+        }
+        addPose(track, track.poses[nextIdx - 1], 1.f - t, weights);
+        addPose(track, track.poses[nextIdx], t, weights);
+    }
+}
+
+size_t MorphAnimation::memoryUsage() const
+{
+    size_t bytes = m_name.size() + m_tracks.size() * sizeof(MorphTrack);
+    for(const auto& track : m_tracks)
+        bytes += track.times.size() * sizeof(float) + track.poses.size() * sizeof(uint32_t);
+    return bytes;
+}
@@ -0,0 +1,392 @@
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <array>
+#include <cmath>
+#include <fmt/format.h>
+#include <glm/glm.hpp>
+
+#include "common/3d/trianglebvh.hpp"
+
+static constexpr uint32_t BVH_LEAF_FLAG = 0x80000000;
+static constexpr uint32_t BVH_MAX_LEAF_SIZE = 4;
+static constexpr uint32_t BVH_BIN_COUNT = 12;
+static constexpr uint32_t BVH_STACK_SIZE = 64;
+
+RaySegment RaySegment::fromPoints(const glm::vec3& from, const glm::vec3& to)
+{
+    return RaySegment{from, to - from, 1.f};
+}
+
+struct BVHBounds
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    void grow(const glm::vec3& p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void grow(const BVHBounds& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    float area() const
+    {
+        glm::vec3 e = max - min;
+        if (e.x < 0.f)
+            return 0.f;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+};
+
+void TriangleBVH::build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+{
+    m_nodes.clear();
+    m_vertices.clear();
+    m_depth = 0;
+
+    uint32_t triCount = static_cast<uint32_t>(indices.size() / 3);
+    m_triangleOrder.resize(triCount);
+    std::iota(m_triangleOrder.begin(), m_triangleOrder.end(), 0);
+    if (triCount == 0)
+        return;
+
+    std::vector<BVHBounds> triBounds(triCount);
+    std::vector<glm::vec3> centroids(triCount);
+    for (uint32_t i = 0; i < triCount; i++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+            triBounds[i].grow(positions.at(indices[i * 3 + k]));
+        centroids[i] = (triBounds[i].min + triBounds[i].max) * 0.5f;
+    }
+
+    m_nodes.reserve(triCount * 2);
+    m_nodes.push_back(BVHNode{glm::vec3(0.f), 0, glm::vec3(0.f), triCount});
+
+    // nodes waiting to be split hold their range in frontOrFirst/backOrCount
+    std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}}; // node, depth
+    while (!stack.empty())
+    {
+        auto [nodeId, depth] = stack.back();
+        stack.pop_back();
+        m_depth = std::max(m_depth, depth);
+
+        uint32_t first = m_nodes[nodeId].frontOrFirst;
+        uint32_t count = m_nodes[nodeId].backOrCount;
+
+        BVHBounds bounds, centroidBounds;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            bounds.grow(triBounds[m_triangleOrder[i]]);
+            centroidBounds.grow(centroids[m_triangleOrder[i]]);
+        }
+        m_nodes[nodeId].min = bounds.min;
+        m_nodes[nodeId].max = bounds.max;
+
+        auto makeLeaf = [&]() {
+            m_nodes[nodeId].frontOrFirst = first | BVH_LEAF_FLAG;
+            m_nodes[nodeId].backOrCount = count;
+        };
+
+        if (count <= BVH_MAX_LEAF_SIZE)
+        {
+            makeLeaf();
+            continue;
+        }
+
+        glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+
+        uint32_t mid = first;
+        if (extent[axis] > 0.f)
+        {
+            std::array<BVHBounds, BVH_BIN_COUNT> bins;
+            std::array<uint32_t, BVH_BIN_COUNT> binCounts{};
+            float scale = BVH_BIN_COUNT / extent[axis];
+            auto binOf = [&](uint32_t tri) {
+                uint32_t b = static_cast<uint32_t>((centroids[tri][axis] - centroidBounds.min[axis]) * scale);
+                return std::min(b, BVH_BIN_COUNT - 1);
+            };
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                uint32_t b = binOf(m_triangleOrder[i]);
+                bins[b].grow(triBounds[m_triangleOrder[i]]);
+                binCounts[b]++;
+            }
+
+            // sweep from the right to get the suffix areas
+            std::array<float, BVH_BIN_COUNT> rightArea{};
+            std::array<uint32_t, BVH_BIN_COUNT> rightCount{};
+            BVHBounds acc;
+            uint32_t accCount = 0;
+            for (uint32_t b = BVH_BIN_COUNT - 1; b > 0; b--)
+            {
+                acc.grow(bins[b]);
+                accCount += binCounts[b];
+                rightArea[b] = acc.area();
+                rightCount[b] = accCount;
+            }
+
+            float bestCost = std::numeric_limits<float>::max();
+            uint32_t bestSplit = 0;
+            BVHBounds left;
+            uint32_t leftCount = 0;
+            for (uint32_t b = 1; b < BVH_BIN_COUNT; b++)
+            {
+                left.grow(bins[b - 1]);
+                leftCount += binCounts[b - 1];
+                if (leftCount == 0 || rightCount[b] == 0)
+                    continue;
+                float cost = left.area() * leftCount + rightArea[b] * rightCount[b];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestSplit = b;
+                }
+            }
+
+            if (bestSplit != 0)
+            {
+                // traversal is considered as expensive as a single triangle test
+                float leafCost = bounds.area() * count;
+                if (bestCost + bounds.area() >= leafCost && count <= BVH_MAX_LEAF_SIZE * 4)
+                {
+                    makeLeaf();
+                    continue;
+                }
+                auto it = std::partition(m_triangleOrder.begin() + first, m_triangleOrder.begin() + first + count,
+                                         [&](uint32_t tri) { return binOf(tri) < bestSplit; });
+                mid = static_cast<uint32_t>(it - m_triangleOrder.begin());
+            }
+        }
+
+        // degenerate centroids, fall back to a median split
+        if (mid == first || mid == first + count)
+        {
+            mid = first + count / 2;
+            std::nth_element(m_triangleOrder.begin() + first, m_triangleOrder.begin() + mid, m_triangleOrder.begin() + first + count,
+                             [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+
+        uint32_t frontId = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(BVHNode{glm::vec3(0.f), first, glm::vec3(0.f), mid - first});
+        m_nodes.push_back(BVHNode{glm::vec3(0.f), mid, glm::vec3(0.f), first + count - mid});
+        m_nodes[nodeId].frontOrFirst = frontId;
+        m_nodes[nodeId].backOrCount = frontId + 1;
+
+        stack.push_back({frontId, depth + 1});
+        stack.push_back({frontId + 1, depth + 1});
+    }
+
+    buildTriangles(positions, indices);
+}
+
+void TriangleBVH::build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+                        const std::vector<BVHNode>& nodes, const std::vector<uint32_t>& triangleOrder)
+{
+    size_t triCount = indices.size() / 3;
+    for (uint32_t tri : triangleOrder)
+    {
+        if (tri >= triCount)
+            throw std::runtime_error(fmt::format("BVH references triangle {} of {}", tri, triCount));
+    }
+    for (uint32_t i = 0; i < nodes.size(); i++)
+    {
+        const BVHNode& node = nodes[i];
+        if (node.isLeaf() && (size_t)node.first() + node.backOrCount > triangleOrder.size())
+            throw std::runtime_error(fmt::format("BVH leaf {} range is out of bounds", i));
+        // children are always stored after their parent
+        if (!node.isLeaf() && (node.frontOrFirst <= i || node.backOrCount <= i ||
+                               node.frontOrFirst >= nodes.size() || node.backOrCount >= nodes.size()))
+            throw std::runtime_error(fmt::format("BVH node {} has invalid children", i));
+    }
+
+    m_nodes = nodes;
+    m_triangleOrder = triangleOrder;
+    buildTriangles(positions, indices);
+    m_depth = m_nodes.empty() ? 0 : refit(0);
+}
+
+void TriangleBVH::buildTriangles(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+{
+    m_vertices.resize(m_triangleOrder.size() * 3);
+    for (size_t i = 0; i < m_triangleOrder.size(); i++)
+    {
+        uint32_t tri = m_triangleOrder[i];
+        const glm::vec3& v0 = positions.at(indices[tri * 3 + 0]);
+        const glm::vec3& v1 = positions.at(indices[tri * 3 + 1]);
+        const glm::vec3& v2 = positions.at(indices[tri * 3 + 2]);
+        m_vertices[i * 3 + 0] = v0;
+        m_vertices[i * 3 + 1] = v1 - v0;
+        m_vertices[i * 3 + 2] = v2 - v0;
+    }
+}
+
+uint32_t TriangleBVH::refit(uint32_t nodeId)
+{
+    BVHNode& node = m_nodes[nodeId];
+    BVHBounds bounds;
+    uint32_t depth = 0;
+    if (node.isLeaf())
+    {
+        for (uint32_t i = node.first(); i < node.first() + node.backOrCount; i++)
+        {
+            const glm::vec3& v0 = m_vertices[i * 3];
+            bounds.grow(v0);
+            bounds.grow(v0 + m_vertices[i * 3 + 1]);
+            bounds.grow(v0 + m_vertices[i * 3 + 2]);
+        }
+    }
+    else
+    {
+        depth = std::max(refit(node.frontOrFirst), refit(node.backOrCount)) + 1;
+        bounds.grow(m_nodes[node.frontOrFirst].min);
+        bounds.grow(m_nodes[node.frontOrFirst].max);
+        bounds.grow(m_nodes[node.backOrCount].min);
+        bounds.grow(m_nodes[node.backOrCount].max);
+    }
+    node.min = bounds.min;
+    node.max = bounds.max;
+    return depth;
+}
+
+static inline float intersectBounds(const BVHNode& node, const glm::vec3& origin, const glm::vec3& invDir, float maxT)
+{
+    glm::vec3 t0 = (node.min - origin) * invDir;
+    glm::vec3 t1 = (node.max - origin) * invDir;
+    glm::vec3 tmin = glm::min(t0, t1);
+    glm::vec3 tmax = glm::max(t0, t1);
+    float tnear = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.f));
+    float tfar = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, maxT));
+    return tnear <= tfar ? tnear : std::numeric_limits<float>::max();
+}
+
+bool TriangleBVH::intersect(const RaySegment& ray, TriangleHit& hit) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    const glm::vec3 invDir = 1.f / ray.direction;
+    float bestT = ray.maxT;
+    uint32_t bestSlot = std::numeric_limits<uint32_t>::max();
+
+    // every level leaves at most one sibling behind, so depth + 1 entries always suffice
+    // unbalanced trees (cooked or imported ones too) go to the heap instead of dropping subtrees
+    uint32_t localStack[BVH_STACK_SIZE];
+    std::vector<uint32_t> deepStack;
+    uint32_t* stack = localStack;
+    if (m_depth >= BVH_STACK_SIZE)
+    {
+        deepStack.resize(m_depth + 1);
+        stack = deepStack.data();
+    }
+    uint32_t stackSize = 0;
+    if (intersectBounds(m_nodes[0], ray.origin, invDir, bestT) == std::numeric_limits<float>::max())
+        return false;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const BVHNode& node = m_nodes[stack[--stackSize]];
+        if (node.isLeaf())
+        {
+            for (uint32_t i = node.first(); i < node.first() + node.backOrCount; i++)
+            {
+                // Moller-Trumbore, two sided
+                const glm::vec3& v0 = m_vertices[i * 3];
+                const glm::vec3& e1 = m_vertices[i * 3 + 1];
+                const glm::vec3& e2 = m_vertices[i * 3 + 2];
+                glm::vec3 pvec = glm::cross(ray.direction, e2);
+                float det = glm::dot(e1, pvec);
+                if (std::fabs(det) < 1e-12f)
+                    continue;
+                float invDet = 1.f / det;
+                glm::vec3 tvec = ray.origin - v0;
+                float u = glm::dot(tvec, pvec) * invDet;
+                if (u < 0.f || u > 1.f)
+                    continue;
+                glm::vec3 qvec = glm::cross(tvec, e1);
+                float v = glm::dot(ray.direction, qvec) * invDet;
+                if (v < 0.f || u + v > 1.f)
+                    continue;
+                float t = glm::dot(e2, qvec) * invDet;
+                if (t >= 0.f && t < bestT)
+                {
+                    bestT = t;
+                    bestSlot = i;
+                }
+            }
+            continue;
+        }
+
+        uint32_t nearId = node.frontOrFirst, farId = node.backOrCount;
+        float nearT = intersectBounds(m_nodes[nearId], ray.origin, invDir, bestT);
+        float farT = intersectBounds(m_nodes[farId], ray.origin, invDir, bestT);
+        if (farT < nearT)
+        {
+            std::swap(nearId, farId);
+            std::swap(nearT, farT);
+        }
+        // push the far child first so the near one is visited next
+        if (farT != std::numeric_limits<float>::max())
+            stack[stackSize++] = farId;
+        if (nearT != std::numeric_limits<float>::max())
+            stack[stackSize++] = nearId;
+    }
+
+    if (bestSlot == std::numeric_limits<uint32_t>::max())
+        return false;
+
+    hit.t = bestT;
+    hit.triangle = m_triangleOrder[bestSlot];
+    hit.point = ray.origin + ray.direction * bestT;
+    return true;
+}
+
+bool TriangleBVH::empty() const
+{
+    return m_nodes.empty();
+}
+
+size_t TriangleBVH::nodeCount() const
+{
+    return m_nodes.size();
+}
+
+size_t TriangleBVH::triangleCount() const
+{
+    return m_triangleOrder.size();
+}
+
+uint32_t TriangleBVH::depth() const
+{
+    return m_depth;
+}
+
+const glm::vec3& TriangleBVH::boundsMin() const
+{
+    static const glm::vec3 zero(0.f);
+    return m_nodes.empty() ? zero : m_nodes[0].min;
+}
+
+const glm::vec3& TriangleBVH::boundsMax() const
+{
+    static const glm::vec3 zero(0.f);
+    return m_nodes.empty() ? zero : m_nodes[0].max;
+}
+
+const std::vector<BVHNode>& TriangleBVH::nodes() const
+{
+    return m_nodes;
+}
+
+const std::vector<uint32_t>& TriangleBVH::triangleOrder() const
+{
+    return m_triangleOrder;
+}
@@ -1,20 +1,31 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <cmath>
+#include <stdexcept>
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
 #include "common/entities/animatedmodel.hpp"
 #include "client/renderer.hpp"
 #include "common/entities/entity.hpp"
-#include "common/utils.hpp"
+#include "server/scene3d.hpp"
+#include "server/animationsystem.hpp"
 
 
 AnimatedModelComponent::AnimatedModelComponent(std::shared_ptr<Entity> parent)
-    : StaticMesh(parent), m_time(0.0), m_looping(false), m_shouldPlay(true), m_currentAnimation(nullptr)
+    : StaticMesh(parent), m_time(0.0), m_poseTime(0.0), m_looping(false), m_shouldPlay(true), m_currentAnimation(nullptr),
+      m_fadeTime(0.0), m_fadePoseTime(0.0), m_fadeLength(0.0), m_fadeDuration(0.0), m_animationSystem(nullptr),
+      m_updateTier(AnimationUpdateTier::Full), m_morphAnimation(nullptr), m_morphTime(0.0), m_morphLooping(true)
 {
-    m_name = "AnimatedModel_" + uuids::to_string(Utils::uuidGenerator());
+    static std::atomic<uint32_t> nextNameId{0};
+    m_name = "AnimatedModel_" + std::to_string(nextNameId++);
 }
 
 AnimatedModelComponent::~AnimatedModelComponent()
 {
-
+    if (m_animationSystem != nullptr)
+        m_animationSystem->cancel(this);
 }
 
 void AnimatedModelComponent::draw(Renderer *rend)
@@ -22,37 +33,52 @@ void AnimatedModelComponent::draw(Renderer *rend)
     if(!m_visible)
         return;
 
+    // only drawn instances pay for the morph
+    evaluateMorphs();
+
+    const auto& pose = this->pose();
+    const auto& bonePalette = pose.bonePalette.empty() ? bindPalette() : pose.bonePalette;
     if (m_currentAnimation == nullptr)
-        rend->queueRender(m_meshId, std::vector<size_t>{}, m_modelMatrix);
+        queueModel(rend, std::vector<glm::mat4>{}, bonePalette, m_morphPositions);
     else
-        rend->queueRender(m_meshId, std::vector<size_t>{}, m_modelMatrix, m_meshTransforms);
+        queueModel(rend, pose.meshTransforms, bonePalette, m_morphPositions);
 }
 
-void AnimatedModelComponent::update(double dt)
+// playback position after time passed, looping clips wrap and others hold their last frame
+// (AnimationPrimitive or MorphAnimation)
+template<typename Anim>
+static double layerTime(const Anim &anim, double time, bool looping)
 {
-    const glm::vec3& pos = m_parent.get()->getPosition();
-    const glm::quat& rot = m_parent.get()->getRotation();
-    const glm::vec3& scale = m_parent.get()->getScale();
+    double duration = anim.duration();
+    if (time < duration)
+        return time;
+    return looping && duration > 0.0 ? std::fmod(time, duration) : duration;
+}
 
-    m_modelMatrix = glm::translate(glm::mat4(1.f), pos) *
-                    glm::toMat4(rot) *
-                    glm::scale(glm::mat4(1.f), scale);
+void AnimatedModelComponent::update(double dt)
+{
+    updateMatrix();
+    updateLOD();
+    advanceMorph(dt);
 
-    if (m_currentAnimation == nullptr || !m_shouldPlay)
+    if (m_currentAnimation == nullptr || (!m_shouldPlay && !blending()))
         return;
 
-    for (uint32_t channelId = 0; channelId < m_currentAnimation->channelCount(); channelId++)
-    {
-        const auto& affectedMeshIds = m_currentAnimation->affectedMeshIds(channelId);
+    m_poseTime = m_time;
+    m_fadePoseTime = m_fadeTime;
+    m_fadeOut.poseTime = m_fadeOut.time;
+    for (auto &layer : m_additiveLayers)
+        layer.poseTime = layer.time;
 
-        auto keyframe = m_currentAnimation->keyframe(channelId, m_time);
-        uint32_t transformsCount = (*std::max_element(affectedMeshIds.begin(), affectedMeshIds.end())) + 1; // transformId is 0-indexed, so we add 1
-        m_meshTransforms.resize(std::max(static_cast<size_t>(transformsCount), m_meshTransforms.size()), glm::mat4(1.f));
-        for (uint32_t meshId : affectedMeshIds)
-        {
-            m_meshTransforms[meshId] = keyframe.transform();
-        }
-    }
+    Scene3D *scene = m_parent != nullptr ? m_parent->getParentScene() : nullptr;
+    if (scene != nullptr)
+        submitPose(scene->animations(), scene->getCamera(), dt);
+    else
+        evaluatePose();
+
+    advanceLayers(dt);
+    if (!m_shouldPlay)
+        return;
 
     m_time += dt;
     if (m_time >= m_currentAnimation->duration())
@@ -64,19 +90,254 @@ void AnimatedModelComponent::update(double dt)
     }
 }
 
-void AnimatedModelComponent::setAnimation(std::shared_ptr<AnimationPrimitive> anim)
+void AnimatedModelComponent::evaluatePose()
+{
+    if (m_currentAnimation == nullptr)
+        return;
+
+    m_sharedPose = nullptr;
+    evaluateLayers(m_pose, 0.0);
+}
+
+void AnimatedModelComponent::submitPose(AnimationSystem &animations, Camera3D &camera, double dt)
 {
-    if (m_currentAnimation != anim)
+    glm::vec3 center(0.f);
+    float radius = 0.f;
+    AnimationUpdateTier tier = worldBoundingSphere(center, radius) ? animations.selectTier(camera, center, radius, m_visible)
+                                                                   : AnimationUpdateTier::Full;
+
+    if (tier != AnimationUpdateTier::Reduced)
     {
-        m_currentAnimation = anim;
-        m_time = 0.0;
-        if (m_looping)
-            m_shouldPlay = true;
+        m_reduced.valid = false;
+        m_reduced.step = 0;
+    }
+    else if (m_reduced.step == 0)
+    {
+        // the pose at the end of the interval, assuming the frame time stays the same
+        m_reduced.interval = animations.lodSettings().reducedInterval;
+        m_reduced.offset = m_reduced.interval * dt;
+    }
+
+    animations.submit(this, tier);
+}
+
+void AnimatedModelComponent::evaluateOwnPose()
+{
+    if (m_updateTier == AnimationUpdateTier::Reduced)
+        advanceReducedPose();
+    else
+        evaluatePose();
+}
+
+void AnimatedModelComponent::advanceReducedPose()
+{
+    if (m_currentAnimation == nullptr)
+        return;
+
+    if (m_reduced.step == 0)
+    {
+        // the previous target was evaluated for about this time, only the first interval needs both ends
+        if (m_reduced.valid)
+            std::swap(m_reduced.from, m_reduced.to);
         else
-            m_shouldPlay = false;
+            evaluateLayers(m_reduced.from, 0.0);
+        evaluateLayers(m_reduced.to, m_reduced.offset);
+        m_reduced.valid = true;
+    }
+
+    m_pose.interpolate(m_reduced.from, m_reduced.to, static_cast<float>(m_reduced.step) / m_reduced.interval);
+    m_reduced.step = (m_reduced.step + 1) % m_reduced.interval;
+}
+
+bool AnimatedModelComponent::blending() const
+{
+    if (m_fadeOut.anim != nullptr)
+        return true;
+    return std::any_of(m_additiveLayers.begin(), m_additiveLayers.end(), [](const PlaybackLayer &layer) { return layer.anim != nullptr; });
+}
+
+void AnimatedModelComponent::buildLayers(double offset)
+{
+    m_layers.clear();
+    if (m_fadeOut.anim != nullptr)
+    {
+        double fadeOutTime = m_fadeOut.playing ? layerTime(*m_fadeOut.anim, m_fadeOut.poseTime + offset, m_fadeOut.looping) : m_fadeOut.poseTime;
+        m_layers.push_back(AnimationLayer{m_fadeOut.anim.get(), fadeOutTime, 1.f, false, m_fadeOut.cursors.data()});
+    }
+
+    double time = m_shouldPlay ? layerTime(*m_currentAnimation, m_poseTime + offset, m_looping) : m_poseTime;
+    float weight = 1.f;
+    if (m_fadeOut.anim != nullptr && m_fadeLength > 0.0)
+        weight = static_cast<float>(std::clamp((m_fadePoseTime + offset) / m_fadeLength, 0.0, 1.0));
+    m_layers.push_back(AnimationLayer{m_currentAnimation.get(), time, weight, false, m_cursors.data()});
+
+    for (auto &layer : m_additiveLayers)
+    {
+        if (layer.anim != nullptr)
+            m_layers.push_back(AnimationLayer{layer.anim.get(), layerTime(*layer.anim, layer.poseTime + offset, true), layer.weight, true, layer.cursors.data()});
+    }
+}
+
+void AnimatedModelComponent::evaluateLayers(AnimationPose &pose, double offset)
+{
+    buildLayers(offset);
+    // a single clip takes the plain path, which also uses baked frames
+    if (m_layers.size() == 1)
+        pose.evaluate(*m_layers[0].anim, nodeTree(), skeleton(), m_layers[0].timecode, m_layers[0].cursors);
+    else
+        pose.evaluateBlend(m_layers.data(), m_layers.size(), nodeTree(), skeleton());
+}
+
+void AnimatedModelComponent::advanceLayers(double dt)
+{
+    if (m_fadeOut.anim != nullptr)
+    {
+        if (m_fadeOut.playing)
+            m_fadeOut.time = layerTime(*m_fadeOut.anim, m_fadeOut.time + dt, m_fadeOut.looping);
+        m_fadeTime += dt;
+        if (m_fadeTime >= m_fadeLength)
+            m_fadeOut.anim = nullptr;
+    }
+
+    for (auto &layer : m_additiveLayers)
+    {
+        if (layer.anim != nullptr)
+            layer.time = layerTime(*layer.anim, layer.time + dt, true);
     }
 }
 
+void AnimatedModelComponent::advanceMorph(double dt)
+{
+    if (m_morphAnimation != nullptr)
+        m_morphTime = layerTime(*m_morphAnimation, m_morphTime + dt, m_morphLooping);
+}
+
+void AnimatedModelComponent::evaluateMorphs()
+{
+    if (m_morphAnimation == nullptr || m_model == nullptr)
+        return;
+
+    m_morphPositions.resize(m_model->meshCount());
+    for (uint32_t meshId = 0; meshId < m_model->meshCount(); meshId++)
+    {
+        auto &positions = m_morphPositions[meshId];
+        auto mesh = m_model->mesh(meshId);
+        if (mesh->morph() == nullptr || !m_morphAnimation->drives(meshId))
+        {
+            positions.clear();
+            continue;
+        }
+
+        m_morphWeights.clear();
+        m_morphAnimation->sample(meshId, m_morphTime, m_morphWeights);
+        const auto &vertices = mesh->vertices();
+        positions.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+            positions[i] = vertices[i].position();
+        mesh->morph()->apply(m_morphWeights, positions);
+    }
+}
+
+void AnimatedModelComponent::setMorphAnimation(std::shared_ptr<MorphAnimation> anim, bool looping)
+{
+    m_morphAnimation = anim;
+    m_morphTime = 0.0;
+    m_morphLooping = looping;
+    if (anim == nullptr)
+        m_morphPositions.clear();
+}
+
+double AnimatedModelComponent::morphTime() const
+{
+    return m_morphTime;
+}
+
+void AnimatedModelComponent::setAnimation(std::shared_ptr<AnimationPrimitive> anim)
+{
+    crossFade(anim, m_fadeDuration);
+}
+
+void AnimatedModelComponent::crossFade(std::shared_ptr<AnimationPrimitive> anim, double seconds)
+{
+    if (m_currentAnimation == anim)
+        return;
+    if (anim == nullptr || m_currentAnimation == nullptr || seconds <= 0.0)
+    {
+        switchAnimation(anim);
+        return;
+    }
+
+    // the current animation becomes the fading one, a fade still in progress is cut short
+    m_fadeOut.anim = m_currentAnimation;
+    m_fadeOut.time = m_time;
+    m_fadeOut.poseTime = m_poseTime;
+    m_fadeOut.playing = m_shouldPlay;
+    m_fadeOut.looping = m_looping;
+    std::swap(m_fadeOut.cursors, m_cursors);
+    m_fadeTime = 0.0;
+    m_fadePoseTime = 0.0;
+    m_fadeLength = seconds;
+
+    m_currentAnimation = anim;
+    m_cursors.assign(anim->channelCount(), AnimationCursor{});
+    m_reduced.valid = false;
+    m_reduced.step = 0;
+    m_time = 0.0;
+    m_poseTime = 0.0;
+    m_shouldPlay = m_looping;
+}
+
+void AnimatedModelComponent::switchAnimation(std::shared_ptr<AnimationPrimitive> anim)
+{
+    m_currentAnimation = anim;
+    m_cursors.assign(anim != nullptr ? anim->channelCount() : 0, AnimationCursor{});
+    m_fadeOut.anim = nullptr;
+    m_pose = AnimationPose{};
+    m_sharedPose = nullptr;
+    m_reduced = ReducedPose{};
+    m_time = 0.0;
+    m_poseTime = 0.0;
+    if (m_looping)
+        m_shouldPlay = true;
+    else
+        m_shouldPlay = false;
+}
+
+void AnimatedModelComponent::setFadeDuration(double seconds)
+{
+    m_fadeDuration = std::max(seconds, 0.0);
+}
+
+double AnimatedModelComponent::fadeDuration() const
+{
+    return m_fadeDuration;
+}
+
+void AnimatedModelComponent::setAdditiveLayer(uint32_t slot, std::shared_ptr<AnimationPrimitive> anim, float weight)
+{
+    if (slot >= m_additiveLayers.size())
+        m_additiveLayers.resize(slot + 1);
+
+    auto &layer = m_additiveLayers[slot];
+    if (layer.anim != anim)
+    {
+        layer.anim = anim;
+        layer.time = 0.0;
+        layer.poseTime = 0.0;
+        layer.cursors.assign(anim != nullptr ? anim->channelCount() : 0, AnimationCursor{});
+        m_reduced.valid = false;
+        m_reduced.step = 0;
+    }
+    layer.weight = weight;
+}
+
+void AnimatedModelComponent::setLayerWeight(uint32_t slot, float weight)
+{
+    if (slot >= m_additiveLayers.size())
+        throw std::runtime_error(fmt::format("Animated model has no additive layer {}", slot));
+    m_additiveLayers[slot].weight = weight;
+}
+
 bool AnimatedModelComponent::trigger()
 {
     if (m_currentAnimation == nullptr)
@@ -86,6 +347,8 @@ bool AnimatedModelComponent::trigger()
 
     m_time = 0.0;
     m_shouldPlay = true;
+    m_reduced.valid = false;
+    m_reduced.step = 0;
     return true;
 }
 
@@ -99,6 +362,21 @@ double AnimatedModelComponent::time() const
     return m_time;
 }
 
+const ModelNodeTree *AnimatedModelComponent::nodeTree() const
+{
+    return m_model != nullptr ? m_model->nodeTree().get() : nullptr;
+}
+
+const ModelSkeleton *AnimatedModelComponent::skeleton() const
+{
+    return m_model != nullptr ? m_model->skeleton().get() : nullptr;
+}
+
+const AnimationPose &AnimatedModelComponent::pose() const
+{
+    return m_sharedPose != nullptr ? *m_sharedPose : m_pose;
+}
+
 const char *AnimatedModelComponent::getName() const
 {
     return m_name.c_str();
@@ -1,13 +1,14 @@
 #include "common/entities/bulletbodycomponent.hpp"
 #include "common/entities/entity.hpp"
 #include "common/servicelocator.hpp"
+#include "common/objectpool.hpp"
 #include "server/bulletphysicsmanager.hpp"
 #include <glm/gtx/quaternion.hpp>
 
 
 std::shared_ptr<BodyComponent> BodyComponent::createComponent(const PhysicsBodyCreateInfo& cInfo, std::shared_ptr<Entity> parent)
 {
-    return std::make_shared<BulletBodyComponent>(cInfo, parent);
+    return clean::makePooled<BulletBodyComponent>(cInfo, parent);
 }
 
 BulletBodyComponent::BulletBodyComponent(const PhysicsBodyCreateInfo& cInfo, std::shared_ptr<Entity> parent)
@@ -40,7 +41,7 @@ void BulletBodyComponent::update(double dt)
 
     if(m_isDirty)
     {
-        Entity *ent = m_parent.get();
+        Entity *ent = m_parent;
         ent->setPosition(glm::vec3(m_position.x(), m_position.y(), m_position.z()));
         ent->setRotation(glm::quat(m_rotation.w(), m_rotation.x(), m_rotation.y(), m_rotation.z()));
         m_isDirty = false;
@@ -1,10 +1,12 @@
 #include "common/entities/camera3d.hpp"
 #include "common/servicelocator.hpp"
-#include "common/utils.hpp"
+#include "common/simd.hpp"
 
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/vector_angle.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 static const char *MODULE_NAME = "Camera3D";
 
@@ -13,7 +15,6 @@ Camera3D::Camera3D(float fov, float aspect, float znear, float zfar)
 {
     m_viewMatrix = glm::mat4(1);
     m_projectionMatrix = glm::mat4(1);
-    m_id = Utils::uuidGenerator();
 }
 
 void Camera3D::setPosition(const glm::vec3 &pos)
@@ -76,6 +77,37 @@ const glm::mat4 &Camera3D::getProjectionMatrix()
     return m_projectionMatrix.value();
 }
 
+float Camera3D::screenSize(const glm::vec3 &center, float radius) const
+{
+    float dist = glm::distance(center, m_position);
+    if(dist <= radius)
+        return 1.f;
+
+    // projected radius on the view plane at distance 1
+    float projRadius = radius / dist;
+    float halfHeight = std::tan(glm::radians(m_fov) * 0.5f);
+    float halfWidth = halfHeight * m_aspect;
+    return std::min(1.f, glm::pi<float>() * projRadius * projRadius / (4.f * halfWidth * halfHeight));
+}
+
+bool Camera3D::sphereInFrustum(const glm::vec3 &center, float radius)
+{
+    glm::vec4 planes[6];
+    frustumPlanes(planes);
+    for(const auto &plane : planes)
+    {
+        if(glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    }
+    return true;
+}
+
+void Camera3D::frustumPlanes(glm::vec4 planes[6])
+{
+    glm::mat4 viewProj = getProjectionMatrix() * getViewMatrix();
+    clean::simd::frustumPlanes(glm::value_ptr(viewProj), &planes[0].x);
+}
+
 void Camera3D::updateMatrices()
 {
     if(m_projectionMatrix.is_dirty())
@@ -2,7 +2,7 @@
 #include "common/entities/entity.hpp"
 
 Component::Component(std::shared_ptr<Entity> parent)
-    : m_parent(parent)
+    : m_parent(parent.get()), m_parentRef(parent), m_poolSlot(NO_SLOT)
 {
     
 }
@@ -13,11 +13,21 @@ Component::~Component()
 }
 
 std::shared_ptr<Entity> Component::getParent() const
+{
+    return m_parentRef.lock();
+}
+
+Entity *Component::getParentEntity() const
 {
     return m_parent;
 }
 
+bool Component::isPooled() const
+{
+    return m_poolSlot != NO_SLOT;
+}
+
 const char *Component::getName() const
 {
     return "Component";
-}
\ No newline at end of file
+}
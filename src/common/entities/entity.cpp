@@ -1,9 +1,15 @@
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
 #include "common/entities/entity.hpp"
-#include "common/utils.hpp"
+#include "common/entities/meshcomponent.hpp"
+#include "server/scene3d.hpp"
+#include <glm/gtx/transform.hpp>
 
 
 Entity::Entity()
-    : Entity(Utils::uuidGenerator())
+    : Entity(uuids::uuid())
 {
 }
 
@@ -12,33 +18,51 @@ Entity::Entity(const uuids::uuid &id)
       m_visible(true),
       m_position(glm::vec3(0.f)),
       m_rotation(glm::quat(glm::vec3(0.f))),
-      m_scale(glm::vec3(1.f))
+      m_scale(glm::vec3(1.f)),
+      m_worldMatrix(glm::mat4(1.f)),
+      m_parentedWorld(glm::mat4(1.f)),
+      m_transformSlot(TransformSystem::NO_SLOT),
+      m_parentScene(nullptr)
 {
 }
 
 Entity::~Entity()
 {
+    setScene(nullptr);
+    // components kept alive elsewhere (scripts) must not reach back into this entity
+    for(auto &comp : m_components)
+    {
+        comp->m_parent = nullptr;
+        comp->m_parentRef.reset();
+    }
     m_components.clear();
+
+    auto parent = m_parentEntity.lock();
+    if(parent != nullptr)
+        parent->m_children.erase(std::remove(parent->m_children.begin(), parent->m_children.end(), this), parent->m_children.end());
+    for(auto child : m_children)
+        child->m_parentEntity.reset();
 }
 
 void Entity::draw(Renderer *rend)
 {
-    if(!m_visible)
+    if(!m_visible || m_parentScene != nullptr)
         return;
 
-    for(auto it = m_components.begin(); it != m_components.end(); it++)
+    for(auto &comp : m_components)
     {
-        if(it->second->isDrawable()) {
-            it->second->draw(rend);
+        if(comp->isDrawable()) {
+            comp->draw(rend);
         }
     }
 }
 
 void Entity::update(double dt)
 {
-    for(auto it = m_components.begin(); it != m_components.end(); it++)
+    if(m_parentScene == nullptr)
     {
-        it->second->update(dt);
+        for(auto &comp : m_components)
+            comp->update(dt);
     }
     m_updateEvents(this, dt);
 }
@@ -48,11 +72,26 @@ const uuids::uuid& Entity::getID() const
     return m_id;
 }
 
+bool Entity::hasID() const
+{
+    return !m_id.is_nil();
+}
+
+EntityHandle Entity::getHandle() const
+{
+    return m_handle;
+}
+
 void Entity::setVisible(bool yes)
 {
     m_visible = yes;
 }
 
+bool Entity::isVisible() const
+{
+    return m_visible;
+}
+
 void Entity::destroy()
 {
     m_destroyEvents(this);
@@ -61,11 +100,19 @@ void Entity::destroy()
 void Entity::setPosition(const glm::vec3 &pos)
 {
     m_position = pos;
+    if(m_transformSlot != TransformSystem::NO_SLOT)
+        m_parentScene->transforms().setPosition(m_transformSlot, pos);
+    else
+        m_worldMatrix.set_dirty();
 }
 
 void Entity::setRotation(const glm::quat &qrot)
 {
     m_rotation = qrot;
+    if(m_transformSlot != TransformSystem::NO_SLOT)
+        m_parentScene->transforms().setRotation(m_transformSlot, qrot);
+    else
+        m_worldMatrix.set_dirty();
 }
 
 void Entity::setEulerRotation(const glm::vec3 &rot)
@@ -76,6 +123,10 @@ void Entity::setEulerRotation(const glm::vec3 &rot)
 void Entity::setScale(const glm::vec3 &scale)
 {
     m_scale = scale;
+    if(m_transformSlot != TransformSystem::NO_SLOT)
+        m_parentScene->transforms().setScale(m_transformSlot, scale);
+    else
+        m_worldMatrix.set_dirty();
 }
 
 const glm::vec3 &Entity::getPosition() const
@@ -98,9 +149,121 @@ const glm::vec3 &Entity::getScale() const
     return m_scale;
 }
 
+const glm::mat4 &Entity::getWorldMatrix()
+{
+    if(m_transformSlot != TransformSystem::NO_SLOT)
+        return m_parentScene->transforms().world(m_transformSlot);
+
+    if(m_worldMatrix.is_dirty())
+    {
+        m_worldMatrix = glm::translate(glm::mat4(1.f), m_position) * glm::toMat4(m_rotation) * glm::scale(glm::mat4(1.f), m_scale);
+        m_worldMatrix.clear_dirty();
+    }
+
+    // nothing tracks the parent's changes here, so this is composed on every call
+    auto parent = m_parentEntity.lock();
+    if(parent == nullptr)
+        return m_worldMatrix.value();
+    m_parentedWorld = parent->getWorldMatrix() * m_worldMatrix.value();
+    return m_parentedWorld;
+}
+
+glm::vec3 Entity::getWorldPosition()
+{
+    return glm::vec3(getWorldMatrix()[3]);
+}
+
+void Entity::getWorldBounds(glm::vec3 &min, glm::vec3 &max)
+{
+    bool found = false;
+    for(auto &comp : m_components)
+    {
+        auto mesh = dynamic_cast<MeshComponent*>(comp.get());
+        glm::vec3 center;
+        float radius;
+        if(mesh == nullptr || !mesh->worldBoundingSphere(center, radius))
+            continue;
+
+        min = found ? glm::min(min, center - glm::vec3(radius)) : center - glm::vec3(radius);
+        max = found ? glm::max(max, center + glm::vec3(radius)) : center + glm::vec3(radius);
+        found = true;
+    }
+
+    if(!found)
+    {
+        min = getWorldPosition();
+        max = min;
+    }
+}
+
+void Entity::setParent(std::shared_ptr<Entity> parent)
+{
+    auto current = m_parentEntity.lock();
+    if(current == parent)
+        return;
+    for(auto ancestor = parent; ancestor != nullptr; ancestor = ancestor->m_parentEntity.lock())
+    {
+        if(ancestor.get() == this)
+            throw std::runtime_error("An entity can't be parented to itself or its children");
+    }
+
+    if(current != nullptr)
+        current->m_children.erase(std::remove(current->m_children.begin(), current->m_children.end(), this), current->m_children.end());
+    m_parentEntity = parent;
+    if(parent != nullptr)
+        parent->m_children.push_back(this);
+
+    m_worldMatrix.set_dirty();
+    linkTransform();
+}
+
+std::shared_ptr<Entity> Entity::getParent() const
+{
+    return m_parentEntity.lock();
+}
+
+const std::vector<Entity*> &Entity::getChildren() const
+{
+    return m_children;
+}
+
+void Entity::linkTransform()
+{
+    if(m_transformSlot == TransformSystem::NO_SLOT)
+        return;
+
+    auto parent = m_parentEntity.lock();
+    bool linked = parent != nullptr && parent->m_parentScene == m_parentScene && parent->m_transformSlot != TransformSystem::NO_SLOT;
+    m_parentScene->transforms().setParent(m_transformSlot, linked ? parent->m_transformSlot : TransformSystem::NO_SLOT);
+}
+
 void Entity::setScene(Scene3D *parent)
 {
+    if(m_parentScene == parent)
+        return;
+
+    if(m_parentScene != nullptr)
+    {
+        for(auto &comp : m_components)
+            m_parentScene->removeComponent(comp.get());
+        // children in the scene become roots there until this entity comes back
+        m_parentScene->transforms().remove(m_transformSlot);
+        m_transformSlot = TransformSystem::NO_SLOT;
+        m_worldMatrix.set_dirty();
+    }
     m_parentScene = parent;
+    if(m_parentScene != nullptr)
+    {
+        m_transformSlot = m_parentScene->transforms().add(m_position, m_rotation, m_scale);
+        linkTransform();
+        for(auto child : m_children)
+        {
+            if(child->m_parentScene == m_parentScene)
+                child->linkTransform();
+        }
+        for(auto &comp : m_components)
+            m_parentScene->addComponent(comp.get());
+    }
 }
 
 Scene3D *Entity::getParentScene() const
@@ -108,15 +271,54 @@ Scene3D *Entity::getParentScene() const
     return m_parentScene;
 }
 
+uint32_t Entity::getTransformSlot() const
+{
+    return m_transformSlot;
+}
+
+size_t Entity::raycast(const std::vector<RaySegment>& rays, std::vector<ModelRayHit>& hits) const
+{
+    size_t hitCount = 0;
+    for(const auto& comp : m_components)
+    {
+        auto mesh = std::dynamic_pointer_cast<MeshComponent>(comp);
+        if(mesh != nullptr)
+            hitCount += mesh->raycast(rays, hits);
+    }
+    return hitCount;
+}
+
 void Entity::attachComponent(std::shared_ptr<Component> comp)
 {
-    if(m_components.find(comp->getName()) == m_components.end())
-        m_components[comp->getName()] = comp;
+    // one component per name, as before
+    auto sameName = [&comp](const std::shared_ptr<Component> &other) { return std::strcmp(other->getName(), comp->getName()) == 0; };
+    if(std::any_of(m_components.begin(), m_components.end(), sameName))
+        return;
+
+    comp->m_parent = this;
+    comp->m_parentRef = weak_from_this();
+    m_components.push_back(comp);
+    if(m_parentScene != nullptr)
+        m_parentScene->addComponent(comp.get());
 }
 
 void Entity::removeComponent(const char *name)
 {
-    m_components.erase(name);
+    auto it = std::find_if(m_components.begin(), m_components.end(),
+                           [name](const std::shared_ptr<Component> &comp) { return std::strcmp(comp->getName(), name) == 0; });
+    if(it == m_components.end())
+        return;
+
+    if(m_parentScene != nullptr)
+        m_parentScene->removeComponent(it->get());
+    (*it)->m_parent = nullptr;
+    (*it)->m_parentRef.reset();
+    m_components.erase(it);
+}
+
+const std::vector<std::shared_ptr<Component>> &Entity::getComponents() const
+{
+    return m_components;
 }
 
 void Entity::updateSubscribe(const std::function<void (Entity *, double)> &callb)
@@ -1,20 +1,28 @@
 #include "common/entities/staticmesh.hpp"
 #include "client/renderer.hpp"
 #include "common/entities/entity.hpp"
-#include "common/utils.hpp"
+#include "common/servicelocator.hpp"
+#include "common/objectpool.hpp"
+#include "server/scene3d.hpp"
 
 #include <memory>
+#include <atomic>
+#include <string>
+#include <cmath>
+#include <algorithm>
 #include <glm/gtx/quaternion.hpp>
 
 std::shared_ptr<StaticMesh> StaticMesh::createComponent(std::shared_ptr<Entity> parent)
 {
-    return std::make_shared<StaticMesh>(parent);
+    return clean::makePooled<StaticMesh>(parent);
 }
 
 StaticMesh::StaticMesh(std::shared_ptr<Entity> parent)
-    : MeshComponent(parent), m_meshId(-1), m_visible(true), m_castShadow(true), m_translucent(false)
+    : MeshComponent(parent), m_modelMatrix(1.f), m_worldCenter(0.f), m_worldRadius(0.f), m_meshId(-1), m_model(nullptr), m_lodLevel(0), m_visible(true), m_castShadow(true), m_translucent(false)
 {
-    m_name = "StaticMesh_" + uuids::to_string(Utils::uuidGenerator());
+    // only has to tell the meshes of one entity apart
+    static std::atomic<uint32_t> nextNameId{0};
+    m_name = "StaticMesh_" + std::to_string(nextNameId++);
 }
 
 StaticMesh::~StaticMesh()
@@ -27,23 +35,103 @@ void StaticMesh::draw(Renderer *rend)
     if(!m_visible)
         return;
 
-    rend->queueRender(m_meshId, std::vector<size_t>{}, m_modelMatrix);
+    queueModel(rend, std::vector<glm::mat4>{}, bindPalette());
 }
 
 void StaticMesh::update(double dt)
 {
-    const glm::vec3& pos = m_parent.get()->getPosition();
-    const glm::quat& rot = m_parent.get()->getRotation();
-    const glm::vec3& scale = m_parent.get()->getScale();
+    updateMatrix();
+    updateLOD();
+}
+
+void StaticMesh::updateMatrix()
+{
+    if(m_parent == nullptr)
+        return;
+    m_modelMatrix = m_parent->getWorldMatrix();
+    if(m_model == nullptr)
+        return;
 
-    m_modelMatrix = glm::translate(glm::mat4(1.f), pos) *
-                    glm::toMat4(rot) *
-                    glm::scale(glm::mat4(1.f), scale);
+    // the longest axis of the world matrix scales the sphere, so parent scales count as well
+    float scale2 = std::max(glm::dot(glm::vec3(m_modelMatrix[0]), glm::vec3(m_modelMatrix[0])),
+                            std::max(glm::dot(glm::vec3(m_modelMatrix[1]), glm::vec3(m_modelMatrix[1])),
+                                     glm::dot(glm::vec3(m_modelMatrix[2]), glm::vec3(m_modelMatrix[2]))));
+    m_worldCenter = m_modelMatrix * glm::vec4(m_model->boundingCenter(), 1.f);
+    m_worldRadius = m_model->boundingRadius() * std::sqrt(scale2);
+}
+
+void StaticMesh::updateLOD()
+{
+    if(m_model == nullptr || m_model->lodCount() == 0)
+        return;
+
+    Scene3D *scene = m_parent != nullptr ? m_parent->getParentScene() : nullptr;
+    if(scene == nullptr)
+    {
+        m_lodLevel = m_model->lodCount() - 1;
+        return;
+    }
+
+    glm::vec3 center;
+    float radius;
+    worldBoundingSphere(center, radius);
+    m_lodLevel = m_model->selectLOD(scene->getCamera().screenSize(center, radius));
+}
+
+bool StaticMesh::worldBoundingSphere(glm::vec3& center, float& radius) const
+{
+    if(m_model == nullptr)
+        return false;
+
+    center = m_worldCenter;
+    radius = m_worldRadius;
+    return true;
+}
+
+void StaticMesh::queueModel(Renderer *rend, const std::vector<glm::mat4>& meshMatrices, const std::vector<glm::mat4>& bonePalette,
+                            const std::vector<std::vector<glm::vec3>>& meshPositions)
+{
+    RenderItem item;
+    item.modelId = m_meshId;
+    item.modelMatrix = m_modelMatrix;
+    item.meshMatrices = meshMatrices;
+    if(m_model != nullptr && m_model->lodCount() > 0)
+        item.meshIds = m_model->lod(m_lodLevel).meshIds;
+    item.bonePalette = bonePalette;
+    item.meshPositions = meshPositions;
+    rend->queueRender(item);
+}
+
+size_t StaticMesh::raycast(const std::vector<RaySegment>& rays, std::vector<ModelRayHit>& hits) const
+{
+    if(m_model == nullptr || !m_visible)
+        return 0;
+    return ServiceLocator::getModelManager().raycast(m_meshId, m_modelMatrix, rays, hits);
+}
+
+const std::vector<glm::mat4>& StaticMesh::bindPalette() const
+{
+    static const std::vector<glm::mat4> empty;
+    if(m_model == nullptr || m_model->skeleton() == nullptr)
+        return empty;
+    return m_model->skeleton()->bindPalette();
+}
+
+size_t StaticMesh::lodLevel() const
+{
+    return m_lodLevel;
 }
 
 void StaticMesh::setModelId(uint32_t id)
 {
     m_meshId = id;
+    m_model = ServiceLocator::getModelManager().getModel(id);
+    m_lodLevel = (m_model != nullptr && m_model->lodCount() > 0) ? m_model->lodCount() - 1 : 0;
+    updateMatrix();
+
+    Scene3D *scene = m_parent != nullptr ? m_parent->getParentScene() : nullptr;
+    if(scene != nullptr)
+        scene->invalidateBounds(m_parent);
 }
 
 void StaticMesh::show()
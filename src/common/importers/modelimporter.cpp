@@ -0,0 +1,557 @@
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <glm/glm.hpp>
+
+#include "common/importers/modelimporter.hpp"
+#include "common/importers/w3dimporter.hpp"
+#include "common/3d/meshskinning.hpp"
+
+static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate |
+                                         aiProcess_GenNormals |
+                                         aiProcess_JoinIdenticalVertices;
+
+ModelImporter::ModelImporter(Assimp::IOSystem *ioSystem)
+    : m_compressAnimations(false)
+{
+    if(ioSystem != nullptr)
+        m_importer.SetIOHandler(ioSystem);
+    m_w3dImporter = new W3DImporter();
+    m_importer.RegisterLoader(m_w3dImporter);
+}
+
+ModelImporter::~ModelImporter()
+{
+
+}
+
+void ModelImporter::setAnimationCompression(bool enabled, const AnimationCompressionSettings& settings)
+{
+    m_compressAnimations = enabled;
+    m_animationCompression = settings;
+}
+
+static glm::mat4 toMat4(const aiMatrix4x4& m)
+{
+    // Assimp matrices are row major
+    return glm::mat4(m.a1, m.b1, m.c1, m.d1,
+                     m.a2, m.b2, m.c2, m.d2,
+                     m.a3, m.b3, m.c3, m.d3,
+                     m.a4, m.b4, m.c4, m.d4);
+}
+
+// the skinned mesh posed by the palette as a rigid mesh, without influences
+static std::shared_ptr<MeshPrimitive> rigidMesh(const MeshPrimitive& skinned, const std::vector<glm::mat4>& palette)
+{
+    std::vector<glm::vec3> positions, normals;
+    MeshSkinning::skin(skinned, palette, positions, &normals);
+    auto rigid = std::make_shared<MeshPrimitive>(skinned.name(), skinned.id());
+    for(size_t i = 0; i < positions.size(); i++)
+        rigid->addVertex(VertexPrimitive(positions[i], glm::normalize(normals[i]), skinned.vertices()[i].texCoord()));
+    return rigid;
+}
+
+// pre-order walk, so every node is added after its parent
+static void flattenNodes(const aiNode* node, int32_t parent, const aiMatrix4x4& parentGlobal, ModelNodeTree& nodes,
+                         std::vector<int32_t>& meshNodes, std::vector<aiMatrix4x4>& meshGlobals)
+{
+    aiMatrix4x4 global = parentGlobal * node->mTransformation;
+    int32_t index = static_cast<int32_t>(nodes.addNode(node->mName.C_Str(), parent, toMat4(node->mTransformation)));
+    for(unsigned int i = 0; i < node->mNumMeshes; i++)
+    {
+        unsigned int meshId = node->mMeshes[i];
+        if(meshId < meshNodes.size() && meshNodes[meshId] < 0) // instanced meshes keep their first node
+        {
+            meshNodes[meshId] = index;
+            meshGlobals[meshId] = global;
+        }
+    }
+
+    for(unsigned int i = 0; i < node->mNumChildren; i++)
+    {
+        flattenNodes(node->mChildren[i], index, global, nodes, meshNodes, meshGlobals);
+    }
+}
+
+std::shared_ptr<ModelPrimitive> ModelImporter::importFile(const std::string& path, const std::string& name)
+{
+    m_w3dImporter->resetLastFile();
+    const aiScene* scene = m_importer.ReadFile(path, IMPORT_FLAGS);
+    return convert(scene, name);
+}
+
+std::shared_ptr<ModelPrimitive> ModelImporter::importMemory(const std::vector<char>& data, const std::string& name, const std::string& hint)
+{
+    m_w3dImporter->resetLastFile();
+    const aiScene* scene = m_importer.ReadFileFromMemory(data.data(), data.size(), IMPORT_FLAGS, hint.c_str());
+    return convert(scene, name);
+}
+
+std::shared_ptr<ModelPrimitive> ModelImporter::convert(const aiScene* scene, const std::string& name)
+{
+    if(scene == nullptr) {
+        throw std::runtime_error(fmt::format("Failed to import model '{}': {}", name, m_importer.GetErrorString()));
+    }
+
+    if(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)
+    {
+        throw std::runtime_error(fmt::format("Model data '{}' is malformed: ", name));
+    }
+
+    if(!scene->HasMeshes())
+    {
+        throw std::runtime_error(fmt::format("Model data '{}' has no meshes", name));
+    }
+
+    auto model = std::make_shared<ModelPrimitive>();
+    if(m_w3dImporter->hasLastFile())
+    {
+        model->setSkeleton(import_skeleton(m_w3dImporter->lastFile().getHierarchy()));
+    }
+
+    std::vector<int32_t> sceneMeshNodes(scene->mNumMeshes, -1);
+    std::vector<aiMatrix4x4> sceneMeshGlobals(scene->mNumMeshes); // bind pose node globals, identity if detached
+    auto nodes = std::make_shared<ModelNodeTree>();
+    flattenNodes(scene->mRootNode, -1, aiMatrix4x4(), *nodes, sceneMeshNodes, sceneMeshGlobals);
+    model->setNodeTree(nodes);
+
+    std::unordered_map<std::string, uint32_t> meshSlots;
+    std::vector<std::vector<glm::vec3>> bindPositions; // per mesh slot, skinned meshes in bind pose
+    for(unsigned int meshId = 0; meshId < scene->mNumMeshes; meshId++)
+    {
+        const aiMesh* mesh = scene->mMeshes[meshId];
+        aiString meshName = mesh->mName;
+        if(!mesh->HasPositions())
+        {
+            throw std::runtime_error(fmt::format("Model data '{}' has no vertices", name));
+        }
+        if(!mesh->HasNormals())
+        {
+            spdlog::warn("Model data '{}' has no normals", name);
+        }
+        if(!mesh->HasTextureCoords(0))
+        {
+            spdlog::warn("Model data '{}' has no texture coordinates", name);
+            continue; // skip for now
+        }
+        if(!mesh->HasFaces())
+        {
+            throw std::runtime_error(fmt::format("Model data '{}' has no faces", name));
+        }
+
+        // vertices are stored in the bind pose global space of their node, animation moves them by global * inverse(bind global)
+        const aiMatrix4x4& meshTransform = sceneMeshGlobals[meshId];
+        aiMatrix3x3 normalTransform = aiMatrix3x3(meshTransform).Inverse().Transpose();
+
+        auto meshPrimitive = std::make_shared<MeshPrimitive>(meshName.C_Str(), meshId);
+        for(unsigned int j = 0; j < mesh->mNumVertices; j++)
+        {
+            aiVector3D pos = meshTransform * mesh->mVertices[j];
+            aiVector3D norm = (normalTransform * mesh->mNormals[j]).NormalizeSafe();
+            const aiVector3D& tex = mesh->mTextureCoords[0][j];
+
+            meshPrimitive->addVertex(VertexPrimitive(glm::vec3(pos.x, pos.y, pos.z),
+                                                    glm::vec3(norm.x, norm.y, norm.z),
+                                                    glm::vec2(tex.x, tex.y)));
+        }
+
+        if(mesh->HasBones())
+        {
+            import_influences(mesh, model->skeleton().get(), meshPrimitive);
+            // the shader can't index bones past its palette
+            if(meshPrimitive->requiredBoneCount() > MAX_BONE_TRANSFORMS)
+            {
+                spdlog::warn("Mesh '{}' of '{}' uses {} bones, more than the {} the renderer skins with, drawing it rigid in the bind pose",
+                             meshName.C_Str(), name, meshPrimitive->requiredBoneCount(), MAX_BONE_TRANSFORMS);
+                meshPrimitive = rigidMesh(*meshPrimitive, model->skeleton()->bindPalette());
+            }
+        }
+
+        if(mesh->mNumAnimMeshes > 0)
+        {
+            import_morphs(mesh, meshTransform, meshPrimitive);
+        }
+
+        for(unsigned int j = 0; j < mesh->mNumFaces; j++)
+        {
+            aiFace face = mesh->mFaces[j];
+            if(face.mNumIndices != 3)
+            {
+                throw std::runtime_error(fmt::format("Model data '{}' has non-triangular faces", name));
+            }
+            meshPrimitive->addIndex(face.mIndices[0]);
+            meshPrimitive->addIndex(face.mIndices[1]);
+            meshPrimitive->addIndex(face.mIndices[2]);
+        }
+
+        meshSlots.try_emplace(meshName.C_Str(), static_cast<uint32_t>(model->meshCount()));
+        nodes->attachMesh(static_cast<uint32_t>(model->meshCount()), sceneMeshNodes[meshId]);
+        model->addMesh(meshPrimitive);
+
+        bindPositions.emplace_back();
+        MeshSkinning::skin(*meshPrimitive, model->skeleton() ? model->skeleton()->bindPalette() : std::vector<glm::mat4>{}, bindPositions.back());
+        meshPrimitive->setBounds(BoundingVolume::fromPoints(bindPositions.back()));
+    }
+
+    if(model->meshCount() > 0)
+    {
+        glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(std::numeric_limits<float>::lowest());
+        for(const auto& positions : bindPositions)
+        {
+            for(const auto& pos : positions)
+            {
+                boundsMin = glm::min(boundsMin, pos);
+                boundsMax = glm::max(boundsMax, pos);
+            }
+        }
+
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = 0.f;
+        for(const auto& positions : bindPositions)
+        {
+            for(const auto& pos : positions)
+                radius = std::max(radius, glm::distance(center, pos));
+        }
+        model->setBounds(BoundingVolume{boundsMin, boundsMax, center, radius});
+    }
+
+    build_bvhs(model, bindPositions);
+
+    if(m_w3dImporter->hasLastFile() && m_w3dImporter->lastFile().hasHLOD())
+    {
+        import_lods(m_w3dImporter->lastFile().getHLOD(), meshSlots, model);
+    }
+
+    if(m_w3dImporter->hasLastFile() && m_w3dImporter->lastFile().morphAnimationCount() > 0)
+    {
+        import_morph_animations(m_w3dImporter->lastFile(), model);
+    }
+
+    for(unsigned int i=0; i < scene->mNumMaterials; i++)
+    {
+        const aiMaterial* material = scene->mMaterials[i];
+        aiString materialName;
+        material->Get(AI_MATKEY_NAME, materialName);
+        spdlog::info("Texture name: {}", materialName.C_Str());
+    }
+
+    for (unsigned int i = 0; i < scene->mNumAnimations; i++)
+    {
+        const aiAnimation* animation = scene->mAnimations[i];
+        aiString animName = animation->mName;
+
+        auto animationPrimitive = std::make_shared<AnimationPrimitive>(animName.C_Str(), animation->mDuration);
+        for (unsigned int channelId = 0; channelId < animation->mNumChannels; channelId++)
+        {
+            const aiNodeAnim* nodeAnim = animation->mChannels[channelId];
+            aiString nodeName = nodeAnim->mNodeName;
+            int32_t node = nodes->findNode(nodeName.C_Str());
+            if (node < 0)
+            {
+                spdlog::warn("No suitable node named '{}' found", nodeName.C_Str());
+                continue;
+            }
+            int32_t bone = model->skeleton() ? model->skeleton()->findBone(nodeName.C_Str()) : -1;
+
+            AnimationChannelKeys keys;
+            for (unsigned int k = 0; k < nodeAnim->mNumPositionKeys; k++)
+            {
+                const aiVectorKey& key = nodeAnim->mPositionKeys[k];
+                keys.positionTimes.push_back(static_cast<float>(key.mTime));
+                keys.positions.emplace_back(key.mValue.x, key.mValue.y, key.mValue.z);
+            }
+            for (unsigned int k = 0; k < nodeAnim->mNumRotationKeys; k++)
+            {
+                const aiQuatKey& key = nodeAnim->mRotationKeys[k];
+                keys.rotationTimes.push_back(static_cast<float>(key.mTime));
+                keys.rotations.emplace_back(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z);
+            }
+            for (unsigned int k = 0; k < nodeAnim->mNumScalingKeys; k++)
+            {
+                const aiVectorKey& key = nodeAnim->mScalingKeys[k];
+                keys.scaleTimes.push_back(static_cast<float>(key.mTime));
+                keys.scales.emplace_back(key.mValue.x, key.mValue.y, key.mValue.z);
+            }
+            animationPrimitive->addChannel(keys, node, bone);
+        }
+        if (m_compressAnimations)
+        {
+            auto report = animationPrimitive->compress(m_animationCompression);
+            spdlog::info("Compressed animation '{}' of '{}': {} -> {} keys, {} -> {} bytes, max error {:.5f} (position), {:.5f} rad (rotation), {:.5f} (scale)",
+                         animName.C_Str(), name, report.keysBefore, report.keysAfter, report.bytesBefore, report.bytesAfter,
+                         report.maxPositionError, report.maxRotationError, report.maxScaleError);
+        }
+        model->addAnimation(animationPrimitive);
+    }
+
+    m_importer.FreeScene();
+    m_w3dImporter->resetLastFile();
+    return model;
+}
+
+void ModelImporter::build_bvhs(std::shared_ptr<ModelPrimitive> model, const std::vector<std::vector<glm::vec3>>& bindPositions)
+{
+    // W3D meshes may come with a precomputed AABTree
+    std::unordered_map<std::string, const W3DMesh*> w3dMeshes;
+    if(m_w3dImporter->hasLastFile())
+    {
+        const auto& w3dfile = m_w3dImporter->lastFile();
+        for(size_t i = 0; i < w3dfile.meshCount(); i++)
+        {
+            const std::string& meshName = w3dfile.mesh(i).header().meshName();
+            w3dMeshes.try_emplace(meshName.substr(0, meshName.find('\0')), &w3dfile.mesh(i));
+        }
+    }
+
+    for(size_t meshId = 0; meshId < model->meshCount(); meshId++)
+    {
+        auto mesh = model->mesh(meshId);
+        const auto& positions = bindPositions[meshId];
+
+        auto bvh = std::make_shared<TriangleBVH>();
+        bool imported = false;
+        auto w3dIt = w3dMeshes.find(mesh->name());
+        if(w3dIt != w3dMeshes.end() && w3dIt->second->hasAABTree())
+        {
+            const auto& aabTree = w3dIt->second->aabTree();
+            std::vector<BVHNode> nodes;
+            nodes.reserve(aabTree.nodes().size());
+            for(const auto& node : aabTree.nodes())
+                nodes.push_back(BVHNode{node.min().vector(), node.front(), node.max().vector(), node.back()});
+
+            try
+            {
+                bvh->build(positions, mesh->indices(), nodes, aabTree.polyIndices());
+                imported = true;
+            }
+            catch(const std::exception& e)
+            {
+                spdlog::warn("Mesh '{}' has invalid AABTree, rebuilding: {}", mesh->name(), e.what());
+            }
+        }
+
+        if(!imported)
+            bvh->build(positions, mesh->indices());
+        model->setMeshBVH(meshId, bvh);
+    }
+}
+
+void ModelImporter::import_lods(const W3DHLOD& hlod, const std::unordered_map<std::string, uint32_t>& meshSlots, std::shared_ptr<ModelPrimitive> model)
+{
+    for(uint32_t lodIdx = 0; lodIdx < hlod.lodArrayCount(); lodIdx++)
+    {
+        const auto& lodArray = hlod.lodArray(lodIdx);
+
+        ModelLOD lod{};
+        lod.maxScreenSize = lodArray.header().maxScreenSize();
+        for(uint32_t subIdx = 0; subIdx < lodArray.subObjectCount(); subIdx++)
+        {
+            // sub objects are named "CONTAINER.MESH"
+            const std::string& subName = lodArray.subObject(subIdx).name();
+            std::string meshName = subName.substr(subName.find('.') + 1);
+
+            auto slotIt = meshSlots.find(meshName);
+            if(slotIt == meshSlots.end())
+            {
+                spdlog::warn("HLOD '{}' references unknown mesh '{}'", hlod.header().name(), subName);
+                continue;
+            }
+            lod.meshIds.push_back(slotIt->second);
+        }
+        model->addLOD(lod);
+    }
+    spdlog::debug("HLOD '{}': {} LOD(s) imported", hlod.header().name(), model->lodCount());
+}
+
+void ModelImporter::import_morph_animations(const W3DFile& w3dfile, std::shared_ptr<ModelPrimitive> model)
+{
+    // W3D morph anims blend between frames of a pose anim, which move the pivots a channel controls.
+    // The poses of a mesh here are the keys of its first morph target instead (pose p is key p - 1, pose 0
+    // the base mesh), driven by the channel of the mesh's pivot. Skins have no pivot and follow the root's channel.
+    const auto& hierarchy = w3dfile.getHierarchy();
+    std::vector<int32_t> meshPivots(model->meshCount(), 0);
+    for(uint32_t pivotIdx = 0; pivotIdx < hierarchy.pivotCount(); pivotIdx++)
+    {
+        const auto& pivotName = hierarchy.pivot(pivotIdx).name();
+        std::string name = pivotName.substr(0, pivotName.find('\0'));
+        for(size_t meshId = 0; meshId < model->meshCount(); meshId++)
+        {
+            if(model->meshName(meshId) == name)
+                meshPivots[meshId] = static_cast<int32_t>(pivotIdx);
+        }
+    }
+
+    for(size_t animIdx = 0; animIdx < w3dfile.morphAnimationCount(); animIdx++)
+    {
+        const auto& morphAnim = w3dfile.morphAnimation(animIdx);
+        const auto& header = morphAnim.header();
+        if(header.frameRate() <= 0.f)
+        {
+            spdlog::warn("Morph animation '{}' has frame rate {}, skipping", header.name(), header.frameRate());
+            continue;
+        }
+
+        auto animation = std::make_shared<MorphAnimation>(header.name(), header.frameCount() / header.frameRate());
+        const auto& pivotChannels = morphAnim.pivotChannels();
+        for(size_t meshId = 0; meshId < model->meshCount(); meshId++)
+        {
+            auto morph = model->mesh(meshId)->morph();
+            if(morph == nullptr || static_cast<size_t>(meshPivots[meshId]) >= pivotChannels.size())
+                continue;
+            uint32_t channelIdx = pivotChannels[meshPivots[meshId]];
+            if(channelIdx >= morphAnim.channelCount())
+                continue;
+
+            const auto& channel = morphAnim.channel(channelIdx);
+            uint32_t poseCount = static_cast<uint32_t>(morph->target(0).keys.size()) + 1;
+            MorphTrack track{static_cast<uint32_t>(meshId), 0, {}, {}};
+            for(const auto& key : channel.keys())
+            {
+                track.times.push_back(key.morphFrame() / header.frameRate());
+                track.poses.push_back(std::min(key.poseFrame(), poseCount - 1));
+            }
+            if(!track.times.empty())
+                animation->addTrack(track);
+        }
+
+        if(animation->trackCount() == 0)
+        {
+            spdlog::debug("Morph animation '{}' controls no morphed mesh, skipping", header.name());
+            continue;
+        }
+        spdlog::debug("Morph animation '{}': {} frame(s) at {} fps, {} track(s) in {} bytes", header.name(),
+                      header.frameCount(), header.frameRate(), animation->trackCount(), animation->memoryUsage());
+        model->addMorphAnimation(animation);
+    }
+}
+
+std::shared_ptr<ModelSkeleton> ModelImporter::import_skeleton(const W3DHierarchy& hierarchy)
+{
+    if(hierarchy.pivotCount() == 0)
+        return nullptr;
+
+    auto skeleton = std::make_shared<ModelSkeleton>();
+    for(uint32_t pivotIdx = 0; pivotIdx < hierarchy.pivotCount(); pivotIdx++)
+    {
+        const auto& pivot = hierarchy.pivot(pivotIdx);
+        SkeletonBone bone{};
+        bone.name = pivot.name().substr(0, pivot.name().find('\0'));
+        // pivots are stored parents first, the root has 0xFFFFFFFF
+        bone.parent = pivot.parentIndex() < pivotIdx ? static_cast<int32_t>(pivot.parentIndex()) : -1;
+        bone.translation = pivot.translation().vector();
+        bone.rotation = pivot.rotation().quaternion();
+        bone.offset = glm::mat4(1.f);
+        skeleton->addBone(bone);
+    }
+    // W3D is Z-up: (x, y, z) -> (x, z, -y), same as the rigid mesh conversion in W3DImporter
+    skeleton->setRootTransform(glm::mat4(1, 0, 0, 0,
+                                         0, 0, -1, 0,
+                                         0, 1, 0, 0,
+                                         0, 0, 0, 1));
+    return skeleton;
+}
+
+void ModelImporter::import_influences(const aiMesh* mesh, const ModelSkeleton* skeleton, std::shared_ptr<MeshPrimitive> meshPrimitive)
+{
+    if(skeleton == nullptr)
+    {
+        spdlog::warn("Mesh '{}' has bones but the model has no skeleton, drawing it rigid", mesh->mName.C_Str());
+        return;
+    }
+
+    // keep the four strongest influences per vertex
+    std::vector<VertexInfluence> influences(mesh->mNumVertices, VertexInfluence{});
+    for(unsigned int boneIdx = 0; boneIdx < mesh->mNumBones; boneIdx++)
+    {
+        const aiBone* bone = mesh->mBones[boneIdx];
+        int32_t skeletonBone = skeleton->findBone(bone->mName.C_Str());
+        if(skeletonBone < 0)
+        {
+            spdlog::warn("Mesh '{}' is weighted to unknown bone '{}'", mesh->mName.C_Str(), bone->mName.C_Str());
+            continue;
+        }
+
+        for(unsigned int i = 0; i < bone->mNumWeights; i++)
+        {
+            const aiVertexWeight& weight = bone->mWeights[i];
+            auto& influence = influences[weight.mVertexId];
+            int slot = static_cast<int>(std::min_element(influence.weights, influence.weights + 4) - influence.weights);
+            if(influence.weights[slot] < weight.mWeight)
+            {
+                influence.bones[slot] = static_cast<uint16_t>(skeletonBone);
+                influence.weights[slot] = weight.mWeight;
+            }
+        }
+    }
+
+    for(auto& influence : influences)
+    {
+        float sum = influence.weights[0] + influence.weights[1] + influence.weights[2] + influence.weights[3];
+        if(sum <= 0.f)
+        {
+            // unweighted vertex, keep it on the root bone
+            influence.weights[0] = 1.f;
+            sum = 1.f;
+        }
+        for(float& w : influence.weights)
+            w /= sum;
+        meshPrimitive->addInfluence(influence);
+    }
+}
+
+void ModelImporter::import_morphs(const aiMesh* mesh, const aiMatrix4x4& transform, std::shared_ptr<MeshPrimitive> meshPrimitive)
+{
+    std::vector<glm::vec3> base;
+    base.reserve(meshPrimitive->vertexCount());
+    for(const auto& vertex : meshPrimitive->vertices())
+        base.push_back(vertex.position());
+
+    auto morph = std::make_shared<MeshMorph>();
+    MorphTarget target{};
+    auto flushTarget = [&morph, &target]() {
+        if(target.keys.empty())
+            return;
+        // a lone key is a plain target (mWeight is its default weight), keys of a series keep their position
+        if(target.keys.size() == 1)
+            target.keys.front().amount = 1.f;
+        morph->addTarget(target);
+        target = MorphTarget{};
+    };
+
+    std::vector<glm::vec3> positions(mesh->mNumVertices);
+    size_t keyCount = 0;
+    for(unsigned int i = 0; i < mesh->mNumAnimMeshes; i++)
+    {
+        const aiAnimMesh* animMesh = mesh->mAnimMeshes[i];
+        if(!animMesh->HasPositions() || animMesh->mNumVertices != mesh->mNumVertices)
+        {
+            spdlog::warn("Mesh '{}' has invalid morph target {}, skipping", mesh->mName.C_Str(), i);
+            continue;
+        }
+
+        // consecutive anim meshes with the same name are keys of one target (W3D deform sets)
+        std::string name = animMesh->mName.length > 0 ? animMesh->mName.C_Str() : fmt::format("target{}", i);
+        if(name != target.name)
+            flushTarget();
+        target.name = name;
+
+        for(unsigned int j = 0; j < animMesh->mNumVertices; j++)
+        {
+            aiVector3D pos = transform * animMesh->mVertices[j];
+            positions[j] = glm::vec3(pos.x, pos.y, pos.z);
+        }
+        target.keys.push_back(MeshMorph::makeKey(animMesh->mWeight, base, positions));
+        keyCount++;
+    }
+    flushTarget();
+
+    if(morph->targetCount() == 0)
+        return;
+    spdlog::debug("Mesh '{}': {} morph target(s), {} vertex deltas in {} bytes ({} bytes as full copies)", mesh->mName.C_Str(),
+                  morph->targetCount(), morph->deltaCount(), morph->memoryUsage(), keyCount * base.size() * sizeof(glm::vec3));
+    meshPrimitive->setMorph(morph);
+}
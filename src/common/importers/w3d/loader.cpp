@@ -279,6 +279,105 @@ static W3DMaterialPass ReadMaterialPass(Assimp::IOStream *stream, uint32_t chunk
     return materialPass;
 }
 
+static W3DAABTree ReadAABTree(Assimp::IOStream *stream, uint32_t chunkSize)
+{
+    W3DAABTree aabTree{};
+
+    size_t startOffset = stream->Tell();
+    while(stream->Tell() < (startOffset + chunkSize))
+    {
+        W3DChunkHeader chunk(stream);
+        switch(chunk.type())
+        {
+            case W3D_CHUNK::eAABTREE_HEADER:
+            {
+                aabTree.setHeader(W3DAABTreeHeader(stream));
+                break;
+            }
+            case W3D_CHUNK::eAABTREE_POLYINDICES:
+            {
+                uint32_t tmp;
+                for(uint32_t i=0; i < aabTree.header().polyCount(); i++)
+                {
+                    stream->Read(&tmp, sizeof(uint32_t), 1);
+                    aabTree.addPolyIndex(boost::endian::little_to_native(tmp));
+                }
+                break;
+            }
+            case W3D_CHUNK::eAABTREE_NODES:
+            {
+                for(uint32_t i=0; i < aabTree.header().nodeCount(); i++)
+                {
+                    aabTree.addNode(W3DAABTreeNode(stream));
+                }
+                break;
+            }
+            default:
+            {
+                stream->Seek(chunk.size(), aiOrigin_CUR);
+                break;
+            }
+        }
+    }
+    return aabTree;
+}
+
+static W3DDeformKeyframe ReadDeformKeyframe(Assimp::IOStream *stream, uint32_t chunkSize)
+{
+    W3DDeformKeyframe keyframe{};
+
+    size_t startOffset = stream->Tell();
+    keyframe.setInfo(W3DDeformKeyframeInfo(stream));
+    while(stream->Tell() < (startOffset + chunkSize))
+    {
+        W3DChunkHeader chunk(stream);
+        switch(chunk.type())
+        {
+            case W3D_CHUNK::eDEFORM_DATA:
+            {
+                size_t dataOffset = stream->Tell();
+                while(stream->Tell() < (dataOffset + chunk.size()))
+                {
+                    keyframe.addData(W3DDeformData(stream));
+                }
+                break;
+            }
+            default:
+            {
+                stream->Seek(chunk.size(), aiOrigin_CUR);
+                break;
+            }
+        }
+    }
+    return keyframe;
+}
+
+static W3DDeformSet ReadDeformSet(Assimp::IOStream *stream, uint32_t chunkSize)
+{
+    W3DDeformSet deformSet{};
+
+    size_t startOffset = stream->Tell();
+    deformSet.setInfo(W3DDeformSetInfo(stream));
+    while(stream->Tell() < (startOffset + chunkSize))
+    {
+        W3DChunkHeader chunk(stream);
+        switch(chunk.type())
+        {
+            case W3D_CHUNK::eDEFORM_KEYFRAME:
+            {
+                deformSet.addKeyframe(ReadDeformKeyframe(stream, chunk.size()));
+                break;
+            }
+            default:
+            {
+                stream->Seek(chunk.size(), aiOrigin_CUR);
+                break;
+            }
+        }
+    }
+    return deformSet;
+}
+
 static W3DMesh ReadMesh(Assimp::IOStream *stream, uint32_t chunkSize)
 {
     W3DMesh mesh{};
@@ -386,6 +485,32 @@ static W3DMesh ReadMesh(Assimp::IOStream *stream, uint32_t chunkSize)
                 mesh.addMaterialPass(ReadMaterialPass(stream, chunk.size()));
                 break;
             }
+            case W3D_CHUNK::eAABTREE:
+            {
+                mesh.setAABTree(ReadAABTree(stream, chunk.size()));
+                break;
+            }
+            case W3D_CHUNK::eDEFORM:
+            {
+                // W3DMeshDeform header followed by the sets
+                size_t deformOffset = stream->Tell();
+                W3DMeshDeform deform(stream);
+                while(stream->Tell() < (deformOffset + chunk.size()))
+                {
+                    W3DChunkHeader setChunk(stream);
+                    if(setChunk.type() == W3D_CHUNK::eDEFORM_SET)
+                    {
+                        mesh.addDeformSet(ReadDeformSet(stream, setChunk.size()));
+                    }
+                    else
+                    {
+                        stream->Seek(setChunk.size(), aiOrigin_CUR);
+                    }
+                }
+                if(mesh.deformSetCount() != deform.setCount())
+                    spdlog::warn("Mesh deform declares {} sets, {} read", deform.setCount(), mesh.deformSetCount());
+                break;
+            }
             default:
             {
                 stream->Seek(chunk.size(), aiOrigin_CUR);
@@ -396,6 +521,142 @@ static W3DMesh ReadMesh(Assimp::IOStream *stream, uint32_t chunkSize)
     return mesh;
 }
 
+static W3DLODArray ReadLODArray(Assimp::IOStream *stream, uint32_t chunkSize)
+{
+    W3DLODArray lodArray{};
+
+    size_t startOffset = stream->Tell();
+    while(stream->Tell() < (startOffset + chunkSize))
+    {
+        W3DChunkHeader chunk(stream);
+        switch(chunk.type())
+        {
+            case W3D_CHUNK::eHLOD_SUB_OBJECT_ARRAY_HEADER:
+            {
+                lodArray.setHeader(W3DHLODArrayHeader(stream));
+                break;
+            }
+            case W3D_CHUNK::eHLOD_SUB_OBJECT:
+            {
+                lodArray.addSubObject(W3DHLODSubObject(stream));
+                break;
+            }
+            default:
+            {
+                stream->Seek(chunk.size(), aiOrigin_CUR);
+                break;
+            }
+        }
+    }
+    return lodArray;
+}
+
+static W3DMorphAnimChannel ReadMorphAnimChannel(Assimp::IOStream *stream, uint32_t chunkSize)
+{
+    W3DMorphAnimChannel channel{};
+
+    size_t startOffset = stream->Tell();
+    while(stream->Tell() < (startOffset + chunkSize))
+    {
+        W3DChunkHeader chunk(stream);
+        switch(chunk.type())
+        {
+            case W3D_CHUNK::eMORPHANIM_POSENAME:
+            {
+                std::string name(chunk.size(), '\0');
+                stream->Read(name.data(), 1, chunk.size());
+                channel.setPoseName(name.substr(0, name.find('\0')));
+                break;
+            }
+            case W3D_CHUNK::eMORPHANIM_KEYDATA:
+            {
+                for(size_t i=0; i < chunk.size(); i += 2*sizeof(uint32_t))
+                {
+                    channel.addKey(W3DMorphAnimKey(stream));
+                }
+                break;
+            }
+            default:
+            {
+                stream->Seek(chunk.size(), aiOrigin_CUR);
+                break;
+            }
+        }
+    }
+    return channel;
+}
+
+static W3DMorphAnimation ReadMorphAnimation(Assimp::IOStream *stream, uint32_t chunkSize)
+{
+    W3DMorphAnimation animation{};
+
+    size_t startOffset = stream->Tell();
+    while(stream->Tell() < (startOffset + chunkSize))
+    {
+        W3DChunkHeader chunk(stream);
+        switch(chunk.type())
+        {
+            case W3D_CHUNK::eMORPHANIM_HEADER:
+            {
+                animation.setHeader(W3DMorphAnimHeader(stream));
+                break;
+            }
+            case W3D_CHUNK::eMORPHANIM_CHANNEL:
+            {
+                animation.addChannel(ReadMorphAnimChannel(stream, chunk.size()));
+                break;
+            }
+            case W3D_CHUNK::eMORPHANIM_PIVOTCHANNELDATA:
+            {
+                uint32_t tmp;
+                for(size_t i=0; i < chunk.size(); i += sizeof(uint32_t))
+                {
+                    stream->Read(&tmp, sizeof(uint32_t), 1);
+                    animation.addPivotChannel(boost::endian::little_to_native(tmp));
+                }
+                break;
+            }
+            default:
+            {
+                stream->Seek(chunk.size(), aiOrigin_CUR);
+                break;
+            }
+        }
+    }
+    return animation;
+}
+
+static W3DHLOD ReadHLOD(Assimp::IOStream *stream, uint32_t chunkSize)
+{
+    W3DHLOD hlod{};
+
+    size_t startOffset = stream->Tell();
+    while(stream->Tell() < (startOffset + chunkSize))
+    {
+        W3DChunkHeader chunk(stream);
+        switch(chunk.type())
+        {
+            case W3D_CHUNK::eHLOD_HEADER:
+            {
+                hlod.setHeader(W3DHLODHeader(stream));
+                break;
+            }
+            case W3D_CHUNK::eHLOD_LOD_ARRAY:
+            {
+                hlod.addLODArray(ReadLODArray(stream, chunk.size()));
+                break;
+            }
+            default:
+            {
+                // aggregate and proxy arrays are not supported yet
+                stream->Seek(chunk.size(), aiOrigin_CUR);
+                break;
+            }
+        }
+    }
+    return hlod;
+}
+
 W3DFile W3DLoader::Load(Assimp::IOStream *stream)
 {
     W3DFile w3dfile{};
@@ -435,11 +696,30 @@ W3DFile W3DLoader::Load(Assimp::IOStream *stream)
             //     // ReadAnimation
             //     spdlog::debug("Reading chunk model animation");
             //     break;
-            // TODO: load HLOD
-            // case W3D_CHUNK::eHLOD:
-            //     // ReadHLOD
-            //     spdlog::debug("Reading chunk model HLOD");
-            //     break;
+            case W3D_CHUNK::eMORPH_ANIMATION:
+            {
+                try
+                {
+                    w3dfile.addMorphAnimation(ReadMorphAnimation(stream, chunk.size()));
+                }
+                catch(const std::exception &e)
+                {
+                    spdlog::error("Failed to read morph animation: {}", e.what());
+                }
+                break;
+            }
+            case W3D_CHUNK::eHLOD:
+            {
+                try
+                {
+                    w3dfile.setHLOD(ReadHLOD(stream, chunk.size()));
+                }
+                catch(const std::exception &e)
+                {
+                    spdlog::error("Failed to read HLOD: {}", e.what());
+                }
+                break;
+            }
             default:
             {
                 stream->Seek(chunk.size(), aiOrigin_CUR);
@@ -496,4 +776,38 @@ const W3DAnimation& W3DFile::animation(size_t index) const
         throw std::out_of_range("Animation index out of range");
     }
     return m_animations[index];
-}
\ No newline at end of file
+}
+void W3DFile::addMorphAnimation(const W3DMorphAnimation& animation)
+{
+    m_morphAnimations.emplace_back(animation);
+}
+
+size_t W3DFile::morphAnimationCount() const
+{
+    return m_morphAnimations.size();
+}
+
+const W3DMorphAnimation& W3DFile::morphAnimation(size_t index) const
+{
+    if(index >= m_morphAnimations.size())
+    {
+        throw std::out_of_range("Morph animation index out of range");
+    }
+    return m_morphAnimations[index];
+}
+
+void W3DFile::setHLOD(const W3DHLOD& hlod)
+{
+    m_hlod = hlod;
+    m_hasHLOD = true;
+}
+
+bool W3DFile::hasHLOD() const
+{
+    return m_hasHLOD;
+}
+
+const W3DHLOD& W3DFile::getHLOD() const
+{
+    return m_hlod;
+}
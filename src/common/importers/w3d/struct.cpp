@@ -1,6 +1,7 @@
 #include <assimp/IOStream.hpp>
 #include <boost/endian.hpp>
 #include <fmt/format.h>
+#include <cstring>
 
 #include "common/importers/w3d/struct.hpp"
 
@@ -620,6 +621,23 @@ W3DDeformData::W3DDeformData(Assimp::IOStream *stream)
     m_position = W3DVector(stream);
 
     m_color = W3DRGBA(stream);
+
+    stream->Seek(8, aiOrigin_CUR); // reserved
+}
+
+uint32_t W3DDeformData::vertexIndex() const
+{
+    return m_vertexIndex;
+}
+
+const W3DVector& W3DDeformData::position() const
+{
+    return m_position;
+}
+
+const W3DRGBA& W3DDeformData::color() const
+{
+    return m_color;
 }
 
 W3DHierarchyHeader::W3DHierarchyHeader(Assimp::IOStream *stream)
@@ -1033,6 +1051,11 @@ void W3DMesh::addInfluence(const W3DVertexInfo& influence)
     m_influences.emplace_back(influence);
 }
 
+size_t W3DMesh::influenceCount() const
+{
+    return m_influences.size();
+}
+
 const W3DVertexInfo& W3DMesh::influence(uint32_t index) const
 {
     if(index >= m_influences.size())
@@ -1136,6 +1159,187 @@ const W3DMaterialPass& W3DMesh::materialPass(uint32_t index) const
     return m_materialPasses.at(index);
 }
 
+void W3DMesh::setAABTree(const W3DAABTree& aabTree)
+{
+    m_aabTree = aabTree;
+    m_hasAABTree = true;
+}
+
+bool W3DMesh::hasAABTree() const
+{
+    return m_hasAABTree;
+}
+
+const W3DAABTree& W3DMesh::aabTree() const
+{
+    return m_aabTree;
+}
+
+void W3DMesh::addDeformSet(const W3DDeformSet& deformSet)
+{
+    m_deformSets.emplace_back(deformSet);
+}
+
+size_t W3DMesh::deformSetCount() const
+{
+    return m_deformSets.size();
+}
+
+const W3DDeformSet& W3DMesh::deformSet(uint32_t index) const
+{
+    if(index >= m_deformSets.size())
+    {
+        throw std::out_of_range("W3DMesh::deformSet: index out of range");
+    }
+    return m_deformSets.at(index);
+}
+
+void W3DDeformKeyframe::setInfo(const W3DDeformKeyframeInfo& info)
+{
+    m_info = info;
+}
+
+const W3DDeformKeyframeInfo& W3DDeformKeyframe::info() const
+{
+    return m_info;
+}
+
+void W3DDeformKeyframe::addData(const W3DDeformData& data)
+{
+    m_data.emplace_back(data);
+}
+
+const std::vector<W3DDeformData>& W3DDeformKeyframe::data() const
+{
+    return m_data;
+}
+
+void W3DDeformSet::setInfo(const W3DDeformSetInfo& info)
+{
+    m_info = info;
+}
+
+const W3DDeformSetInfo& W3DDeformSet::info() const
+{
+    return m_info;
+}
+
+void W3DDeformSet::addKeyframe(const W3DDeformKeyframe& keyframe)
+{
+    m_keyframes.emplace_back(keyframe);
+}
+
+size_t W3DDeformSet::keyframeCount() const
+{
+    return m_keyframes.size();
+}
+
+const W3DDeformKeyframe& W3DDeformSet::keyframe(uint32_t index) const
+{
+    if(index >= m_keyframes.size())
+    {
+        throw std::out_of_range("W3DDeformSet::keyframe: index out of range");
+    }
+    return m_keyframes.at(index);
+}
+
+W3DAABTreeHeader::W3DAABTreeHeader(Assimp::IOStream *stream)
+{
+    uint32_t tmp;
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_nodeCount = boost::endian::little_to_native(tmp);
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_polyCount = boost::endian::little_to_native(tmp);
+    stream->Seek(6 * sizeof(uint32_t), aiOrigin_CUR); // padding
+}
+
+uint32_t W3DAABTreeHeader::nodeCount() const
+{
+    return m_nodeCount;
+}
+
+uint32_t W3DAABTreeHeader::polyCount() const
+{
+    return m_polyCount;
+}
+
+W3DAABTreeNode::W3DAABTreeNode(Assimp::IOStream *stream)
+{
+    m_min = W3DVector(stream);
+    m_max = W3DVector(stream);
+
+    uint32_t tmp;
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_frontOrPoly0 = boost::endian::little_to_native(tmp);
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_backOrPolyCount = boost::endian::little_to_native(tmp);
+}
+
+const W3DVector& W3DAABTreeNode::min() const
+{
+    return m_min;
+}
+
+const W3DVector& W3DAABTreeNode::max() const
+{
+    return m_max;
+}
+
+bool W3DAABTreeNode::isLeaf() const
+{
+    return (m_frontOrPoly0 & 0x80000000) != 0;
+}
+
+uint32_t W3DAABTreeNode::front() const
+{
+    return m_frontOrPoly0;
+}
+
+uint32_t W3DAABTreeNode::back() const
+{
+    return m_backOrPolyCount;
+}
+
+uint32_t W3DAABTreeNode::poly0() const
+{
+    return m_frontOrPoly0 & 0x7FFFFFFF;
+}
+
+uint32_t W3DAABTreeNode::polyCount() const
+{
+    return m_backOrPolyCount;
+}
+
+void W3DAABTree::setHeader(const W3DAABTreeHeader& header)
+{
+    m_header = header;
+}
+
+const W3DAABTreeHeader& W3DAABTree::header() const
+{
+    return m_header;
+}
+
+void W3DAABTree::addPolyIndex(uint32_t polyIndex)
+{
+    m_polyIndices.emplace_back(polyIndex);
+}
+
+const std::vector<uint32_t>& W3DAABTree::polyIndices() const
+{
+    return m_polyIndices;
+}
+
+void W3DAABTree::addNode(const W3DAABTreeNode& node)
+{
+    m_nodes.emplace_back(node);
+}
+
+const std::vector<W3DAABTreeNode>& W3DAABTree::nodes() const
+{
+    return m_nodes;
+}
+
 void W3DHierarchy::setHeader(const W3DHierarchyHeader& header)
 {
     m_header = header;
@@ -1151,6 +1355,11 @@ void W3DHierarchy::addPivot(const W3DPivot& pivot)
     m_pivots.emplace_back(pivot);
 }
 
+size_t W3DHierarchy::pivotCount() const
+{
+    return m_pivots.size();
+}
+
 const W3DPivot& W3DHierarchy::pivot(uint32_t index) const
 {
     if(index >= m_pivots.size())
@@ -1158,4 +1367,266 @@ const W3DPivot& W3DHierarchy::pivot(uint32_t index) const
         throw std::out_of_range("W3DHierarchy::pivot: index out of range");
     }
     return m_pivots.at(index);
-}
\ No newline at end of file
+}
+W3DHLODHeader::W3DHLODHeader(Assimp::IOStream *stream)
+{
+    uint32_t tmp;
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_version = boost::endian::little_to_native(tmp);
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_lodCount = boost::endian::little_to_native(tmp);
+
+    char nameBuff[W3D_NAME_LEN];
+    stream->Read(nameBuff, 1, W3D_NAME_LEN);
+    m_name = std::string(nameBuff, strnlen(nameBuff, W3D_NAME_LEN));
+    stream->Read(nameBuff, 1, W3D_NAME_LEN);
+    m_hierarchyName = std::string(nameBuff, strnlen(nameBuff, W3D_NAME_LEN));
+}
+
+uint32_t W3DHLODHeader::version() const
+{
+    return m_version;
+}
+
+uint32_t W3DHLODHeader::lodCount() const
+{
+    return m_lodCount;
+}
+
+const std::string& W3DHLODHeader::name() const
+{
+    return m_name;
+}
+
+const std::string& W3DHLODHeader::hierarchyName() const
+{
+    return m_hierarchyName;
+}
+
+W3DHLODArrayHeader::W3DHLODArrayHeader(Assimp::IOStream *stream)
+{
+    uint32_t tmp;
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_modelCount = boost::endian::little_to_native(tmp);
+    float ftmp;
+    stream->Read(&ftmp, sizeof(float), 1);
+    m_maxScreenSize = ftmp;
+}
+
+uint32_t W3DHLODArrayHeader::modelCount() const
+{
+    return m_modelCount;
+}
+
+float W3DHLODArrayHeader::maxScreenSize() const
+{
+    return m_maxScreenSize;
+}
+
+W3DHLODSubObject::W3DHLODSubObject(Assimp::IOStream *stream)
+{
+    uint32_t tmp;
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_boneIndex = boost::endian::little_to_native(tmp);
+
+    char nameBuff[W3D_NAME_LEN*2];
+    stream->Read(nameBuff, 1, W3D_NAME_LEN*2);
+    m_name = std::string(nameBuff, strnlen(nameBuff, W3D_NAME_LEN*2));
+}
+
+uint32_t W3DHLODSubObject::boneIndex() const
+{
+    return m_boneIndex;
+}
+
+const std::string& W3DHLODSubObject::name() const
+{
+    return m_name;
+}
+
+void W3DLODArray::setHeader(const W3DHLODArrayHeader& header)
+{
+    m_header = header;
+}
+
+const W3DHLODArrayHeader& W3DLODArray::header() const
+{
+    return m_header;
+}
+
+void W3DLODArray::addSubObject(const W3DHLODSubObject& subObject)
+{
+    m_subObjects.emplace_back(subObject);
+}
+
+size_t W3DLODArray::subObjectCount() const
+{
+    return m_subObjects.size();
+}
+
+const W3DHLODSubObject& W3DLODArray::subObject(uint32_t index) const
+{
+    if(index >= m_subObjects.size())
+    {
+        throw std::out_of_range("W3DLODArray::subObject: index out of range");
+    }
+    return m_subObjects.at(index);
+}
+
+void W3DHLOD::setHeader(const W3DHLODHeader& header)
+{
+    m_header = header;
+}
+
+const W3DHLODHeader& W3DHLOD::header() const
+{
+    return m_header;
+}
+
+void W3DHLOD::addLODArray(const W3DLODArray& lodArray)
+{
+    m_lodArrays.emplace_back(lodArray);
+}
+
+size_t W3DHLOD::lodArrayCount() const
+{
+    return m_lodArrays.size();
+}
+
+const W3DLODArray& W3DHLOD::lodArray(uint32_t index) const
+{
+    if(index >= m_lodArrays.size())
+    {
+        throw std::out_of_range("W3DHLOD::lodArray: index out of range");
+    }
+    return m_lodArrays.at(index);
+}
+
+W3DMorphAnimHeader::W3DMorphAnimHeader(Assimp::IOStream *stream)
+{
+    uint32_t tmp;
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_version = boost::endian::little_to_native(tmp);
+
+    char nameBuff[W3D_NAME_LEN];
+    stream->Read(nameBuff, 1, W3D_NAME_LEN);
+    m_name = std::string(nameBuff, strnlen(nameBuff, W3D_NAME_LEN));
+    stream->Read(nameBuff, 1, W3D_NAME_LEN);
+    m_hierarchyName = std::string(nameBuff, strnlen(nameBuff, W3D_NAME_LEN));
+
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_frameCount = boost::endian::little_to_native(tmp);
+
+    stream->Read(&m_frameRate, sizeof(float), 1);
+
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_channelCount = boost::endian::little_to_native(tmp);
+}
+
+uint32_t W3DMorphAnimHeader::version() const
+{
+    return m_version;
+}
+
+const std::string& W3DMorphAnimHeader::name() const
+{
+    return m_name;
+}
+
+const std::string& W3DMorphAnimHeader::hierarchyName() const
+{
+    return m_hierarchyName;
+}
+
+uint32_t W3DMorphAnimHeader::frameCount() const
+{
+    return m_frameCount;
+}
+
+float W3DMorphAnimHeader::frameRate() const
+{
+    return m_frameRate;
+}
+
+uint32_t W3DMorphAnimHeader::channelCount() const
+{
+    return m_channelCount;
+}
+
+W3DMorphAnimKey::W3DMorphAnimKey(Assimp::IOStream *stream)
+{
+    uint32_t tmp;
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_morphFrame = boost::endian::little_to_native(tmp);
+    stream->Read(&tmp, sizeof(uint32_t), 1);
+    m_poseFrame = boost::endian::little_to_native(tmp);
+}
+
+uint32_t W3DMorphAnimKey::morphFrame() const
+{
+    return m_morphFrame;
+}
+
+uint32_t W3DMorphAnimKey::poseFrame() const
+{
+    return m_poseFrame;
+}
+
+void W3DMorphAnimChannel::setPoseName(const std::string& poseName)
+{
+    m_poseName = poseName;
+}
+
+const std::string& W3DMorphAnimChannel::poseName() const
+{
+    return m_poseName;
+}
+
+void W3DMorphAnimChannel::addKey(const W3DMorphAnimKey& key)
+{
+    m_keys.emplace_back(key);
+}
+
+const std::vector<W3DMorphAnimKey>& W3DMorphAnimChannel::keys() const
+{
+    return m_keys;
+}
+
+void W3DMorphAnimation::setHeader(const W3DMorphAnimHeader& header)
+{
+    m_header = header;
+}
+
+const W3DMorphAnimHeader& W3DMorphAnimation::header() const
+{
+    return m_header;
+}
+
+void W3DMorphAnimation::addChannel(const W3DMorphAnimChannel& channel)
+{
+    m_channels.emplace_back(channel);
+}
+
+size_t W3DMorphAnimation::channelCount() const
+{
+    return m_channels.size();
+}
+
+const W3DMorphAnimChannel& W3DMorphAnimation::channel(uint32_t index) const
+{
+    if(index >= m_channels.size())
+    {
+        throw std::out_of_range("W3DMorphAnimation::channel: index out of range");
+    }
+    return m_channels.at(index);
+}
+
+void W3DMorphAnimation::addPivotChannel(uint32_t channel)
+{
+    m_pivotChannels.push_back(channel);
+}
+
+const std::vector<uint32_t>& W3DMorphAnimation::pivotChannels() const
+{
+    return m_pivotChannels;
+}
@@ -7,8 +7,12 @@
 #include <glm/gtx/euler_angles.hpp>
 
 #include <map>
+#include <algorithm>
+#include <functional>
 
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
+#include <boost/algorithm/string.hpp>
 
 #include "common/importers/w3dimporter.hpp"
 #include "common/importers/w3d/loader.hpp"
@@ -50,6 +54,11 @@ void W3DImporter::InternReadFile(const std::string &pFile, aiScene *pScene, Assi
         return;
     }
 
+    if(w3dfile.getHierarchy().pivotCount() == 0)
+    {
+        resolveHierarchy(w3dfile, pFile, pIOHandler);
+    }
+
     std::map<std::string, W3DPivot> pivotMap;
     for(uint32_t pivotIdx = 0; pivotIdx < w3dfile.getHierarchy().header().numPivots(); pivotIdx++)
     {
@@ -65,19 +74,17 @@ void W3DImporter::InternReadFile(const std::string &pFile, aiScene *pScene, Assi
         aiMesh *mesh = new aiMesh{};
         mesh->mName = aiString{w3dmesh.header().meshName()};
 
+        // skins store every vertex in the space of its bone, they aren't attached to a pivot
+        bool isSkin = w3dmesh.influenceCount() > 0 && w3dmesh.influenceCount() == w3dmesh.header().numVertices();
+
         W3DPivot pivot{};
-        if(pivotMap.find(w3dmesh.header().meshName()) == pivotMap.end())
-            spdlog::warn("Mesh '{}' has no pivot", w3dmesh.header().meshName());
-        else
+        if(pivotMap.find(w3dmesh.header().meshName()) != pivotMap.end())
             pivot = pivotMap[w3dmesh.header().meshName()];
+        else if(!isSkin)
+            spdlog::warn("Mesh '{}' has no pivot", w3dmesh.header().meshName());
 
-        mesh->mVertices = new aiVector3D[w3dmesh.header().numVertices()];
-        mesh->mNormals = new aiVector3D[w3dmesh.header().numVertices()];
-        mesh->mNumVertices = w3dmesh.header().numVertices();
-        for(uint32_t vi=0; vi < w3dmesh.header().numVertices(); vi++)
-        {
-            auto vertex = w3dmesh.vertex(vi).vector();
-            // transform vertex by pivot
+        // transform vertex by pivot
+        auto pivotTransform = [&pivot](glm::vec3 vertex) {
             if(pivot.valid())
             {
                 glm::mat4 transform = glm::mat4(1, 0, 0, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 0, 0, 1);
@@ -89,11 +96,30 @@ void W3DImporter::InternReadFile(const std::string &pFile, aiScene *pScene, Assi
                 vertex += trs;
                 vertex = glm::vec4(vertex, 1.f) * glm::eulerAngleZYX(rot.z, rot.y, rot.x);
             }
+            return vertex;
+        };
+
+        mesh->mVertices = new aiVector3D[w3dmesh.header().numVertices()];
+        mesh->mNormals = new aiVector3D[w3dmesh.header().numVertices()];
+        mesh->mNumVertices = w3dmesh.header().numVertices();
+        for(uint32_t vi=0; vi < w3dmesh.header().numVertices(); vi++)
+        {
+            auto vertex = pivotTransform(w3dmesh.vertex(vi).vector());
             auto normal = w3dmesh.normal(vi).vector();
             mesh->mVertices[vi] = aiVector3D{vertex.x, vertex.y, vertex.z};
             mesh->mNormals[vi] = aiVector3D{normal.x, normal.y, normal.z};
         }
 
+        if(isSkin)
+        {
+            importSkinBones(w3dfile.getHierarchy(), w3dmesh, mesh);
+        }
+
+        if(w3dmesh.deformSetCount() > 0)
+        {
+            importDeformSets(w3dmesh, mesh, pivotTransform);
+        }
+
         if(w3dmesh.materialInfo().passCount() == 0)
             spdlog::debug("Mesh '{}' has no material passes", mesh->mName.C_Str());
         else
@@ -128,5 +154,137 @@ void W3DImporter::InternReadFile(const std::string &pFile, aiScene *pScene, Assi
         pScene->mMeshes[meshIdx] = mesh;
     }
 
+    // flat node tree: every mesh gets its own node below the root
+    pScene->mRootNode = new aiNode{};
+    pScene->mRootNode->mName = aiString{"W3DRoot"};
+    pScene->mRootNode->mChildren = new aiNode*[pScene->mNumMeshes];
+    pScene->mRootNode->mNumChildren = pScene->mNumMeshes;
+    for(unsigned int meshIdx=0; meshIdx < pScene->mNumMeshes; meshIdx++)
+    {
+        aiNode *node = new aiNode{};
+        node->mName = pScene->mMeshes[meshIdx]->mName;
+        node->mParent = pScene->mRootNode;
+        node->mMeshes = new unsigned int[1]{meshIdx};
+        node->mNumMeshes = 1;
+        pScene->mRootNode->mChildren[meshIdx] = node;
+    }
+
     pIOHandler->Close(fstream);
+
+    // morph anims need the imported morph targets, ModelImporter turns them into MorphAnimations
+    m_lastFile = std::move(w3dfile);
+    m_hasLastFile = true;
+}
+
+void W3DImporter::resolveHierarchy(W3DFile& w3dfile, const std::string& pFile, Assimp::IOSystem* pIOHandler)
+{
+    // skinned models reference a shared skeleton file (HLOD hierarchy name), usually next to the model
+    if(!w3dfile.hasHLOD())
+        return;
+    const std::string& hierarchyName = w3dfile.getHLOD().header().hierarchyName();
+    if(hierarchyName.empty() || hierarchyName == w3dfile.getHLOD().header().name())
+        return;
+
+    std::string directory = pFile.substr(0, pFile.find_last_of("/\\") + 1);
+    std::string path = directory + boost::algorithm::to_lower_copy(hierarchyName) + ".w3d";
+    if(!pIOHandler->Exists(path))
+    {
+        spdlog::warn("Hierarchy '{}' of '{}' not found", path, pFile);
+        return;
+    }
+
+    auto stream = pIOHandler->Open(path, "rb");
+    try
+    {
+        w3dfile.setHierarchy(W3DLoader::Load(stream).getHierarchy());
+    }
+    catch(const std::exception &e)
+    {
+        spdlog::error("Failed to load hierarchy '{}': {}", path, e.what());
+    }
+    pIOHandler->Close(stream);
+}
+
+void W3DImporter::importSkinBones(const W3DHierarchy& hierarchy, const W3DMesh& w3dmesh, aiMesh* mesh)
+{
+    // W3D skins have a single rigid influence per vertex, the pivot index is the bone
+    std::map<uint16_t, std::vector<aiVertexWeight>> boneWeights;
+    for(uint32_t vi = 0; vi < mesh->mNumVertices; vi++)
+    {
+        uint16_t pivotIdx = w3dmesh.influence(vi).boneIndex();
+        if(pivotIdx >= hierarchy.pivotCount())
+        {
+            spdlog::warn("Mesh '{}' references missing pivot {}", mesh->mName.C_Str(), pivotIdx);
+            continue;
+        }
+        boneWeights[pivotIdx].emplace_back(vi, 1.f);
+    }
+
+    mesh->mNumBones = static_cast<unsigned int>(boneWeights.size());
+    mesh->mBones = new aiBone*[mesh->mNumBones];
+    unsigned int boneIdx = 0;
+    for(const auto& [pivotIdx, weights] : boneWeights)
+    {
+        const std::string& pivotName = hierarchy.pivot(pivotIdx).name();
+        aiBone *bone = new aiBone{};
+        bone->mName = aiString{pivotName.substr(0, pivotName.find('\0'))};
+        bone->mNumWeights = static_cast<unsigned int>(weights.size());
+        bone->mWeights = new aiVertexWeight[bone->mNumWeights];
+        std::copy(weights.begin(), weights.end(), bone->mWeights);
+        // mOffsetMatrix stays identity, vertices are already in bone space
+        mesh->mBones[boneIdx++] = bone;
+    }
+}
+
+void W3DImporter::importDeformSets(const W3DMesh& w3dmesh, aiMesh* mesh, const std::function<glm::vec3(glm::vec3)>& pivotTransform)
+{
+    // one anim mesh per keyframe, keyframes of a set share the set name and are ordered by mWeight
+    std::vector<aiAnimMesh*> animMeshes;
+    for(uint32_t setIdx = 0; setIdx < w3dmesh.deformSetCount(); setIdx++)
+    {
+        const auto& deformSet = w3dmesh.deformSet(setIdx);
+        for(uint32_t keyIdx = 0; keyIdx < deformSet.keyframeCount(); keyIdx++)
+        {
+            const auto& keyframe = deformSet.keyframe(keyIdx);
+            aiAnimMesh *animMesh = new aiAnimMesh{};
+            animMesh->mName = aiString{fmt::format("deform{}", setIdx)};
+            animMesh->mWeight = keyframe.info().deformPercent();
+            animMesh->mNumVertices = mesh->mNumVertices;
+            animMesh->mVertices = new aiVector3D[mesh->mNumVertices];
+            std::copy(mesh->mVertices, mesh->mVertices + mesh->mNumVertices, animMesh->mVertices);
+
+            // deform data holds the new position of every changed vertex
+            for(const auto& data : keyframe.data())
+            {
+                if(data.vertexIndex() >= mesh->mNumVertices)
+                {
+                    spdlog::warn("Mesh '{}' deform set {} references missing vertex {}", mesh->mName.C_Str(), setIdx, data.vertexIndex());
+                    continue;
+                }
+                auto vertex = pivotTransform(data.position().vector());
+                animMesh->mVertices[data.vertexIndex()] = aiVector3D{vertex.x, vertex.y, vertex.z};
+            }
+            animMeshes.push_back(animMesh);
+        }
+    }
+
+    mesh->mNumAnimMeshes = static_cast<unsigned int>(animMeshes.size());
+    mesh->mAnimMeshes = new aiAnimMesh*[mesh->mNumAnimMeshes];
+    std::copy(animMeshes.begin(), animMeshes.end(), mesh->mAnimMeshes);
+}
+
+bool W3DImporter::hasLastFile() const
+{
+    return m_hasLastFile;
+}
+
+const W3DFile& W3DImporter::lastFile() const
+{
+    return m_lastFile;
+}
+
+void W3DImporter::resetLastFile()
+{
+    m_lastFile = W3DFile{};
+    m_hasLastFile = false;
 }
\ No newline at end of file
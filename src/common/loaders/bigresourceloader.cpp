@@ -131,4 +131,41 @@ std::shared_ptr<DataResource> BigResourceLoader::get(const std::string& path, bo
 const char* BigResourceLoader::getType() const
 {
     return "BigResourceLoader";
-}
\ No newline at end of file
+}
+
+std::vector<BigFileEntry> BigResourceLoader::listEntries(const std::string& bigFile)
+{
+    std::ifstream file(bigFile, std::ios::binary);
+    if(!file)
+    {
+        throw std::runtime_error(fmt::format("Failed to open big archive '{}'", bigFile));
+    }
+
+    BigFileStructure header(file);
+    std::vector<BigFileEntry> entries;
+    entries.reserve(header.entryCount());
+    for(uint32_t i = 0; i < header.entryCount(); ++i)
+    {
+        entries.emplace_back(file);
+    }
+    return entries;
+}
+
+std::shared_ptr<DataResource> BigResourceLoader::readEntry(const std::string& bigFile, const BigFileEntry& entry)
+{
+    std::ifstream file(bigFile, std::ios::binary);
+    if(!file)
+    {
+        throw std::runtime_error(fmt::format("Failed to open big archive '{}'", bigFile));
+    }
+
+    auto resource = std::make_shared<DataResource>();
+    resource->data.resize(entry.dataSize());
+    file.seekg(entry.dataOffset(), std::ios::beg);
+    file.read(reinterpret_cast<char*>(resource->data.data()), entry.dataSize());
+    if(!file)
+    {
+        throw std::runtime_error(fmt::format("Failed to read '{}' from '{}'", entry.filename(), bigFile));
+    }
+    return resource;
+}
@@ -7,6 +7,7 @@
 
 #include "common/luascriptengine.hpp"
 #include "common/servicelocator.hpp"
+#include "common/objectpool.hpp"
 
 #include "client/gamefrontend.hpp"
 
@@ -57,6 +58,37 @@ SOL_DERIVED_CLASSES(UIElement, UILabel, UIButton, UISpinBox, UITextInput);
 #include "server/physicsmanager.hpp"
 
 
+// what scripts publish through a scene's event bus, handlers subscribe by name
+struct ScriptEvent
+{
+    std::string name;
+    sol::object data;
+};
+
+// component types scripts can pass to Scene3D:view, and how their components are handed to Lua
+struct ScriptComponentType
+{
+    ComponentFilter filter;
+    sol::object (*push)(sol::state_view lua, Component *comp);
+};
+
+template<typename T>
+static ScriptComponentType scriptComponentType()
+{
+    return ScriptComponentType{ComponentFilter::of<T>(), [](sol::state_view lua, Component *comp) { return sol::make_object(lua, static_cast<T*>(comp)); }};
+}
+
+static const std::unordered_map<std::string, ScriptComponentType> &scriptComponentTypes()
+{
+    static const std::unordered_map<std::string, ScriptComponentType> types = {
+        {"NetworkSyncComponent", scriptComponentType<NetworkSyncComponent>()},
+        {"StaticMeshComponent", scriptComponentType<StaticMesh>()},
+        {"AnimatedModelComponent", scriptComponentType<AnimatedModelComponent>()},
+        {"BodyComponent", scriptComponentType<BodyComponent>()},
+    };
+    return types;
+}
+
 ScriptEngine *ScriptEngine::create()
 {
     return new LuaScriptEngine();
@@ -91,7 +123,8 @@ void LuaScriptEngine::init()
         m_globalState.create_named_table("Debug",
                                          "log", []<typename... Args>(const std::string& msg, Args &&...args) { spdlog::info(msg, args); },
                                          "warn", []<typename... Args>(const std::string& msg, Args &&...args) { spdlog::warn(msg, args); },
-                                         "error", []<typename... Args>(const std::string& msg, Args &&...args) { spdlog::error(msg, args); });
+                                         "error", []<typename... Args>(const std::string& msg, Args &&...args) { spdlog::error(msg, args); },
+                                         "getPoolStats", []() { return sol::as_table(clean::ObjectPool::allStats()); });
 
         m_globalState.create_named_table("Client",
                                          "onUpdate", [](const std::function<void (double)> &slot) { GameFrontend::corePtr->updateSubscribe(slot); },
@@ -150,7 +183,19 @@ void LuaScriptEngine::init()
                                                 spdlog::error("Failed to get animation '{}' for model '{}'", animName, modelName);
                                                 return std::shared_ptr<AnimationPrimitive>(nullptr);
                                             }
-                                        });
+                                        },
+                                        "getMorphAnimation", [](const std::string& modelName, const std::string& animName) {
+                                            try
+                                            {
+                                                return ServiceLocator::getModelManager().getMorphAnimation(modelName, animName);
+                                            }
+                                            catch (const std::exception& e)
+                                            {
+                                                spdlog::error("Failed to get morph animation '{}' for model '{}'", animName, modelName);
+                                                return std::shared_ptr<MorphAnimation>(nullptr);
+                                            }
+                                        },
+                                        "setAnimationBakeRate", [](double rate) { ServiceLocator::getModelManager().setAnimationBakeRate(rate); });
 
         m_globalState.create_named_table("MaterialManager",
                                          "createMaterial", sol::factories([&](const glm::vec3 &color, const std::string &name) { return ServiceLocator::getMatManager().createMaterial(color, name); },
@@ -254,20 +299,112 @@ void LuaScriptEngine::init()
                                             sol::call_constructor,
                                             sol::factories([&](const std::string &val) { return uuids::uuid::from_string(val); }));
 
+    m_globalState.new_usertype<EntityHandle>("EntityHandle",
+                                             sol::call_constructor,
+                                             sol::factories([&](uint64_t value) { return EntityHandle::fromValue(value); }),
+                                             "valid", &EntityHandle::valid,
+                                             "value", &EntityHandle::value,
+                                             sol::meta_function::equal_to, [](const EntityHandle &a, const EntityHandle &b) { return a == b; });
+
+    m_globalState.new_usertype<clean::PoolStats>("PoolStats",
+                                                 "name", &clean::PoolStats::name,
+                                                 "slotSize", &clean::PoolStats::slotSize,
+                                                 "live", &clean::PoolStats::live,
+                                                 "highWater", &clean::PoolStats::highWater,
+                                                 "capacity", &clean::PoolStats::capacity,
+                                                 "allocations", &clean::PoolStats::allocations);
+
+    m_globalState.new_usertype<SceneRayHit>("RayHit",
+                                            "entity", &SceneRayHit::entity,
+                                            "meshId", &SceneRayHit::meshId,
+                                            "triangle", &SceneRayHit::triangle,
+                                            "point", &SceneRayHit::point,
+                                            "t", &SceneRayHit::t);
+
+    m_globalState.new_usertype<AnimationLODSettings>("AnimationLODSettings",
+                                                     sol::constructors<AnimationLODSettings()>(),
+                                                     "enabled", &AnimationLODSettings::enabled,
+                                                     "reducedScreenSize", &AnimationLODSettings::reducedScreenSize,
+                                                     "pausedScreenSize", &AnimationLODSettings::pausedScreenSize,
+                                                     "reducedInterval", &AnimationLODSettings::reducedInterval);
+
+    m_globalState.new_usertype<AnimationLODStats>("AnimationLODStats",
+                                                  "full", &AnimationLODStats::full,
+                                                  "reduced", &AnimationLODStats::reduced,
+                                                  "paused", &AnimationLODStats::paused);
+
+    m_globalState.new_usertype<CullingStats>("CullingStats",
+                                             "visible", &CullingStats::visible,
+                                             "culled", &CullingStats::culled);
+
     m_globalState.new_usertype<Scene3D>("Scene3D",
                                         "addObject", &Scene3D::addObject,
-                                        "getObject", &Scene3D::getObject,
+                                        "removeObject", sol::overload(sol::resolve<void(std::shared_ptr<Entity>)>(&Scene3D::removeObject),
+                                                                      sol::resolve<void(const EntityHandle&)>(&Scene3D::removeObject)),
+                                        "getObject", sol::overload(sol::resolve<std::weak_ptr<Entity>(const EntityHandle&) const>(&Scene3D::getObject),
+                                                                   sol::resolve<std::weak_ptr<Entity>(const uuids::uuid&) const>(&Scene3D::getObject)),
                                         "getCamera", &Scene3D::getCamera,
+                                        "publish", [](Scene3D& scene, const std::string& name, sol::object data) { scene.events().publish(ScriptEvent{name, data}); },
+                                        "subscribe", [](Scene3D& scene, const std::string& name, const std::function<void(sol::object)>& handler) {
+                                            return scene.events().subscribe<ScriptEvent>([name, handler](const ScriptEvent& event) {
+                                                if(event.name == name)
+                                                    handler(event.data);
+                                            });
+                                        },
+                                        "unsubscribe", [](Scene3D& scene, clean::EventBus::connection id) { scene.events().unsubscribe<ScriptEvent>(id); },
+                                        // packed arrays indexed by the same row: the entities, then the components of each type
+                                        "view", [](Scene3D& scene, sol::variadic_args names, sol::this_state state) {
+                                            sol::state_view lua(state);
+                                            std::vector<const ScriptComponentType*> types;
+                                            std::vector<ComponentFilter> filters;
+                                            for(auto name : names)
+                                            {
+                                                auto it = scriptComponentTypes().find(name.as<std::string>());
+                                                if(it == scriptComponentTypes().end())
+                                                    throw std::runtime_error(std::format("Unknown component type '{}'", name.as<std::string>()));
+                                                types.push_back(&it->second);
+                                                filters.push_back(it->second.filter);
+                                            }
+
+                                            const SceneQuery& query = scene.query(filters);
+                                            sol::variadic_results results;
+                                            sol::table entities = lua.create_table(static_cast<int>(query.size()), 0);
+                                            for(size_t row = 0; row < query.size(); row++)
+                                                entities[row + 1] = query.entities()[row]->shared_from_this();
+                                            results.push_back(entities);
+                                            for(size_t k = 0; k < types.size(); k++)
+                                            {
+                                                sol::table components = lua.create_table(static_cast<int>(query.size()), 0);
+                                                for(size_t row = 0; row < query.size(); row++)
+                                                    components[row + 1] = types[k]->push(lua, query.component(row, k));
+                                                results.push_back(components);
+                                            }
+                                            return results;
+                                        },
+                                        "raycast", sol::resolve<SceneRayHit(const glm::vec3&, const glm::vec3&) const>(&Scene3D::raycast),
+                                        "queryBox", [](Scene3D& scene, const glm::vec3& min, const glm::vec3& max) { return sol::as_table(scene.queryBox(min, max)); },
+                                        "querySphere", [](Scene3D& scene, const glm::vec3& center, float radius) { return sol::as_table(scene.querySphere(center, radius)); },
+                                        "queryFrustum", [](Scene3D& scene, Camera3D& camera) { return sol::as_table(scene.queryFrustum(camera)); },
+                                        "queryRay", [](Scene3D& scene, const glm::vec3& from, const glm::vec3& to) { return sol::as_table(scene.queryRay(from, to)); },
                                         "setLightCount", &Scene3D::setLightCount,
                                         "setLightPosition", &Scene3D::setLightPosition,
-                                        "setLightColor", &Scene3D::setLightColor);
+                                        "setLightColor", &Scene3D::setLightColor,
+                                        "setPoseCacheTolerance", [](Scene3D& scene, double seconds) { scene.animations().poseCache().setTolerance(seconds); },
+                                        "setAnimationLOD", [](Scene3D& scene, const AnimationLODSettings& settings) { scene.animations().setLODSettings(settings); },
+                                        "getAnimationLOD", [](Scene3D& scene) { return scene.animations().lodSettings(); },
+                                        "getAnimationLODStats", [](Scene3D& scene) { return scene.animations().lastLODStats(); },
+                                        "setFrustumCulling", &Scene3D::setFrustumCulling,
+                                        "getCullingStats", &Scene3D::lastCullingStats,
+                                        "getRecomputedTransformCount", [](Scene3D& scene) { return scene.transforms().lastRecomputed(); });
 
     // defining object types
     m_globalState.new_usertype<Entity>("Entity",
                                        sol::call_constructor,
-                                       sol::factories([&]() { return std::make_shared<Entity>(); },
-                                                      [&](const uuids::uuid& id) { return std::make_shared<Entity>(id); } ),
+                                       sol::factories([&]() { return clean::makePooled<Entity>(); },
+                                                      [&](const uuids::uuid& id) { return clean::makePooled<Entity>(id); } ),
                                        "getID", &Entity::getID,
+                                       "hasID", &Entity::hasID,
+                                       "getHandle", &Entity::getHandle,
                                        "setPosition", &Entity::setPosition,
                                        "getPosition", &Entity::getPosition,
                                        "setRotation", &Entity::setRotation,
@@ -276,6 +413,9 @@ void LuaScriptEngine::init()
                                        "getEulerRotation", &Entity::getEulerRotation,
                                        "setScale", &Entity::setScale,
                                        "getScale", &Entity::getScale,
+                                       "getWorldPosition", &Entity::getWorldPosition,
+                                       "setParent", &Entity::setParent,
+                                       "getParent", &Entity::getParent,
                                        "onUpdate", &Entity::updateSubscribe,
                                        "destroy", &Entity::destroy,
                                        "onDestroy", &Entity::destroySubscribe,
@@ -284,7 +424,7 @@ void LuaScriptEngine::init()
 
     m_globalState.new_usertype<Camera3D>("Camera3D",
                                          sol::call_constructor,
-                                         sol::factories([&]() { return std::make_shared<Camera3D>(); }),
+                                         sol::factories([&]() { return clean::makePooled<Camera3D>(); }),
                                          "setPosition", &Camera3D::setPosition,
                                          "getPosition", &Camera3D::getPosition,
                                          "setRotation", &Camera3D::setRotation,
@@ -299,18 +439,26 @@ void LuaScriptEngine::init()
     // components
     m_globalState.new_usertype<NetworkSyncComponent>("NetworkSyncComponent",
                                                      sol::call_constructor,
-                                                     sol::factories([&](std::shared_ptr<Entity> parent) { return std::make_shared<NetworkSyncComponent>(parent); }));
+                                                     sol::factories([&](std::shared_ptr<Entity> parent) { return clean::makePooled<NetworkSyncComponent>(parent); }));
 
     m_globalState.new_usertype<StaticMesh>("StaticMeshComponent",
                                            sol::call_constructor,
                                            sol::factories([&](std::shared_ptr<Entity> parent) { return StaticMesh::createComponent(parent); }),
-                                           "setModelId", &StaticMesh::setModelId);
+                                           "setModelId", &StaticMesh::setModelId,
+                                           "lodLevel", &StaticMesh::lodLevel);
 
     m_globalState.new_usertype<AnimatedModelComponent>("AnimatedModelComponent",
                                                        sol::call_constructor,
-                                                       sol::factories([&](std::shared_ptr<Entity> parent) { return std::make_shared<AnimatedModelComponent>(parent); }),
+                                                       sol::factories([&](std::shared_ptr<Entity> parent) { return clean::makePooled<AnimatedModelComponent>(parent); }),
                                                        "setModelId", &AnimatedModelComponent::setModelId,
+                                                       "lodLevel", &AnimatedModelComponent::lodLevel,
                                                        "setAnimation", &AnimatedModelComponent::setAnimation,
+                                                       "crossFade", &AnimatedModelComponent::crossFade,
+                                                       "setFadeDuration", &AnimatedModelComponent::setFadeDuration,
+                                                       "setAdditiveLayer", &AnimatedModelComponent::setAdditiveLayer,
+                                                       "setLayerWeight", &AnimatedModelComponent::setLayerWeight,
+                                                       "setMorphAnimation", sol::overload([](AnimatedModelComponent& self, std::shared_ptr<MorphAnimation> anim) { self.setMorphAnimation(anim); },
+                                                                                          [](AnimatedModelComponent& self, std::shared_ptr<MorphAnimation> anim, bool looping) { self.setMorphAnimation(anim, looping); }),
                                                        "trigger", &AnimatedModelComponent::trigger);
 
     m_globalState.new_usertype<UILabel>("Label",
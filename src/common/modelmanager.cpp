@@ -1,22 +1,20 @@
 #include <stdexcept>
 #include <cassert>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 #include <fmt/format.h>
 #include <boost/algorithm/string.hpp>
 #include <spdlog/spdlog.h>
+#include <glm/glm.hpp>
 
 #include "common/modelmanager.hpp"
 #include "common/servicelocator.hpp"
-#include "common/importers/w3dimporter.hpp"
 
 #include "common/3d/animationprimitive.hpp"
+#include "common/3d/modelcache.hpp"
 
 
 ModelManager::ModelManager()
+    : m_importer(new ResourcesIOSystem()), m_animationBakeRate(0.0)
 {
-    m_importer.SetIOHandler(new ResourcesIOSystem());
-    m_importer.RegisterLoader(new W3DImporter());
 }
 
 ModelManager::~ModelManager()
@@ -24,217 +22,164 @@ ModelManager::~ModelManager()
 
 }
 
-void enumerateNodeMeshes(aiNode* node, std::vector<uint32_t>& meshes)
+void ModelManager::import_model(const std::string &path, const std::string &name, bool allocateGraphics)
 {
-    for(unsigned int i=0; i < node->mNumMeshes; i++)
+    if(m_models.find(name) != m_models.end())
     {
-        meshes.push_back(node->mMeshes[i]);
+        throw std::runtime_error(fmt::format("Model '{}' already exists", name));
     }
 
-    for(unsigned int i=0; i < node->mNumChildren; i++)
+    auto model = load_cooked(path);
+    if(model == nullptr)
+    {
+        model = m_importer.importFile(path, name);
+    }
+    m_models.try_emplace(name, model);
+    if(m_animationBakeRate > 0.0)
     {
-        enumerateNodeMeshes(node->mChildren[i], meshes);
+        bake_animations(name, model);
+    }
+
+    if(allocateGraphics)
+    {
+        allocate_graphics(name, model);
     }
 }
 
-void unwrapNodeTree(aiNode* node, std::unordered_map<std::string, aiNode*>& unwrappedNodeTree)
+std::shared_ptr<ModelPrimitive> ModelManager::load_cooked(const std::string& path) const
 {
-    unwrappedNodeTree.try_emplace(node->mName.C_Str(), node);
-    for(unsigned int i=0; i < node->mNumChildren; i++)
+    std::string cookedPath = ModelCache::cookedPath(path);
+    auto& resources = ServiceLocator::getResourceManager();
+    if(!resources.contains(cookedPath))
+        return nullptr;
+
+    try
     {
-        unwrapNodeTree(node->mChildren[i], unwrappedNodeTree);
+        return ModelCache::deserialize(resources.get(cookedPath)->data);
     }
+    catch(const std::exception& e)
+    {
+        spdlog::warn("Failed to load cooked model '{}', importing source: {}", cookedPath, e.what());
+    }
+    return nullptr;
 }
 
-void cumulativeNodeTransform(aiNode* node, aiMatrix4x4& transform)
+void ModelManager::allocate_graphics(const std::string& name, std::shared_ptr<ModelPrimitive> model)
 {
-    transform = node->mTransformation * transform;
-    if (node->mParent)
-        cumulativeNodeTransform(node->mParent, transform);
+    size_t modelId = ServiceLocator::getRenderer().allocateModel(model);
+    m_modelIDs.try_emplace(name, modelId);
+    m_modelsById.try_emplace(modelId, model);
 }
 
-void ModelManager::import_model(const std::string &path, const std::string &name, bool allocateGraphics)
+void ModelManager::bake_animations(const std::string& name, std::shared_ptr<ModelPrimitive> model) const
 {
-    const aiScene* scene = m_importer.ReadFile(path, aiProcess_Triangulate |
-                                                     aiProcess_GenNormals |
-                                                     aiProcess_JoinIdenticalVertices);
-    if(scene == nullptr) {
-        throw std::runtime_error(fmt::format("Failed to import model '{}': {}", name, m_importer.GetErrorString()));
-    }
-
-    if(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)
+    for(size_t i = 0; i < model->animationCount(); i++)
     {
-        throw std::runtime_error(fmt::format("Model data '{}' is malformed: ", name));
+        auto anim = model->animation(i);
+        auto report = anim->bake(m_animationBakeRate);
+        spdlog::info("Baked animation '{}' of '{}' at {} Hz: {} frames, {} -> {} bytes, max error {:.5f} (translation), {:.5f} (matrix)",
+                     anim->name(), name, report.rate, report.frames, report.keyBytes, report.bakedBytes,
+                     report.maxTranslationError, report.maxMatrixError);
     }
+}
 
-    if(!scene->HasMeshes())
+size_t ModelManager::getModelId(const std::string &name) const
+{
+    auto it = m_modelIDs.find(name);
+    if(it == m_modelIDs.end())
     {
-        throw std::runtime_error(fmt::format("Model data '{}' has no meshes", name));
+        throw std::runtime_error(fmt::format("Model '{}' does not exist", name));
     }
+    return it->second;
+}
 
-    std::unordered_map<std::string, aiNode*> unwrappedNodeTree;
-    unwrapNodeTree(scene->mRootNode, unwrappedNodeTree);
-
-    auto model = std::make_shared<ModelPrimitive>();
-    for(unsigned int meshId = 0; meshId < scene->mNumMeshes; meshId++)
-    {
-        const aiMesh* mesh = scene->mMeshes[meshId];
-        aiString meshName = mesh->mName;
-        if(!mesh->HasPositions())
-        {
-            throw std::runtime_error(fmt::format("Model data '{}' has no vertices", name));
-        }
-        if(!mesh->HasNormals())
-        {
-            spdlog::warn("Model data '{}' has no normals", name);
-        }
-        if(!mesh->HasTextureCoords(0))
-        {
-            spdlog::warn("Model data '{}' has no texture coordinates", name);
-            continue; // skip for now
-        }
-        if(!mesh->HasFaces())
-        {
-            throw std::runtime_error(fmt::format("Model data '{}' has no faces", name));
-        }
+std::shared_ptr<ModelPrimitive> ModelManager::getModel(size_t modelId) const
+{
+    auto it = m_modelsById.find(modelId);
+    if(it == m_modelsById.end())
+        return nullptr;
+    return it->second;
+}
 
-        auto meshPrimitive = std::make_shared<MeshPrimitive>(meshName.C_Str(), meshId);
-        for(unsigned int j = 0; j < mesh->mNumVertices; j++)
-        {
-            aiVector3D pos = mesh->mVertices[j];
-            aiVector3D norm = norm = mesh->mNormals[j];
-            const aiVector3D& tex = mesh->mTextureCoords[0][j];
-
-            auto meshNodeIt = unwrappedNodeTree.find(mesh->mName.C_Str());
-            if(meshNodeIt != unwrappedNodeTree.end())
-            {
-                aiMatrix4x4 transform = meshNodeIt->second->mTransformation;
-                pos = transform * pos;
-                norm = transform * norm;
-            }
-
-            meshPrimitive->addVertex(VertexPrimitive(glm::vec3(pos.x, pos.y, pos.z),
-                                                    glm::vec3(norm.x, norm.y, norm.z),
-                                                    glm::vec2(tex.x, tex.y)));
-        }
+static bool segmentHitsSphere(const RaySegment& ray, float maxT, const glm::vec3& center, float radius)
+{
+    float dirLength2 = glm::dot(ray.direction, ray.direction);
+    if(dirLength2 <= 0.f)
+        return false;
+    float t = glm::clamp(glm::dot(center - ray.origin, ray.direction) / dirLength2, 0.f, maxT);
+    glm::vec3 closest = ray.origin + ray.direction * t;
+    return glm::dot(closest - center, closest - center) <= radius * radius;
+}
 
-        for(unsigned int j = 0; j < mesh->mNumFaces; j++)
-        {
-            aiFace face = mesh->mFaces[j];
-            if(face.mNumIndices != 3)
-            {
-                throw std::runtime_error(fmt::format("Model data '{}' has non-triangular faces", name));
-            }
-            meshPrimitive->addIndex(face.mIndices[0]);
-            meshPrimitive->addIndex(face.mIndices[1]);
-            meshPrimitive->addIndex(face.mIndices[2]);
-        }
+size_t ModelManager::raycast(size_t modelId, const glm::mat4& modelMatrix, const std::vector<RaySegment>& rays, std::vector<ModelRayHit>& hits) const
+{
+    auto model = getModel(modelId);
+    if(model == nullptr)
+        return 0;
 
-        model->addMesh(meshPrimitive);
-    }
+    if(hits.size() < rays.size())
+        throw std::runtime_error(fmt::format("Raycast needs {} hit slots, got {}", rays.size(), hits.size()));
 
-    for(unsigned int i=0; i < scene->mNumMaterials; i++)
-    {
-        const aiMaterial* material = scene->mMaterials[i];
-        aiString materialName;
-        material->Get(AI_MATKEY_NAME, materialName);
-        spdlog::info("Texture name: {}", materialName.C_Str());
-    }
+    glm::mat4 invModel = glm::inverse(modelMatrix);
+    glm::vec3 center = modelMatrix * glm::vec4(model->boundingCenter(), 1.f);
+    float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+                           std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    float radius = model->boundingRadius() * scale;
 
-    for (unsigned int i = 0; i < scene->mNumAnimations; i++)
+    size_t hitCount = 0;
+    for(size_t i = 0; i < rays.size(); i++)
     {
-        const aiAnimation* animation = scene->mAnimations[i];
-        aiString animName = animation->mName;
-
-        auto animationPrimitive = std::make_shared<AnimationPrimitive>(animName.C_Str(), animation->mDuration);
-        for (unsigned int channelId = 0; channelId < animation->mNumChannels; channelId++)
+        const RaySegment& ray = rays[i];
+        float maxT = std::min(ray.maxT, hits[i].t);
+        if(!segmentHitsSphere(ray, maxT, center, radius))
+            continue;
+
+        // t is preserved by the affine transform, so no rescaling is needed
+        RaySegment localRay{glm::vec3(invModel * glm::vec4(ray.origin, 1.f)),
+                            glm::vec3(invModel * glm::vec4(ray.direction, 0.f)),
+                            maxT};
+        ModelRayHit hit;
+        if(model->raycast(localRay, hit))
         {
-            const aiNodeAnim* nodeAnim = animation->mChannels[channelId];
-            aiString nodeName = nodeAnim->mNodeName;
-            auto nodeIt = unwrappedNodeTree.find(nodeAnim->mNodeName.C_Str());
-            if (nodeIt == unwrappedNodeTree.end())
-            {
-                spdlog::warn("No suitable node named '{}' found", nodeName.C_Str());
-                continue;
-            }
-
-            aiNode* meshNode = nodeIt->second;
-            std::vector<unsigned int> channelMeshIds;
-            enumerateNodeMeshes(meshNode, channelMeshIds);
-            animationPrimitive->setMeshIds(channelId, channelMeshIds);
-            // aiMatrix4x4 nodeTransform; // identity matrix
-            // cumulativeNodeTransform(meshNode, nodeTransform);
-
-            uint32_t frameCount = std::max(nodeAnim->mNumPositionKeys, std::max(nodeAnim->mNumRotationKeys, nodeAnim->mNumScalingKeys));
-            for (unsigned int frameId = 0; frameId < frameCount; frameId++)
-            {
-                AnimationKeyFrame keyframe;
-                double timecode = 0.0;
-                if (frameId < nodeAnim->mNumPositionKeys)
-                {
-                    aiVectorKey posKey = nodeAnim->mPositionKeys[frameId];
-                    timecode = posKey.mTime;
-                    aiVector3D pos = posKey.mValue;
-                    keyframe.setPosition(glm::vec3(pos.x, pos.y, pos.z));
-                }
-                if (frameId < nodeAnim->mNumRotationKeys)
-                {
-                    aiQuatKey rotKey = nodeAnim->mRotationKeys[frameId];
-                    timecode = std::max(timecode, rotKey.mTime);
-                    aiQuaternion rot = rotKey.mValue;
-                    keyframe.setRotation(glm::quat(rot.w, rot.x, rot.y, rot.z));
-                }
-                if (frameId < nodeAnim->mNumScalingKeys)
-                {
-                    aiVectorKey sclKey = nodeAnim->mScalingKeys[frameId];
-                    timecode = std::max(timecode, sclKey.mTime);
-                    aiVector3D scl = sclKey.mValue;
-                    keyframe.setScale(glm::vec3(scl.x, scl.y, scl.z));
-                }
-                keyframe.setTime(timecode);
-
-                animationPrimitive->addKeyframe(channelId, keyframe);
-            }
+            hit.point = ray.origin + ray.direction * hit.t;
+            hits[i] = hit;
+            hitCount++;
         }
-        model->addAnimation(animationPrimitive);
-    }
-
-    auto r = m_models.try_emplace(name, model);
-    if(!r.second)
-    {
-        throw std::runtime_error(fmt::format("Model '{}' already exists", name));
     }
+    return hitCount;
+}
 
-    m_importer.FreeScene();
+std::shared_ptr<AnimationPrimitive> ModelManager::getAnimation(const std::string& modelName, const std::string& animationName) const
+{
+    auto modelIt = m_models.find(modelName);
+    if (modelIt == m_models.end())
+        throw std::runtime_error(fmt::format("Model '{}' not found", modelName));
 
-    if(allocateGraphics)
-    {
-        allocate_graphics(name, model);
-    }
+    return modelIt->second->animation(animationName);
 }
 
-void ModelManager::allocate_graphics(const std::string& name, std::shared_ptr<ModelPrimitive> model)
+std::shared_ptr<MorphAnimation> ModelManager::getMorphAnimation(const std::string& modelName, const std::string& animationName) const
 {
-    m_modelIDs.try_emplace(name, ServiceLocator::getRenderer().allocateModel(model));
+    auto modelIt = m_models.find(modelName);
+    if (modelIt == m_models.end())
+        throw std::runtime_error(fmt::format("Model '{}' not found", modelName));
+
+    return modelIt->second->morphAnimation(animationName);
 }
 
-size_t ModelManager::getModelId(const std::string &name) const
+void ModelManager::setAnimationCompression(bool enabled, const AnimationCompressionSettings& settings)
 {
-    auto it = m_modelIDs.find(name);
-    if(it == m_modelIDs.end())
-    {
-        throw std::runtime_error(fmt::format("Model '{}' does not exist", name));
-    }
-    return it->second;
+    m_importer.setAnimationCompression(enabled, settings);
 }
 
-std::shared_ptr<AnimationPrimitive> ModelManager::getAnimation(const std::string& modelName, const std::string& animationName) const
+void ModelManager::setAnimationBakeRate(double rate)
 {
-    auto modelIt = m_models.find(modelName);
-    if (modelIt == m_models.end())
-        throw std::runtime_error(fmt::format("Model '{}' not found", modelName));
+    m_animationBakeRate = std::max(rate, 0.0);
+}
 
-    return modelIt->second->animation(animationName);
+double ModelManager::animationBakeRate() const
+{
+    return m_animationBakeRate;
 }
 
 ResourcesIOStream::ResourcesIOStream(const std::string &path)
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstdlib>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+#include "common/objectpool.hpp"
+
+namespace clean
+{
+
+static constexpr size_t FIRST_BLOCK_SLOTS = 64;
+static constexpr size_t MAX_BLOCK_SLOTS = 4096;
+
+// leaked like the pools themselves
+static std::mutex& registryMutex()
+{
+    static std::mutex* mutex = new std::mutex();
+    return *mutex;
+}
+
+static std::vector<ObjectPool*>& registry()
+{
+    static std::vector<ObjectPool*>* pools = new std::vector<ObjectPool*>();
+    return *pools;
+}
+
+static std::string typeName(const std::type_info& type)
+{
+#ifdef __GNUG__
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    if (status == 0 && demangled != nullptr)
+    {
+        std::string name(demangled);
+        std::free(demangled);
+        return name;
+    }
+#endif
+    return type.name();
+}
+
+ObjectPool::ObjectPool(const std::type_info& type, size_t slotSize, size_t alignment)
+    : m_name(typeName(type)), m_alignment(std::max(alignment, alignof(FreeSlot))), m_freeSlots(nullptr),
+      m_live(0), m_highWater(0), m_capacity(0), m_allocations(0)
+{
+    // every slot starts on the alignment and can hold the free list link
+    m_slotSize = (std::max(slotSize, sizeof(FreeSlot)) + m_alignment - 1) / m_alignment * m_alignment;
+
+    std::lock_guard<std::mutex> lock(registryMutex());
+    registry().push_back(this);
+}
+
+ObjectPool::~ObjectPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto& pools = registry();
+        pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+    }
+    for (void* block : m_blocks)
+        ::operator delete(block, std::align_val_t(m_alignment));
+}
+
+void* ObjectPool::allocate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_freeSlots == nullptr)
+        addBlock(std::clamp(m_capacity, FIRST_BLOCK_SLOTS, MAX_BLOCK_SLOTS));
+
+    FreeSlot* slot = m_freeSlots;
+    m_freeSlots = slot->next;
+    m_live++;
+    m_highWater = std::max(m_highWater, m_live);
+    m_allocations++;
+    return slot;
+}
+
+void ObjectPool::deallocate(void* slot)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto freed = static_cast<FreeSlot*>(slot);
+    freed->next = m_freeSlots;
+    m_freeSlots = freed;
+    m_live--;
+}
+
+void ObjectPool::addBlock(size_t slots)
+{
+    auto block = static_cast<char*>(::operator new(slots * m_slotSize, std::align_val_t(m_alignment)));
+    m_blocks.push_back(block);
+    m_capacity += slots;
+
+    // linked back to front, so the block is handed out in address order
+    for (size_t i = slots; i-- > 0;)
+    {
+        auto slot = reinterpret_cast<FreeSlot*>(block + i * m_slotSize);
+        slot->next = m_freeSlots;
+        m_freeSlots = slot;
+    }
+}
+
+PoolStats ObjectPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return PoolStats{m_name, m_slotSize, m_live, m_highWater, m_capacity, m_allocations};
+}
+
+std::vector<PoolStats> ObjectPool::allStats()
+{
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::vector<PoolStats> result;
+    result.reserve(registry().size());
+    for (const ObjectPool* pool : registry())
+        result.push_back(pool->stats());
+    return result;
+}
+
+} // namespace clean
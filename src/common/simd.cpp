@@ -0,0 +1,225 @@
+#include <cmath>
+
+#include "common/simd.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CLEAN_SIMD_SSE
+#endif
+
+namespace clean::simd
+{
+
+void lerp(float *dst, const float *from, const float *to, float t, size_t count)
+{
+    size_t i = 0;
+#ifdef CLEAN_SIMD_SSE
+    __m128 vt = _mm_set1_ps(t);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 a = _mm_loadu_ps(from + i);
+        __m128 b = _mm_loadu_ps(to + i);
+        _mm_storeu_ps(dst + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), vt)));
+    }
+#endif
+    for(; i < count; i++)
+        dst[i] = from[i] + (to[i] - from[i]) * t;
+}
+
+void addScaledDifference(float *dst, const float *value, const float *reference, float weight, size_t count)
+{
+    size_t i = 0;
+#ifdef CLEAN_SIMD_SSE
+    __m128 vw = _mm_set1_ps(weight);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 diff = _mm_sub_ps(_mm_loadu_ps(value + i), _mm_loadu_ps(reference + i));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(diff, vw)));
+    }
+#endif
+    for(; i < count; i++)
+        dst[i] += (value[i] - reference[i]) * weight;
+}
+
+#ifdef CLEAN_SIMD_SSE
+// horizontal sum of a * b in every lane
+static inline __m128 dot4(__m128 a, __m128 b)
+{
+    __m128 m = _mm_mul_ps(a, b);
+    m = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+#endif
+
+void nlerpQuats(float *dst, const float *from, const float *to, float t, size_t count)
+{
+#ifdef CLEAN_SIMD_SSE
+    __m128 vt = _mm_set1_ps(t);
+    __m128 signMask = _mm_set1_ps(-0.f);
+    for(size_t i = 0; i < count; i++)
+    {
+        __m128 a = _mm_loadu_ps(from + i * 4);
+        __m128 b = _mm_loadu_ps(to + i * 4);
+        // q and -q are the same rotation, flip b onto a's hemisphere
+        __m128 negative = _mm_cmplt_ps(dot4(a, b), _mm_setzero_ps());
+        b = _mm_xor_ps(b, _mm_and_ps(negative, signMask));
+        __m128 r = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), vt));
+        _mm_storeu_ps(dst + i * 4, _mm_div_ps(r, _mm_sqrt_ps(dot4(r, r))));
+    }
+#else
+    for(size_t i = 0; i < count; i++)
+    {
+        const float *a = from + i * 4;
+        const float *b = to + i * 4;
+        float sign = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.f ? -1.f : 1.f;
+        float r[4];
+        for(int c = 0; c < 4; c++)
+            r[c] = a[c] + (b[c] * sign - a[c]) * t;
+        float invLength = 1.f / std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+        for(int c = 0; c < 4; c++)
+            dst[i * 4 + c] = r[c] * invLength;
+    }
+#endif
+}
+
+static void composeTransform(const float *p, const float *q, const float *s, float *m)
+{
+    float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+    float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+    float wx = q[3] * q[0], wy = q[3] * q[1], wz = q[3] * q[2];
+
+    m[0] = (1.f - 2.f * (yy + zz)) * s[0];
+    m[1] = 2.f * (xy + wz) * s[0];
+    m[2] = 2.f * (xz - wy) * s[0];
+    m[3] = 0.f;
+    m[4] = 2.f * (xy - wz) * s[1];
+    m[5] = (1.f - 2.f * (xx + zz)) * s[1];
+    m[6] = 2.f * (yz + wx) * s[1];
+    m[7] = 0.f;
+    m[8] = 2.f * (xz + wy) * s[2];
+    m[9] = 2.f * (yz - wx) * s[2];
+    m[10] = (1.f - 2.f * (xx + yy)) * s[2];
+    m[11] = 0.f;
+    m[12] = p[0];
+    m[13] = p[1];
+    m[14] = p[2];
+    m[15] = 1.f;
+}
+
+void composeTransforms(const uint32_t *indices, size_t count, const float *positions, const float *rotations, const float *scales, float *matrices)
+{
+    size_t i = 0;
+#ifdef CLEAN_SIMD_SSE
+    // one element per lane: transpose four quaternions into x, y, z, w registers, compose, transpose the columns back
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 two = _mm_set1_ps(2.f);
+    for(; i + 4 <= count; i += 4)
+    {
+        const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2], d = indices[i + 3];
+        __m128 qx = _mm_loadu_ps(rotations + a * 4);
+        __m128 qy = _mm_loadu_ps(rotations + b * 4);
+        __m128 qz = _mm_loadu_ps(rotations + c * 4);
+        __m128 qw = _mm_loadu_ps(rotations + d * 4);
+        _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+        __m128 sx = _mm_setr_ps(scales[a * 3], scales[b * 3], scales[c * 3], scales[d * 3]);
+        __m128 sy = _mm_setr_ps(scales[a * 3 + 1], scales[b * 3 + 1], scales[c * 3 + 1], scales[d * 3 + 1]);
+        __m128 sz = _mm_setr_ps(scales[a * 3 + 2], scales[b * 3 + 2], scales[c * 3 + 2], scales[d * 3 + 2]);
+
+        __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+        __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+        __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+        __m128 col0[4] = {_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                          _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                          _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                          _mm_setzero_ps()};
+        __m128 col1[4] = {_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                          _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                          _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                          _mm_setzero_ps()};
+        __m128 col2[4] = {_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                          _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                          _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                          _mm_setzero_ps()};
+        _MM_TRANSPOSE4_PS(col0[0], col0[1], col0[2], col0[3]);
+        _MM_TRANSPOSE4_PS(col1[0], col1[1], col1[2], col1[3]);
+        _MM_TRANSPOSE4_PS(col2[0], col2[1], col2[2], col2[3]);
+
+        const uint32_t lanes[4] = {a, b, c, d};
+        for(int lane = 0; lane < 4; lane++)
+        {
+            float *m = matrices + lanes[lane] * 16;
+            const float *p = positions + lanes[lane] * 3;
+            _mm_storeu_ps(m, col0[lane]);
+            _mm_storeu_ps(m + 4, col1[lane]);
+            _mm_storeu_ps(m + 8, col2[lane]);
+            _mm_storeu_ps(m + 12, _mm_setr_ps(p[0], p[1], p[2], 1.f));
+        }
+    }
+#endif
+    for(; i < count; i++)
+        composeTransform(positions + indices[i] * 3, rotations + indices[i] * 4, scales + indices[i] * 3, matrices + indices[i] * 16);
+}
+
+void spheresInPlanes(const float *planes, size_t planeCount, const float *x, const float *y, const float *z, const float *radius,
+                     size_t count, uint8_t *visible)
+{
+    size_t i = 0;
+#ifdef CLEAN_SIMD_SSE
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(size_t p = 0; p < planeCount; p++)
+        {
+            const float *plane = planes + p * 4;
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(plane[0])), _mm_mul_ps(vy, _mm_set1_ps(plane[1]))),
+                                         _mm_add_ps(_mm_mul_ps(vz, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+        int mask = _mm_movemask_ps(inside);
+        visible[i] = mask & 1;
+        visible[i + 1] = (mask >> 1) & 1;
+        visible[i + 2] = (mask >> 2) & 1;
+        visible[i + 3] = (mask >> 3) & 1;
+    }
+#endif
+    for(; i < count; i++)
+    {
+        bool inside = true;
+        for(size_t p = 0; p < planeCount && inside; p++)
+        {
+            const float *plane = planes + p * 4;
+            inside = x[i] * plane[0] + y[i] * plane[1] + z[i] * plane[2] + plane[3] >= -radius[i];
+        }
+        visible[i] = inside ? 1 : 0;
+    }
+}
+
+void frustumPlanes(const float *viewProj, float *planes)
+{
+    // straight from the rows of the matrix, near is z >= 0 with the [0, 1] depth range
+    for(int k = 0; k < 4; k++)
+    {
+        const float *column = viewProj + k * 4;
+        planes[k] = column[3] + column[0];
+        planes[4 + k] = column[3] - column[0];
+        planes[8 + k] = column[3] + column[1];
+        planes[12 + k] = column[3] - column[1];
+        planes[16 + k] = column[2];
+        planes[20 + k] = column[3] - column[2];
+    }
+    for(int p = 0; p < 6; p++)
+    {
+        float *plane = planes + p * 4;
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for(int k = 0; k < 4; k++)
+            plane[k] /= length;
+    }
+}
+
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+
+#include "common/threadpool.hpp"
+
+static thread_local bool insideLoop = false;
+
+static uint64_t packRange(uint32_t begin, uint32_t end)
+{
+    return (static_cast<uint64_t>(end) << 32) | begin;
+}
+
+static uint32_t rangeBegin(uint64_t range)
+{
+    return static_cast<uint32_t>(range);
+}
+
+static uint32_t rangeEnd(uint64_t range)
+{
+    return static_cast<uint32_t>(range >> 32);
+}
+
+ThreadPool::ThreadPool(unsigned workerCount)
+    : m_task(nullptr), m_count(0), m_grain(1), m_generation(0), m_busy(0), m_stop(false), m_stolen(0)
+{
+    if (workerCount == 0)
+        workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+    m_ranges = std::make_unique<WorkRange[]>(workerCount + 1);
+    for (unsigned i = 0; i <= workerCount; i++)
+        m_ranges[i].chunks = 0;
+    m_workers.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; i++)
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+unsigned ThreadPool::threadCount() const
+{
+    return static_cast<unsigned>(m_workers.size()) + 1;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+    grain = std::max<size_t>(grain, 1);
+    if (count == 0)
+        return;
+    if (m_workers.empty() || count <= grain || insideLoop)
+    {
+        for (size_t begin = 0; begin < count; begin += grain)
+            fn(begin, std::min(begin + grain, count));
+        return;
+    }
+    // chunk indices have to fit the packed ranges
+    size_t chunkCount = (count + grain - 1) / grain;
+    if (chunkCount > UINT32_MAX)
+        grain = (count + UINT32_MAX - 1) / UINT32_MAX;
+    chunkCount = (count + grain - 1) / grain;
+
+    std::lock_guard<std::mutex> loopLock(m_loopMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &fn;
+        m_count = count;
+        m_grain = grain;
+        m_error = nullptr;
+        unsigned threads = threadCount();
+        for (unsigned i = 0; i < threads; i++)
+            m_ranges[i].chunks = packRange(static_cast<uint32_t>(chunkCount * i / threads), static_cast<uint32_t>(chunkCount * (i + 1) / threads));
+        m_busy = static_cast<unsigned>(m_workers.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_task = nullptr;
+    if (m_error)
+        std::rethrow_exception(m_error);
+}
+
+uint64_t ThreadPool::stolenChunks() const
+{
+    return m_stolen.load(std::memory_order_relaxed);
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+            seen = m_generation;
+        }
+
+        runChunks(index);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+            m_done.notify_one();
+    }
+}
+
+void ThreadPool::runChunks(unsigned index)
+{
+    insideLoop = true;
+    uint32_t chunk;
+    while (popChunk(index, chunk) || stealChunk(index, chunk))
+    {
+        size_t begin = static_cast<size_t>(chunk) * m_grain;
+        try
+        {
+            (*m_task)(begin, std::min(begin + m_grain, m_count));
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error)
+                m_error = std::current_exception();
+        }
+    }
+    insideLoop = false;
+}
+
+bool ThreadPool::popChunk(unsigned index, uint32_t& chunk)
+{
+    // the owner takes from the front
+    auto& chunks = m_ranges[index].chunks;
+    uint64_t range = chunks.load(std::memory_order_acquire);
+    while (rangeBegin(range) < rangeEnd(range))
+    {
+        if (chunks.compare_exchange_weak(range, packRange(rangeBegin(range) + 1, rangeEnd(range)), std::memory_order_acq_rel))
+        {
+            chunk = rangeBegin(range);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::stealChunk(unsigned index, uint32_t& chunk)
+{
+    // thieves take the back half, run one chunk of it and keep the rest as their own range
+    // a thread only steals with an empty range, and ranges never grow back, so nobody else writes it meanwhile
+    unsigned threads = threadCount();
+    for (unsigned offset = 1; offset < threads; offset++)
+    {
+        auto& victim = m_ranges[(index + offset) % threads].chunks;
+        uint64_t range = victim.load(std::memory_order_acquire);
+        while (rangeBegin(range) < rangeEnd(range))
+        {
+            uint32_t begin = rangeBegin(range);
+            uint32_t end = rangeEnd(range);
+            uint32_t middle = begin + (end - begin) / 2;
+            if (victim.compare_exchange_weak(range, packRange(begin, middle), std::memory_order_acq_rel))
+            {
+                chunk = middle;
+                m_ranges[index].chunks.store(packRange(middle + 1, end), std::memory_order_release);
+                m_stolen.fetch_add(end - middle, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "server/animationposecache.hpp"
+
+
+double PoseCacheStats::hitRate() const
+{
+    return lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+}
+
+AnimationPoseCache::AnimationPoseCache()
+    : m_tolerance(0.0)
+{
+
+}
+
+void AnimationPoseCache::setTolerance(double seconds)
+{
+    m_tolerance = std::max(seconds, 0.0);
+}
+
+double AnimationPoseCache::tolerance() const
+{
+    return m_tolerance;
+}
+
+bool AnimationPoseCache::enabled() const
+{
+    return m_tolerance > 0.0;
+}
+
+std::shared_ptr<AnimationPose> AnimationPoseCache::acquire(const AnimationPrimitive* anim, const ModelNodeTree* nodes, const ModelSkeleton* skeleton, double timecode,
+                                                           double& quantizedTime, bool& evaluate)
+{
+    Key key{anim, nodes, skeleton, static_cast<int64_t>(std::floor(timecode / m_tolerance + 0.5))};
+    quantizedTime = key.step * m_tolerance;
+    m_current.lookups++;
+
+    auto it = m_frame.find(key);
+    if (it != m_frame.end())
+    {
+        m_current.hits++;
+        evaluate = false;
+        return it->second;
+    }
+
+    std::shared_ptr<AnimationPose> pose;
+    if (!m_free.empty())
+    {
+        pose = std::move(m_free.back());
+        m_free.pop_back();
+    }
+    else
+        pose = std::make_shared<AnimationPose>();
+
+    m_current.poses++;
+    evaluate = true;
+    m_frame.emplace(key, pose);
+    return pose;
+}
+
+void AnimationPoseCache::endFrame()
+{
+    for (auto& kv : m_frame)
+        m_pool.push_back(std::move(kv.second));
+    m_frame.clear();
+
+    // a pooled pose is free once instances stopped pointing at it (they keep the last pose while paused)
+    for (size_t i = 0; i < m_pool.size();)
+    {
+        if (m_pool[i].use_count() == 1)
+        {
+            m_free.push_back(std::move(m_pool[i]));
+            m_pool[i] = std::move(m_pool.back());
+            m_pool.pop_back();
+        }
+        else
+            i++;
+    }
+
+    m_total.lookups += m_current.lookups;
+    m_total.hits += m_current.hits;
+    m_total.poses += m_current.poses;
+    m_last = m_current;
+    m_current = PoseCacheStats{};
+}
+
+const PoseCacheStats& AnimationPoseCache::frameStats() const
+{
+    return m_last;
+}
+
+const PoseCacheStats& AnimationPoseCache::totalStats() const
+{
+    return m_total;
+}
+
+void AnimationPoseCache::resetStats()
+{
+    m_last = PoseCacheStats{};
+    m_total = PoseCacheStats{};
+}
+
+size_t AnimationPoseCache::KeyHash::operator()(const Key& key) const
+{
+    size_t hash = std::hash<const void*>()(key.anim);
+    hash ^= std::hash<const void*>()(key.nodes) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<const void*>()(key.skeleton) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<int64_t>()(key.step) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
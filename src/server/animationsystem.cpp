@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <chrono>
+
+#include "server/animationsystem.hpp"
+#include "common/entities/animatedmodel.hpp"
+#include "common/entities/camera3d.hpp"
+
+
+AnimationSystem::AnimationSystem(ThreadPool& pool)
+    : m_pool(pool), m_batchSize(16), m_lastInstanceCount(0), m_lastEvaluateTime(0.0)
+{
+
+}
+
+AnimationSystem::~AnimationSystem()
+{
+    for (auto instance : m_pending)
+        instance->m_animationSystem = nullptr;
+}
+
+AnimationUpdateTier AnimationSystem::selectTier(Camera3D& camera, const glm::vec3& center, float radius, bool visible) const
+{
+    if (!m_lodSettings.enabled)
+        return AnimationUpdateTier::Full;
+    if (!visible || !camera.sphereInFrustum(center, radius))
+        return AnimationUpdateTier::Paused;
+
+    float size = camera.screenSize(center, radius);
+    if (size < m_lodSettings.pausedScreenSize)
+        return AnimationUpdateTier::Paused;
+    if (size < m_lodSettings.reducedScreenSize)
+        return AnimationUpdateTier::Reduced;
+    return AnimationUpdateTier::Full;
+}
+
+void AnimationSystem::submit(AnimatedModelComponent* instance, AnimationUpdateTier tier)
+{
+    if (instance->m_animationSystem == this)
+        return;
+
+    // the instance's own fields are only touched by the thread updating it
+    instance->m_updateTier = tier;
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    switch (tier)
+    {
+    case AnimationUpdateTier::Full:
+        m_lodStats.full++;
+        break;
+    case AnimationUpdateTier::Reduced:
+        m_lodStats.reduced++;
+        break;
+    case AnimationUpdateTier::Paused:
+        m_lodStats.paused++;
+        return;
+    }
+    instance->m_animationSystem = this;
+    m_pending.push_back(instance);
+}
+
+void AnimationSystem::cancel(AnimatedModelComponent* instance)
+{
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    auto it = std::find(m_pending.begin(), m_pending.end(), instance);
+    if (it != m_pending.end())
+    {
+        // order does not matter, evaluation is independent per instance
+        *it = m_pending.back();
+        m_pending.pop_back();
+    }
+    instance->m_animationSystem = nullptr;
+}
+
+void AnimationSystem::evaluate()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    auto release = [this] {
+        for (auto instance : m_pending)
+            instance->m_animationSystem = nullptr;
+        m_lastInstanceCount = m_pending.size();
+        m_pending.clear();
+        m_poseCache.endFrame();
+        m_lastLODStats = m_lodStats;
+        m_lodStats = AnimationLODStats{};
+    };
+
+    // instances sharing a cached pose need only one evaluation
+    m_jobs.clear();
+    for (auto instance : m_pending)
+    {
+        if (instance->m_currentAnimation == nullptr)
+            continue;
+        if (instance->m_updateTier == AnimationUpdateTier::Reduced || instance->blending())
+        {
+            // interpolated or blended per instance, shared poses only cover one clip at the full rate
+            instance->m_sharedPose = nullptr;
+            m_jobs.push_back(PoseJob{instance, &instance->m_pose, instance->m_poseTime, true});
+        }
+        else if (m_poseCache.enabled())
+        {
+            double time;
+            bool evaluate;
+            instance->m_sharedPose = m_poseCache.acquire(instance->m_currentAnimation.get(), instance->nodeTree(), instance->skeleton(),
+                                                         instance->m_poseTime, time, evaluate);
+            if (evaluate)
+                m_jobs.push_back(PoseJob{instance, instance->m_sharedPose.get(), time, false});
+        }
+        else
+        {
+            instance->m_sharedPose = nullptr;
+            m_jobs.push_back(PoseJob{instance, &instance->m_pose, instance->m_poseTime, false});
+        }
+    }
+
+    // every job writes only its own pose, the animations and skeletons are shared read-only
+    try
+    {
+        m_pool.parallelFor(m_jobs.size(), m_batchSize, [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto instance = m_jobs[i].instance;
+                if (m_jobs[i].custom)
+                    instance->evaluateOwnPose();
+                else
+                    m_jobs[i].pose->evaluate(*instance->m_currentAnimation, instance->nodeTree(), instance->skeleton(), m_jobs[i].time, instance->m_cursors.data());
+            }
+        });
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+    release();
+    m_lastEvaluateTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void AnimationSystem::setBatchSize(size_t size)
+{
+    m_batchSize = std::max<size_t>(size, 1);
+}
+
+size_t AnimationSystem::batchSize() const
+{
+    return m_batchSize;
+}
+
+size_t AnimationSystem::lastInstanceCount() const
+{
+    return m_lastInstanceCount;
+}
+
+void AnimationSystem::setLODSettings(const AnimationLODSettings& settings)
+{
+    m_lodSettings = settings;
+    m_lodSettings.reducedInterval = std::max<uint32_t>(settings.reducedInterval, 1);
+}
+
+const AnimationLODSettings& AnimationSystem::lodSettings() const
+{
+    return m_lodSettings;
+}
+
+const AnimationLODStats& AnimationSystem::lastLODStats() const
+{
+    return m_lastLODStats;
+}
+
+AnimationPoseCache& AnimationSystem::poseCache()
+{
+    return m_poseCache;
+}
+
+double AnimationSystem::lastEvaluateTime() const
+{
+    return m_lastEvaluateTime;
+}
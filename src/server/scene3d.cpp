@@ -2,11 +2,20 @@
 
 #include "server/scene3d.hpp"
 #include "common/entities/entity.hpp"
+#include "common/entities/staticmesh.hpp"
+#include "common/entities/animatedmodel.hpp"
 
 
-Scene3D::Scene3D()
-{
+// components per chunk of the parallel pools
+static constexpr size_t COMPONENT_UPDATE_GRAIN = 64;
 
+Scene3D::Scene3D(ThreadPool& pool)
+    : m_pool(pool), m_animations(pool), m_transforms(pool), m_unregisteredPools(0), m_frustumCulling(true),
+      m_freeObjects(EntityHandle::NO_INDEX), m_objectCount(0), m_deferChanges(false)
+{
+    // meshes only read their entity's transform and submit poses to the animation system
+    registerComponentType<StaticMesh>(ComponentUpdate::Parallel);
+    registerComponentType<AnimatedModelComponent>(ComponentUpdate::Parallel);
 }
 
 Scene3D::~Scene3D()
@@ -17,19 +26,65 @@ Scene3D::~Scene3D()
 void Scene3D::draw(Renderer *rend)
 {
     rend->updateCameraData(m_camera);
-    //
-    for(auto &kv : m_objects)
+
+    DrawCulling culling;
+    culling.enabled = m_frustumCulling;
+    if(m_frustumCulling)
     {
-        kv.second->draw(rend);
+        glm::vec4 planes[6];
+        m_camera.frustumPlanes(planes);
+        for(int i = 0; i < 6; i++)
+        {
+            for(int k = 0; k < 4; k++)
+                culling.planes[i * 4 + k] = planes[i][k];
+        }
     }
+
+    for(auto &pool : m_pools)
+        pool->draw(rend, culling);
+    m_cullingStats = culling.stats;
 }
 
 void Scene3D::update(double dt)
 {
-    for(auto &kv : m_objects)
+    // scripts and components may spawn or destroy entities from here on, that waits for the end of the update
+    m_deferChanges = true;
+
+    // components that may move entities (physics, network) first
+    for(size_t i = 0; i < m_pools.size(); i++)
+    {
+        if(m_poolUpdates[i] == ComponentUpdate::Serial)
+            m_pools[i]->update(dt);
+    }
+
+    // transforms changed since the last frame, the parallel components only read them
+    m_transforms.update();
+    // the camera matrices are brought up to date here, so LOD and tier selection on the workers only read them
+    m_camera.getProjectionMatrix();
+    m_camera.getViewMatrix();
+    for(size_t i = 0; i < m_pools.size(); i++)
+    {
+        if(m_poolUpdates[i] == ComponentUpdate::Parallel)
+            m_pools[i]->update(dt, m_pool, COMPONENT_UPDATE_GRAIN);
+    }
+
+    // meshes took their matrices above
+    refreshBounds();
+    // update events of the entities (scripts) see this frame's component state, on this thread
+    // by index, spawns may still reserve slots at the end of the table
+    for(size_t i = 0; i < m_objects.size(); i++)
     {
-        kv.second->update(dt);
+        if(!m_objects[i].pending && m_objects[i].entity != nullptr)
+            m_objects[i].entity->update(dt);
     }
+    // poses of the animated models advanced above
+    m_animations.evaluate();
+    // events of this frame, the handlers may still spawn and destroy
+    m_events.dispatch();
+
+    // the sync point of the frame
+    m_deferChanges = false;
+    applyChanges();
 }
 
 void Scene3D::terminate()
@@ -37,37 +92,254 @@ void Scene3D::terminate()
     clear();
 }
 
-void Scene3D::addObject(std::shared_ptr<Entity> other)
+EntityHandle Scene3D::addObject(std::shared_ptr<Entity> other)
 {
-    if(m_objects.find(other->getID()) == m_objects.end())
-        m_objects[other->getID()] = other;
+    // an entity belongs to one scene at a time, also while its spawn is pending
+    EntityHandle handle = other->getHandle();
+    if(handle.valid())
+        return owns(handle, other.get()) ? handle : EntityHandle{};
+    if(other->hasID() && m_persistentIds.find(other->getID()) != m_persistentIds.end())
+        return EntityHandle{};
+
+    uint32_t index = m_freeObjects;
+    if(index != EntityHandle::NO_INDEX)
+        m_freeObjects = m_objects[index].nextFree;
+    else
+    {
+        index = static_cast<uint32_t>(m_objects.size());
+        m_objects.push_back(ObjectSlot{nullptr, 0, EntityHandle::NO_INDEX, false});
+    }
+    // the slot is taken now, so the handle can already be stored or passed to removeObject
+    m_objects[index].entity = other;
+    m_objects[index].pending = true;
+    other->m_handle = EntityHandle{index, m_objects[index].generation};
+    if(other->hasID())
+        m_persistentIds[other->getID()] = index;
+
+    m_spawns.push_back(index);
+    if(!m_deferChanges)
+        applyChanges();
+    return other->m_handle;
 }
 
 void Scene3D::removeObject(std::shared_ptr<Entity> other)
 {
-    for (auto it = m_objects.begin(); it != m_objects.end(); ++it)
+    if(other != nullptr)
+        removeObject(other->getHandle());
+}
+
+void Scene3D::removeObject(const EntityHandle &handle)
+{
+    if(!owns(handle, nullptr))
+        return;
+
+    m_despawns.push_back(handle);
+    if(!m_deferChanges)
+        applyChanges();
+}
+
+bool Scene3D::owns(const EntityHandle &handle, const Entity *entity) const
+{
+    if(handle.index >= m_objects.size())
+        return false;
+    const ObjectSlot &object = m_objects[handle.index];
+    return object.generation == handle.generation && object.entity != nullptr && (entity == nullptr || object.entity.get() == entity);
+}
+
+void Scene3D::applyChanges()
+{
+    // destroy events may spawn or destroy more, those are applied in the next round
+    bool deferChanges = m_deferChanges;
+    m_deferChanges = true;
+    std::vector<uint32_t> spawns;
+    std::vector<EntityHandle> despawns;
+    while(!m_spawns.empty() || !m_despawns.empty())
     {
-        if(it->second->getID() == other->getID())
+        spawns.swap(m_spawns);
+        despawns.swap(m_despawns);
+
+        // spawns first, a despawn queued right after the spawn finds the entity in the scene
+        // every spawn adds at most one transform slot, so the tables grow once for the whole batch
+        m_transforms.reserve(spawns.size());
+        m_slotProxies.resize(std::max(m_slotProxies.size(), m_transforms.slotCount() + spawns.size()), SpatialIndex::NO_PROXY);
+        m_boundsDirty.reserve(m_boundsDirty.size() + spawns.size());
+        for(uint32_t index : spawns)
+            spawnObject(index);
+        for(const EntityHandle &handle : despawns)
         {
-            // mark removed
-            it->second->destroy();
-            // remove from updates
-            m_objects.erase(it);
-            break;
+            if(owns(handle, nullptr))
+                despawnObject(handle.index);
         }
+        spawns.clear();
+        despawns.clear();
     }
+    m_deferChanges = deferChanges;
+}
+
+void Scene3D::spawnObject(uint32_t index)
+{
+    ObjectSlot &object = m_objects[index];
+    if(!object.pending)
+        return;
+    object.pending = false;
+    m_objectCount++;
+    Entity *entity = object.entity.get();
+    entity->setScene(this);
+
+    // applyChanges made room for the slot
+    uint32_t slot = entity->getTransformSlot();
+    // the mesh matrices are only known after the next update, the position has to do until then
+    glm::vec3 position = entity->getWorldPosition();
+    m_slotProxies[slot] = m_spatial.insert(SpatialBounds{position, position}, entity);
+    m_boundsDirty.push_back(slot);
+}
+
+void Scene3D::despawnObject(uint32_t index)
+{
+    // released first, so handles stop resolving before the destroy events run
+    // the entity keeps its handle until it left, the queries find their rows by it
+    std::shared_ptr<Entity> entity = std::move(m_objects[index].entity);
+    bool pending = m_objects[index].pending;
+    ObjectSlot &object = m_objects[index];
+    object.generation++;
+    object.pending = false;
+    object.nextFree = m_freeObjects;
+    m_freeObjects = index;
+    if(entity->hasID())
+        m_persistentIds.erase(entity->getID());
+    if(pending)
+    {
+        entity->m_handle = EntityHandle{};
+        return;
+    }
+    m_objectCount--;
+
+    // mark removed
+    entity->destroy();
+    uint32_t slot = entity->getTransformSlot();
+    m_spatial.remove(m_slotProxies[slot]);
+    m_slotProxies[slot] = SpatialIndex::NO_PROXY;
+    entity->setScene(nullptr);
+    entity->m_handle = EntityHandle{};
+}
+
+std::weak_ptr<Entity> Scene3D::getObject(const EntityHandle &handle) const
+{
+    if(!owns(handle, nullptr) || m_objects[handle.index].pending)
+        return std::weak_ptr<Entity>();
+    return m_objects[handle.index].entity;
 }
 
 std::weak_ptr<Entity> Scene3D::getObject(const uuids::uuid &id) const
 {
-    if(m_objects.find(id) != m_objects.end())
-        return m_objects.at(id);
-    return std::weak_ptr<Entity>();
+    auto it = m_persistentIds.find(id);
+    if(it == m_persistentIds.end() || m_objects[it->second].pending)
+        return std::weak_ptr<Entity>();
+    return m_objects[it->second].entity;
+}
+
+std::vector<SceneRayHit> Scene3D::raycast(const std::vector<RaySegment>& rays) const
+{
+    std::vector<SceneRayHit> result(rays.size(), SceneRayHit{nullptr, 0, 0, glm::vec3(0.f), 0.f});
+    std::vector<SpatialRayHit> candidates;
+    std::vector<RaySegment> ray(1);
+    std::vector<ModelRayHit> hit(1);
+    for(size_t i = 0; i < rays.size(); i++)
+    {
+        result[i].t = rays[i].maxT;
+        ray[0] = rays[i];
+        hit[0].t = rays[i].maxT;
+
+        // only entities whose bounds the ray enters, nearest first
+        candidates.clear();
+        m_spatial.queryRay(rays[i], candidates);
+        for(const auto &candidate : candidates)
+        {
+            // the rest of the candidates start behind the closest triangle hit
+            if(candidate.t > hit[0].t)
+                break;
+            if(candidate.entity->raycast(ray, hit) == 0 || hit[0].t >= result[i].t)
+                continue;
+            result[i] = SceneRayHit{m_objects[candidate.entity->getHandle().index].entity, hit[0].meshId, hit[0].triangle, hit[0].point, hit[0].t};
+        }
+    }
+    return result;
+}
+
+SceneRayHit Scene3D::raycast(const glm::vec3 &from, const glm::vec3 &to) const
+{
+    return raycast(std::vector<RaySegment>{RaySegment::fromPoints(from, to)}).front();
+}
+
+std::vector<std::shared_ptr<Entity>> Scene3D::queryBox(const glm::vec3 &min, const glm::vec3 &max) const
+{
+    std::vector<Entity*> entities;
+    m_spatial.queryBox(SpatialBounds{min, max}, entities);
+    return toObjects(entities);
+}
+
+std::vector<std::shared_ptr<Entity>> Scene3D::querySphere(const glm::vec3 &center, float radius) const
+{
+    std::vector<Entity*> entities;
+    m_spatial.querySphere(center, radius, entities);
+    return toObjects(entities);
+}
+
+std::vector<std::shared_ptr<Entity>> Scene3D::queryFrustum(Camera3D &camera) const
+{
+    std::vector<Entity*> entities;
+    m_spatial.queryFrustum(camera.getProjectionMatrix() * camera.getViewMatrix(), entities);
+    return toObjects(entities);
+}
+
+std::vector<std::shared_ptr<Entity>> Scene3D::queryRay(const glm::vec3 &from, const glm::vec3 &to) const
+{
+    std::vector<SpatialRayHit> hits;
+    m_spatial.queryRay(RaySegment::fromPoints(from, to), hits);
+    std::vector<Entity*> entities(hits.size());
+    for(size_t i = 0; i < hits.size(); i++)
+        entities[i] = hits[i].entity;
+    return toObjects(entities);
+}
+
+std::vector<std::shared_ptr<Entity>> Scene3D::toObjects(const std::vector<Entity*> &entities) const
+{
+    std::vector<std::shared_ptr<Entity>> objects;
+    objects.reserve(entities.size());
+    for(auto entity : entities)
+        objects.push_back(m_objects[entity->getHandle().index].entity);
+    return objects;
 }
 
 void Scene3D::clear()
 {
-    m_objects.clear();
+    // the slots stay, with new generations, so handles from before don't resolve to later entities
+    m_freeObjects = EntityHandle::NO_INDEX;
+    for(size_t i = m_objects.size(); i-- > 0;)
+    {
+        ObjectSlot &object = m_objects[i];
+        if(object.entity != nullptr)
+        {
+            object.entity->setScene(nullptr);
+            object.entity->m_handle = EntityHandle{};
+            object.entity = nullptr;
+            object.pending = false;
+            object.generation++;
+        }
+        object.nextFree = m_freeObjects;
+        m_freeObjects = static_cast<uint32_t>(i);
+    }
+    m_objectCount = 0;
+    m_persistentIds.clear();
+    m_spawns.clear();
+    m_despawns.clear();
+    for(auto &pool : m_pools)
+        pool->clear();
+    for(auto &kv : m_queries)
+        kv.second->clear();
+    m_spatial.clear();
+    m_slotProxies.clear();
+    m_boundsDirty.clear();
 }
 
 void Scene3D::setCamera(const Camera3D &cam)
@@ -97,5 +369,123 @@ void Scene3D::setLightCount(uint32_t count)
 
 size_t Scene3D::getObjectCount() const
 {
-    return m_objects.size();
+    return m_objectCount;
+}
+
+void Scene3D::setFrustumCulling(bool enabled)
+{
+    m_frustumCulling = enabled;
+}
+
+bool Scene3D::frustumCulling() const
+{
+    return m_frustumCulling;
+}
+
+const CullingStats &Scene3D::lastCullingStats() const
+{
+    return m_cullingStats;
+}
+
+clean::EventBus &Scene3D::events()
+{
+    return m_events;
+}
+
+AnimationSystem &Scene3D::animations()
+{
+    return m_animations;
+}
+
+TransformSystem &Scene3D::transforms()
+{
+    return m_transforms;
+}
+
+SpatialIndex &Scene3D::spatialIndex()
+{
+    return m_spatial;
+}
+
+void Scene3D::invalidateBounds(Entity *entity)
+{
+    if(entity != nullptr && entity->getTransformSlot() != TransformSystem::NO_SLOT)
+        m_boundsDirty.push_back(entity->getTransformSlot());
+}
+
+void Scene3D::refreshBounds()
+{
+    // both lists may hold slots removed since, or taken by another entity, which only costs a refresh
+    auto refresh = [this](uint32_t slot) {
+        if(slot >= m_slotProxies.size() || m_slotProxies[slot] == SpatialIndex::NO_PROXY)
+            return;
+        SpatialBounds bounds;
+        m_spatial.entity(m_slotProxies[slot])->getWorldBounds(bounds.min, bounds.max);
+        m_spatial.move(m_slotProxies[slot], bounds);
+    };
+    for(uint32_t slot : m_transforms.lastMoved())
+        refresh(slot);
+    for(uint32_t slot : m_boundsDirty)
+        refresh(slot);
+    m_boundsDirty.clear();
+}
+
+size_t Scene3D::getComponentCount() const
+{
+    size_t count = 0;
+    for(const auto &pool : m_pools)
+        count += pool->size();
+    return count;
+}
+
+void Scene3D::addComponent(Component *comp)
+{
+    auto it = m_poolIndex.find(std::type_index(typeid(*comp)));
+    if(it == m_poolIndex.end())
+    {
+        auto pool = m_pools.insert(m_pools.begin() + m_unregisteredPools, std::make_unique<ComponentPool<Component>>());
+        m_poolUpdates.insert(m_poolUpdates.begin() + m_unregisteredPools, ComponentUpdate::Serial);
+        m_unregisteredPools++;
+        it = m_poolIndex.emplace(std::type_index(typeid(*comp)), pool->get()).first;
+    }
+    it->second->insert(comp);
+    invalidateBounds(comp->getParentEntity());
+    for(auto &kv : m_queries)
+    {
+        if(kv.second->involves(comp))
+            kv.second->refresh(comp->getParentEntity());
+    }
+}
+
+void Scene3D::removeComponent(Component *comp)
+{
+    auto it = m_poolIndex.find(std::type_index(typeid(*comp)));
+    if(it != m_poolIndex.end())
+        it->second->erase(comp);
+    invalidateBounds(comp->getParentEntity());
+    for(auto &kv : m_queries)
+    {
+        if(kv.second->involves(comp))
+            kv.second->refresh(comp->getParentEntity());
+    }
+}
+
+const SceneQuery &Scene3D::query(const std::vector<ComponentFilter> &filters)
+{
+    std::vector<std::type_index> key;
+    key.reserve(filters.size());
+    for(const auto &filter : filters)
+        key.push_back(filter.type);
+
+    auto &cached = m_queries[key];
+    if(cached == nullptr)
+    {
+        cached = std::make_unique<SceneQuery>(filters);
+        for(const auto &object : m_objects)
+        {
+            if(object.entity != nullptr && !object.pending)
+                cached->refresh(object.entity.get());
+        }
+    }
+    return *cached;
 }
@@ -0,0 +1,103 @@
+#include <algorithm>
+
+#include "server/scenequery.hpp"
+
+
+SceneQuery::SceneQuery(std::vector<ComponentFilter> filters)
+    : m_filters(std::move(filters)), m_found(m_filters.size(), nullptr)
+{
+}
+
+size_t SceneQuery::size() const
+{
+    return m_entities.size();
+}
+
+size_t SceneQuery::filterCount() const
+{
+    return m_filters.size();
+}
+
+const std::vector<ComponentFilter> &SceneQuery::filters() const
+{
+    return m_filters;
+}
+
+const std::vector<Entity*> &SceneQuery::entities() const
+{
+    return m_entities;
+}
+
+const std::vector<Component*> &SceneQuery::components() const
+{
+    return m_components;
+}
+
+Component *SceneQuery::component(size_t row, size_t filter) const
+{
+    return m_components[row * m_filters.size() + filter];
+}
+
+bool SceneQuery::involves(const Component *comp) const
+{
+    return std::any_of(m_filters.begin(), m_filters.end(), [comp](const ComponentFilter &filter) { return filter.matches(comp); });
+}
+
+void SceneQuery::refresh(Entity *entity)
+{
+    uint32_t index = entity->getHandle().index;
+    if(index == EntityHandle::NO_INDEX)
+        return;
+
+    std::fill(m_found.begin(), m_found.end(), nullptr);
+    size_t found = 0;
+    for(const auto &comp : entity->getComponents())
+    {
+        // attached, but not (or no longer) part of the scene
+        if(!comp->isPooled())
+            continue;
+        for(size_t i = 0; i < m_filters.size(); i++)
+        {
+            if(m_found[i] == nullptr && m_filters[i].matches(comp.get()))
+            {
+                m_found[i] = comp.get();
+                found++;
+            }
+        }
+    }
+
+    if(index >= m_rowOf.size())
+        m_rowOf.resize(index + 1, NO_ROW);
+    uint32_t row = m_rowOf[index];
+    size_t stride = m_filters.size();
+    if(found == stride)
+    {
+        if(row == NO_ROW)
+        {
+            m_rowOf[index] = static_cast<uint32_t>(m_entities.size());
+            m_entities.push_back(entity);
+            m_components.insert(m_components.end(), m_found.begin(), m_found.end());
+        }
+        else
+            std::copy(m_found.begin(), m_found.end(), m_components.begin() + row * stride);
+        return;
+    }
+    if(row == NO_ROW)
+        return;
+
+    // the last row takes the place of the removed one
+    size_t last = m_entities.size() - 1;
+    m_entities[row] = m_entities[last];
+    std::copy(m_components.begin() + last * stride, m_components.end(), m_components.begin() + row * stride);
+    m_rowOf[m_entities[row]->getHandle().index] = row;
+    m_rowOf[index] = NO_ROW;
+    m_entities.pop_back();
+    m_components.resize(last * stride);
+}
+
+void SceneQuery::clear()
+{
+    m_entities.clear();
+    m_components.clear();
+    m_rowOf.clear();
+}
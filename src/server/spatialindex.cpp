@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "server/spatialindex.hpp"
+#include "common/simd.hpp"
+
+// the rotations keep the height below 1.44 * log2(nodes), which fits any 32 bit node count
+static constexpr uint32_t SPATIAL_STACK_SIZE = 64;
+
+SpatialBounds SpatialBounds::fromSphere(const glm::vec3& center, float radius)
+{
+    return SpatialBounds{center - glm::vec3(radius), center + glm::vec3(radius)};
+}
+
+SpatialBounds SpatialBounds::merged(const SpatialBounds& other) const
+{
+    return SpatialBounds{glm::min(min, other.min), glm::max(max, other.max)};
+}
+
+bool SpatialBounds::contains(const SpatialBounds& other) const
+{
+    return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+           max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+}
+
+bool SpatialBounds::overlaps(const SpatialBounds& other) const
+{
+    return min.x <= other.max.x && min.y <= other.max.y && min.z <= other.max.z &&
+           max.x >= other.min.x && max.y >= other.min.y && max.z >= other.min.z;
+}
+
+float SpatialBounds::area() const
+{
+    glm::vec3 e = max - min;
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+static bool sphereOverlaps(const SpatialBounds& bounds, const glm::vec3& center, float radius)
+{
+    glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+    glm::vec3 d = closest - center;
+    return glm::dot(d, d) <= radius * radius;
+}
+
+// entry t of the segment, negative when it misses
+static float rayEntry(const SpatialBounds& bounds, const RaySegment& ray, const glm::vec3& invDir)
+{
+    glm::vec3 t0 = (bounds.min - ray.origin) * invDir;
+    glm::vec3 t1 = (bounds.max - ray.origin) * invDir;
+    glm::vec3 tmin = glm::min(t0, t1);
+    glm::vec3 tmax = glm::max(t0, t1);
+    float enter = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.f));
+    float exit = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, ray.maxT));
+    return enter <= exit ? enter : -1.f;
+}
+
+struct SpatialFrustum
+{
+    glm::vec4 planes[6];
+
+    explicit SpatialFrustum(const glm::mat4& viewProj)
+    {
+        clean::simd::frustumPlanes(glm::value_ptr(viewProj), &planes[0].x);
+    }
+
+    bool overlaps(const SpatialBounds& bounds) const
+    {
+        // the corner furthest along each plane normal decides
+        for (const auto& plane : planes)
+        {
+            glm::vec3 corner(plane.x >= 0.f ? bounds.max.x : bounds.min.x,
+                             plane.y >= 0.f ? bounds.max.y : bounds.min.y,
+                             plane.z >= 0.f ? bounds.max.z : bounds.min.z);
+            if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.f)
+                return false;
+        }
+        return true;
+    }
+};
+
+SpatialIndex::SpatialIndex(float margin)
+    : m_margin(margin), m_root(NO_PROXY), m_freeNodes(NO_PROXY), m_freeProxies(NO_PROXY), m_proxyCount(0)
+{
+
+}
+
+uint32_t SpatialIndex::insert(const SpatialBounds& bounds, Entity* entity)
+{
+    uint32_t proxy;
+    if (m_freeProxies != NO_PROXY)
+    {
+        proxy = m_freeProxies;
+        m_freeProxies = m_proxies[proxy].node;
+    }
+    else
+    {
+        proxy = static_cast<uint32_t>(m_proxies.size());
+        m_proxies.emplace_back();
+    }
+
+    uint32_t leaf = allocateNode();
+    m_nodes[leaf].bounds = SpatialBounds{bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin)};
+    m_nodes[leaf].right = proxy;
+    m_proxies[proxy] = Proxy{bounds, leaf, entity};
+    insertLeaf(leaf);
+    m_proxyCount++;
+    return proxy;
+}
+
+void SpatialIndex::remove(uint32_t proxy)
+{
+    uint32_t leaf = m_proxies[proxy].node;
+    removeLeaf(leaf);
+    freeNode(leaf);
+
+    m_proxies[proxy].entity = nullptr;
+    m_proxies[proxy].node = m_freeProxies;
+    m_freeProxies = proxy;
+    m_proxyCount--;
+}
+
+bool SpatialIndex::move(uint32_t proxy, const SpatialBounds& bounds)
+{
+    Proxy& p = m_proxies[proxy];
+    p.bounds = bounds;
+    if (m_nodes[p.node].bounds.contains(bounds))
+        return false;
+
+    removeLeaf(p.node);
+    m_nodes[p.node].bounds = SpatialBounds{bounds.min - glm::vec3(m_margin), bounds.max + glm::vec3(m_margin)};
+    insertLeaf(p.node);
+    return true;
+}
+
+void SpatialIndex::clear()
+{
+    m_nodes.clear();
+    m_proxies.clear();
+    m_root = NO_PROXY;
+    m_freeNodes = NO_PROXY;
+    m_freeProxies = NO_PROXY;
+    m_proxyCount = 0;
+}
+
+Entity* SpatialIndex::entity(uint32_t proxy) const
+{
+    return m_proxies[proxy].entity;
+}
+
+const SpatialBounds& SpatialIndex::bounds(uint32_t proxy) const
+{
+    return m_proxies[proxy].bounds;
+}
+
+template<typename NodeTest, typename ProxyVisitor>
+void SpatialIndex::traverse(NodeTest&& test, ProxyVisitor&& visit) const
+{
+    if (m_root == NO_PROXY)
+        return;
+
+    std::array<uint32_t, SPATIAL_STACK_SIZE> stack;
+    uint32_t top = 0;
+    stack[top++] = m_root;
+    while (top > 0)
+    {
+        const Node& node = m_nodes[stack[--top]];
+        if (!test(node.bounds))
+            continue;
+
+        if (node.left == NO_PROXY)
+        {
+            const Proxy& proxy = m_proxies[node.right];
+            if (test(proxy.bounds))
+                visit(proxy);
+        }
+        else
+        {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+}
+
+void SpatialIndex::queryBox(const SpatialBounds& bounds, std::vector<Entity*>& result) const
+{
+    traverse([&bounds](const SpatialBounds& b) { return b.overlaps(bounds); },
+             [&result](const Proxy& proxy) { result.push_back(proxy.entity); });
+}
+
+void SpatialIndex::querySphere(const glm::vec3& center, float radius, std::vector<Entity*>& result) const
+{
+    traverse([&](const SpatialBounds& b) { return sphereOverlaps(b, center, radius); },
+             [&result](const Proxy& proxy) { result.push_back(proxy.entity); });
+}
+
+void SpatialIndex::queryFrustum(const glm::mat4& viewProj, std::vector<Entity*>& result) const
+{
+    SpatialFrustum frustum(viewProj);
+    traverse([&frustum](const SpatialBounds& b) { return frustum.overlaps(b); },
+             [&result](const Proxy& proxy) { result.push_back(proxy.entity); });
+}
+
+void SpatialIndex::queryRay(const RaySegment& ray, std::vector<SpatialRayHit>& result) const
+{
+    // infinite components for axis parallel directions keep the slab test valid
+    glm::vec3 invDir = 1.f / ray.direction;
+    size_t first = result.size();
+    traverse([&](const SpatialBounds& b) { return rayEntry(b, ray, invDir) >= 0.f; },
+             [&](const Proxy& proxy) { result.push_back(SpatialRayHit{proxy.entity, rayEntry(proxy.bounds, ray, invDir)}); });
+    std::sort(result.begin() + first, result.end(), [](const SpatialRayHit& a, const SpatialRayHit& b) { return a.t < b.t; });
+}
+
+size_t SpatialIndex::size() const
+{
+    return m_proxyCount;
+}
+
+size_t SpatialIndex::nodeCount() const
+{
+    return m_proxyCount == 0 ? 0 : m_proxyCount * 2 - 1;
+}
+
+uint32_t SpatialIndex::height() const
+{
+    return m_root == NO_PROXY ? 0 : static_cast<uint32_t>(m_nodes[m_root].height);
+}
+
+uint32_t SpatialIndex::allocateNode()
+{
+    uint32_t node;
+    if (m_freeNodes != NO_PROXY)
+    {
+        node = m_freeNodes;
+        m_freeNodes = m_nodes[node].parent;
+    }
+    else
+    {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+    m_nodes[node].parent = NO_PROXY;
+    m_nodes[node].left = NO_PROXY;
+    m_nodes[node].right = NO_PROXY;
+    m_nodes[node].height = 0;
+    return node;
+}
+
+void SpatialIndex::freeNode(uint32_t node)
+{
+    m_nodes[node].parent = m_freeNodes;
+    m_nodes[node].height = -1;
+    m_freeNodes = node;
+}
+
+void SpatialIndex::insertLeaf(uint32_t leaf)
+{
+    if (m_root == NO_PROXY)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NO_PROXY;
+        return;
+    }
+
+    // descend towards the cheapest sibling, by the surface area the tree would gain
+    const SpatialBounds bounds = m_nodes[leaf].bounds;
+    uint32_t index = m_root;
+    while (m_nodes[index].left != NO_PROXY)
+    {
+        const Node& node = m_nodes[index];
+        float area = node.bounds.area();
+        float combined = node.bounds.merged(bounds).area();
+
+        // a new parent here, and the growth every ancestor below would pay
+        float cost = 2.f * combined;
+        float inheritance = 2.f * (combined - area);
+
+        auto descendCost = [&](uint32_t child) {
+            const Node& c = m_nodes[child];
+            float merged = c.bounds.merged(bounds).area();
+            return (c.left == NO_PROXY ? merged : merged - c.bounds.area()) + inheritance;
+        };
+        float leftCost = descendCost(node.left);
+        float rightCost = descendCost(node.right);
+        if (cost < leftCost && cost < rightCost)
+            break;
+        index = leftCost < rightCost ? node.left : node.right;
+    }
+
+    uint32_t sibling = index;
+    uint32_t oldParent = m_nodes[sibling].parent;
+    uint32_t newParent = allocateNode();
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].bounds = m_nodes[sibling].bounds.merged(bounds);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].left = sibling;
+    m_nodes[newParent].right = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent == NO_PROXY)
+        m_root = newParent;
+    else if (m_nodes[oldParent].left == sibling)
+        m_nodes[oldParent].left = newParent;
+    else
+        m_nodes[oldParent].right = newParent;
+
+    refit(m_nodes[leaf].parent);
+}
+
+void SpatialIndex::removeLeaf(uint32_t leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NO_PROXY;
+        return;
+    }
+
+    uint32_t parent = m_nodes[leaf].parent;
+    uint32_t grandParent = m_nodes[parent].parent;
+    uint32_t sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+    freeNode(parent);
+    m_nodes[sibling].parent = grandParent;
+
+    if (grandParent == NO_PROXY)
+    {
+        m_root = sibling;
+        return;
+    }
+    if (m_nodes[grandParent].left == parent)
+        m_nodes[grandParent].left = sibling;
+    else
+        m_nodes[grandParent].right = sibling;
+    refit(grandParent);
+}
+
+void SpatialIndex::refit(uint32_t index)
+{
+    while (index != NO_PROXY)
+    {
+        index = balance(index);
+
+        Node& node = m_nodes[index];
+        const Node& left = m_nodes[node.left];
+        const Node& right = m_nodes[node.right];
+        node.height = 1 + std::max(left.height, right.height);
+        node.bounds = left.bounds.merged(right.bounds);
+        index = node.parent;
+    }
+}
+
+uint32_t SpatialIndex::balance(uint32_t a)
+{
+    Node& nodeA = m_nodes[a];
+    if (nodeA.left == NO_PROXY || nodeA.height < 2)
+        return a;
+
+    uint32_t b = nodeA.left;
+    uint32_t c = nodeA.right;
+    int32_t skew = m_nodes[c].height - m_nodes[b].height;
+    if (skew >= -1 && skew <= 1)
+        return a;
+
+    // the taller child takes the place of a, a keeps the other child and the shorter grandchild
+    uint32_t up = skew > 1 ? c : b;
+    uint32_t kept = skew > 1 ? b : c;
+    Node& nodeUp = m_nodes[up];
+    uint32_t f = nodeUp.left;
+    uint32_t g = nodeUp.right;
+
+    nodeUp.left = a;
+    nodeUp.parent = nodeA.parent;
+    nodeA.parent = up;
+    if (nodeUp.parent == NO_PROXY)
+        m_root = up;
+    else if (m_nodes[nodeUp.parent].left == a)
+        m_nodes[nodeUp.parent].left = up;
+    else
+        m_nodes[nodeUp.parent].right = up;
+
+    uint32_t taller = m_nodes[f].height > m_nodes[g].height ? f : g;
+    uint32_t shorter = taller == f ? g : f;
+    nodeUp.right = taller;
+    if (skew > 1)
+        nodeA.right = shorter;
+    else
+        nodeA.left = shorter;
+    m_nodes[shorter].parent = a;
+
+    nodeA.bounds = m_nodes[kept].bounds.merged(m_nodes[shorter].bounds);
+    nodeA.height = 1 + std::max(m_nodes[kept].height, m_nodes[shorter].height);
+    nodeUp.bounds = nodeA.bounds.merged(m_nodes[taller].bounds);
+    nodeUp.height = 1 + std::max(nodeA.height, m_nodes[taller].height);
+    return up;
+}
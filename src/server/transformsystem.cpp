@@ -0,0 +1,335 @@
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <fmt/format.h>
+
+#include "server/transformsystem.hpp"
+#include "common/simd.hpp"
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::mat4) == 16 * sizeof(float), "transforms expect tightly packed glm types");
+static_assert(offsetof(glm::quat, x) == 0 && offsetof(glm::quat, w) == 3 * sizeof(float), "transforms expect x, y, z, w quaternions");
+
+// slots per chunk of the parallel passes
+static constexpr size_t TRANSFORM_COMPOSE_GRAIN = 1024;
+static constexpr size_t TRANSFORM_PROPAGATE_GRAIN = 256;
+
+TransformSystem::TransformSystem(ThreadPool& pool)
+    : m_pool(pool), m_recomputed(0), m_lastRecomputed(0)
+{
+
+}
+
+uint32_t TransformSystem::add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    uint32_t slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_positions[slot] = position;
+        m_rotations[slot] = rotation;
+        m_scales[slot] = scale;
+        m_flags[slot] = ALIVE;
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(m_positions.size());
+        m_positions.push_back(position);
+        m_rotations.push_back(rotation);
+        m_scales.push_back(scale);
+        m_locals.push_back(glm::mat4(1.f));
+        m_worlds.push_back(glm::mat4(1.f));
+        m_flags.push_back(ALIVE);
+        m_parents.push_back(NO_SLOT);
+        m_firstChildren.push_back(NO_SLOT);
+        m_nextSiblings.push_back(NO_SLOT);
+        m_depths.push_back(0);
+    }
+
+    m_parents[slot] = NO_SLOT;
+    m_firstChildren[slot] = NO_SLOT;
+    m_nextSiblings[slot] = NO_SLOT;
+    m_depths[slot] = 0;
+    markDirty(slot, LOCAL_DIRTY | WORLD_DIRTY);
+    return slot;
+}
+
+void TransformSystem::remove(uint32_t slot)
+{
+    if (slot >= m_flags.size() || !(m_flags[slot] & ALIVE))
+        return;
+
+    for (uint32_t child = m_firstChildren[slot]; child != NO_SLOT;)
+    {
+        uint32_t next = m_nextSiblings[child];
+        m_parents[child] = NO_SLOT;
+        m_nextSiblings[child] = NO_SLOT;
+        updateDepths(child);
+        markDirty(child, WORLD_DIRTY);
+        child = next;
+    }
+    m_firstChildren[slot] = NO_SLOT;
+    unlink(slot);
+
+    m_flags[slot] = 0;
+    m_freeSlots.push_back(slot);
+}
+
+size_t TransformSystem::size() const
+{
+    return m_positions.size() - m_freeSlots.size();
+}
+
+size_t TransformSystem::slotCount() const
+{
+    return m_positions.size();
+}
+
+void TransformSystem::reserve(size_t count)
+{
+    // free slots are reused first, so this may be more than needed
+    size_t slots = m_positions.size() + count;
+    m_positions.reserve(slots);
+    m_rotations.reserve(slots);
+    m_scales.reserve(slots);
+    m_locals.reserve(slots);
+    m_worlds.reserve(slots);
+    m_flags.reserve(slots);
+    m_parents.reserve(slots);
+    m_firstChildren.reserve(slots);
+    m_nextSiblings.reserve(slots);
+    m_depths.reserve(slots);
+}
+
+void TransformSystem::setPosition(uint32_t slot, const glm::vec3& position)
+{
+    m_positions[slot] = position;
+    markDirty(slot, LOCAL_DIRTY | WORLD_DIRTY);
+}
+
+void TransformSystem::setRotation(uint32_t slot, const glm::quat& rotation)
+{
+    m_rotations[slot] = rotation;
+    markDirty(slot, LOCAL_DIRTY | WORLD_DIRTY);
+}
+
+void TransformSystem::setScale(uint32_t slot, const glm::vec3& scale)
+{
+    m_scales[slot] = scale;
+    markDirty(slot, LOCAL_DIRTY | WORLD_DIRTY);
+}
+
+bool TransformSystem::isDirty(uint32_t slot) const
+{
+    return (m_flags[slot] & (LOCAL_DIRTY | WORLD_DIRTY)) != 0;
+}
+
+void TransformSystem::setParent(uint32_t slot, uint32_t parent)
+{
+    if (m_parents[slot] == parent)
+        return;
+    for (uint32_t ancestor = parent; ancestor != NO_SLOT; ancestor = m_parents[ancestor])
+    {
+        if (ancestor == slot)
+            throw std::runtime_error(fmt::format("Transform {} can't be parented to its own subtree", slot));
+    }
+
+    unlink(slot);
+    m_parents[slot] = parent;
+    if (parent != NO_SLOT)
+    {
+        m_nextSiblings[slot] = m_firstChildren[parent];
+        m_firstChildren[parent] = slot;
+    }
+    updateDepths(slot);
+    markDirty(slot, WORLD_DIRTY);
+}
+
+uint32_t TransformSystem::parent(uint32_t slot) const
+{
+    return m_parents[slot];
+}
+
+uint32_t TransformSystem::depth(uint32_t slot) const
+{
+    return m_depths[slot];
+}
+
+const glm::mat4& TransformSystem::world(uint32_t slot)
+{
+    // the topmost stale transform on the way to the root
+    uint32_t top = NO_SLOT;
+    for (uint32_t node = slot; node != NO_SLOT; node = m_parents[node])
+    {
+        if (m_flags[node] & (LOCAL_DIRTY | WORLD_DIRTY))
+            top = node;
+    }
+    if (top == NO_SLOT)
+        return m_worlds[slot];
+
+    // recompute only the chain from there down to slot, the WORLD_DIRTY flags stay for the rest of the subtrees
+    m_queue.clear();
+    for (uint32_t node = slot; ; node = m_parents[node])
+    {
+        m_queue.push_back(node);
+        if (node == top)
+            break;
+    }
+    for (auto it = m_queue.rbegin(); it != m_queue.rend(); ++it)
+    {
+        uint32_t node = *it;
+        if (m_flags[node] & LOCAL_DIRTY)
+        {
+            clean::simd::composeTransforms(&node, 1, &m_positions[0].x, &m_rotations[0].x, &m_scales[0].x, &m_locals[0][0][0]);
+            m_flags[node] &= ~LOCAL_DIRTY;
+        }
+        composeWorld(node);
+        markMoved(node);
+        m_recomputed++;
+    }
+    if (m_flags[slot] & WORLD_DIRTY && m_firstChildren[slot] == NO_SLOT)
+        m_flags[slot] &= ~WORLD_DIRTY;
+    return m_worlds[slot];
+}
+
+void TransformSystem::update()
+{
+    // local matrices of each dirty slot once, entries of removed or already recomposed slots are skipped
+    m_batch.clear();
+    m_roots.clear();
+    for (uint32_t slot : m_dirtySlots)
+    {
+        if (m_flags[slot] & LOCAL_DIRTY)
+        {
+            m_flags[slot] &= ~LOCAL_DIRTY;
+            m_batch.push_back(slot);
+        }
+        if (m_flags[slot] & WORLD_DIRTY)
+            m_roots.push_back(slot);
+    }
+    m_dirtySlots.clear();
+
+    // every slot is written by one chunk only
+    if (!m_batch.empty())
+    {
+        m_pool.parallelFor(m_batch.size(), TRANSFORM_COMPOSE_GRAIN, [this](size_t begin, size_t end) {
+            clean::simd::composeTransforms(m_batch.data() + begin, end - begin, &m_positions[0].x, &m_rotations[0].x, &m_scales[0].x, &m_locals[0][0][0]);
+        });
+    }
+
+    // stale slots below another stale slot are covered by its walk, the remaining roots have disjoint subtrees;
+    // breadth first inside a subtree, so parents are final before their children read them
+    std::sort(m_roots.begin(), m_roots.end());
+    m_roots.erase(std::unique(m_roots.begin(), m_roots.end()), m_roots.end());
+    m_roots.erase(std::remove_if(m_roots.begin(), m_roots.end(), [this](uint32_t root) { return hasStaleAncestor(root); }), m_roots.end());
+    m_pool.parallelFor(m_roots.size(), TRANSFORM_PROPAGATE_GRAIN, [this](size_t begin, size_t end) { propagate(begin, end); });
+
+    m_lastRecomputed = m_recomputed;
+    m_recomputed = 0;
+    m_lastMoved.swap(m_moved);
+    m_moved.clear();
+    for (uint32_t slot : m_lastMoved)
+        m_flags[slot] &= ~MOVED;
+}
+
+size_t TransformSystem::lastRecomputed() const
+{
+    return m_lastRecomputed;
+}
+
+const std::vector<uint32_t>& TransformSystem::lastMoved() const
+{
+    return m_lastMoved;
+}
+
+void TransformSystem::propagate(size_t rootBegin, size_t rootEnd)
+{
+    // per thread, the chunks of one update run on several
+    thread_local std::vector<uint32_t> queue;
+    thread_local std::vector<uint32_t> moved;
+    moved.clear();
+    size_t recomputed = 0;
+    for (size_t r = rootBegin; r < rootEnd; r++)
+    {
+        queue.clear();
+        queue.push_back(m_roots[r]);
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            uint32_t node = queue[i];
+            m_flags[node] &= ~WORLD_DIRTY;
+            composeWorld(node);
+            recomputed++;
+            if (!(m_flags[node] & MOVED))
+            {
+                m_flags[node] |= MOVED;
+                moved.push_back(node);
+            }
+            for (uint32_t child = m_firstChildren[node]; child != NO_SLOT; child = m_nextSiblings[child])
+                queue.push_back(child);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_movedMutex);
+    m_moved.insert(m_moved.end(), moved.begin(), moved.end());
+    m_recomputed += recomputed;
+}
+
+bool TransformSystem::hasStaleAncestor(uint32_t slot) const
+{
+    for (uint32_t ancestor = m_parents[slot]; ancestor != NO_SLOT; ancestor = m_parents[ancestor])
+    {
+        if (m_flags[ancestor] & WORLD_DIRTY)
+            return true;
+    }
+    return false;
+}
+
+void TransformSystem::markDirty(uint32_t slot, uint8_t flags)
+{
+    if (!(m_flags[slot] & (LOCAL_DIRTY | WORLD_DIRTY)))
+        m_dirtySlots.push_back(slot);
+    m_flags[slot] |= flags;
+}
+
+void TransformSystem::unlink(uint32_t slot)
+{
+    uint32_t parent = m_parents[slot];
+    if (parent == NO_SLOT)
+        return;
+
+    uint32_t* link = &m_firstChildren[parent];
+    while (*link != slot)
+        link = &m_nextSiblings[*link];
+    *link = m_nextSiblings[slot];
+    m_parents[slot] = NO_SLOT;
+    m_nextSiblings[slot] = NO_SLOT;
+}
+
+void TransformSystem::updateDepths(uint32_t slot)
+{
+    m_queue.clear();
+    m_queue.push_back(slot);
+    for (size_t i = 0; i < m_queue.size(); i++)
+    {
+        uint32_t node = m_queue[i];
+        uint32_t parent = m_parents[node];
+        m_depths[node] = parent == NO_SLOT ? 0 : m_depths[parent] + 1;
+        for (uint32_t child = m_firstChildren[node]; child != NO_SLOT; child = m_nextSiblings[child])
+            m_queue.push_back(child);
+    }
+}
+
+void TransformSystem::composeWorld(uint32_t slot)
+{
+    uint32_t parent = m_parents[slot];
+    m_worlds[slot] = parent == NO_SLOT ? m_locals[slot] : m_worlds[parent] * m_locals[slot];
+}
+
+void TransformSystem::markMoved(uint32_t slot)
+{
+    if (!(m_flags[slot] & MOVED))
+    {
+        m_flags[slot] |= MOVED;
+        m_moved.push_back(slot);
+    }
+}
@@ -0,0 +1,961 @@
+// cleanengine-bench: engine microbenchmarks, run one suite per invocation
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cmath>
+#include <optional>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <unordered_map>
+#include <random>
+#include <boost/signals2.hpp>
+#include <spdlog/spdlog.h>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "argparse.hpp"
+#include "common/3d/animationprimitive.hpp"
+#include "common/3d/animationpose.hpp"
+#include "common/3d/morphanimation.hpp"
+#include "common/threadpool.hpp"
+#include "common/simd.hpp"
+#include "common/objectpool.hpp"
+#include "common/delegate_list.hpp"
+#include "common/eventbus.hpp"
+#include "server/animationposecache.hpp"
+#include "server/transformsystem.hpp"
+#include "server/spatialindex.hpp"
+
+struct BenchArgs : public argparse::Args
+{
+    std::string& suite = arg("suite", "benchmark to run: anim-sampling, anim-parallel, anim-cache, anim-bake, anim-compress, anim-lod, anim-blend, morph, transforms, spatial, culling, pool, events");
+    int& count = kwarg("n,count", "number of channels/objects").set_default(64);
+    int& keys = kwarg("k,keys", "keyframes per animation channel").set_default(120);
+    int& frames = kwarg("f,frames", "simulated frames").set_default(2000);
+};
+
+// heap allocations of the whole process, to check per-frame allocation behaviour
+static std::atomic<size_t> allocationCount{0};
+
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if(void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// runs fn once per frame, returns seconds
+static double measure(int frames, const std::function<void(int)>& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < frames; frame++)
+        fn(frame);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const std::string& name, double seconds, double samples)
+{
+    spdlog::info("  {:<24} {:>10.3f} ms {:>14.0f} samples/s {:>8.1f} ns/sample", name, seconds * 1000.0, samples / seconds, seconds * 1e9 / samples);
+}
+
+// track layout before the SoA storage: a double time and optional T/R/S per key, channels in a hash map
+struct LegacyKeyFrame
+{
+    double time;
+    std::optional<glm::vec3> position;
+    std::optional<glm::quat> rotation;
+    std::optional<glm::vec3> scale;
+
+    glm::mat4 transform() const
+    {
+        glm::mat4 result(1.f);
+        if (position.has_value())
+            result = glm::translate(result, position.value());
+        if (rotation.has_value())
+            result *= glm::toMat4(rotation.value());
+        if (scale.has_value())
+            result = glm::scale(result, scale.value());
+        return result;
+    }
+};
+using LegacyAnimation = std::unordered_map<uint32_t, std::vector<LegacyKeyFrame>>;
+
+// keyframe() before binary search: linear walk, interpolation through decomposed matrices
+static glm::mat4 legacySample(const std::vector<LegacyKeyFrame>& keyframes, double timecode)
+{
+    if (keyframes.empty())
+        return glm::mat4(1.f);
+    if (timecode <= keyframes[0].time)
+        return keyframes[0].transform();
+    if (timecode >= keyframes.back().time)
+        return keyframes.back().transform();
+
+    for(size_t i = 1; i < keyframes.size(); i++)
+    {
+        const auto& kf0 = keyframes.at(i-1);
+        const auto& kf1 = keyframes.at(i);
+        if (timecode >= kf0.time && timecode < kf1.time)
+        {
+            float dt = static_cast<float>((timecode - kf0.time) / (kf1.time - kf0.time));
+            glm::vec3 pos0, pos1, scl0, scl1, t0;
+            glm::quat rot0, rot1;
+            glm::vec4 t1;
+            glm::decompose(kf0.transform(), scl0, rot0, pos0, t0, t1);
+            glm::decompose(kf1.transform(), scl1, rot1, pos1, t0, t1);
+            glm::mat4 trs = glm::translate(glm::mat4(1.f), glm::mix(pos0, pos1, dt)) *
+                            glm::toMat4(glm::slerp(rot0, rot1, dt)) *
+                            glm::scale(glm::mat4(1.f), glm::mix(scl0, scl1, dt));
+            // the old AnimationKeyFrame(trs, time) constructor decomposed the result once more
+            glm::decompose(trs, scl0, rot0, pos0, t0, t1);
+            return trs;
+        }
+    }
+    return glm::mat4(1.f);
+}
+
+static void benchAnimSampling(const BenchArgs& args)
+{
+    const double duration = 4.0;
+    AnimationPrimitive anim("bench", duration);
+    LegacyAnimation legacy;
+    for(int channel = 0; channel < args.count; channel++)
+    {
+        AnimationChannelKeys keys;
+        for(int key = 0; key < args.keys; key++)
+        {
+            double time = duration * key / (args.keys - 1);
+            glm::vec3 position(channel, key * 0.1f, 0.f);
+            glm::quat rotation = glm::angleAxis(static_cast<float>(time), glm::normalize(glm::vec3(1.f, channel, 2.f)));
+            glm::vec3 scale(1.f + key * 0.01f);
+
+            legacy[channel].push_back(LegacyKeyFrame{time, position, rotation, scale});
+            keys.positionTimes.push_back(static_cast<float>(time));
+            keys.positions.push_back(position);
+            keys.rotationTimes.push_back(static_cast<float>(time));
+            keys.rotations.push_back(rotation);
+            keys.scaleTimes.push_back(static_cast<float>(time));
+            keys.scales.push_back(scale);
+        }
+        anim.addChannel(keys, channel);
+    }
+
+    size_t legacyBytes = 0;
+    for(const auto& [channel, keyframes] : legacy)
+        legacyBytes += sizeof(channel) + sizeof(keyframes) + keyframes.size() * sizeof(LegacyKeyFrame);
+    legacyBytes += args.count * (sizeof(uint32_t) + sizeof(std::vector<uint32_t>) + sizeof(uint32_t)); // old channel -> mesh map
+
+    const double dt = 1.0 / 60.0;
+    const double samples = static_cast<double>(args.count) * args.frames;
+    spdlog::info("anim-sampling: {} channel(s), {} key(s), {} frame(s)", args.count, args.keys, args.frames);
+    spdlog::info("  track memory: {} bytes keyframe map, {} bytes SoA", legacyBytes, anim.memoryUsage());
+
+    glm::mat4 sink(0.f); // keeps the optimizer from dropping the samples
+    report("linear + decompose", measure(args.frames, [&](int frame) {
+        double time = std::fmod(frame * dt, duration);
+        for(int channel = 0; channel < args.count; channel++)
+            sink += legacySample(legacy[channel], time);
+    }), samples);
+
+    report("binary search", measure(args.frames, [&](int frame) {
+        double time = std::fmod(frame * dt, duration);
+        for(int channel = 0; channel < args.count; channel++)
+            sink += anim.sample(channel, time).matrix();
+    }), samples);
+
+    std::vector<AnimationCursor> cursors(args.count);
+    report("cursor", measure(args.frames, [&](int frame) {
+        double time = std::fmod(frame * dt, duration);
+        for(int channel = 0; channel < args.count; channel++)
+            sink += anim.sample(channel, time, &cursors[channel]).matrix();
+    }), samples);
+    spdlog::debug("checksum {}", sink[0][0]);
+}
+
+// pose state of one AnimatedModelComponent
+struct BenchInstance
+{
+    double time;
+    std::vector<AnimationCursor> cursors;
+    AnimationPose pose;
+};
+
+// binary node tree, node i drives mesh slot i and channel i of the bench animations
+static ModelNodeTree makeBenchNodes(int count)
+{
+    ModelNodeTree nodes;
+    for(int node = 0; node < count; node++)
+    {
+        int32_t parent = node > 0 ? (node - 1) / 2 : -1;
+        nodes.addNode(fmt::format("node{}", node), parent, glm::translate(glm::mat4(1.f), glm::vec3(0.f, 1.f, 0.f)));
+        nodes.attachMesh(static_cast<uint32_t>(node), node);
+    }
+    return nodes;
+}
+
+static AnimationPrimitive makeBenchAnimation(int channels, int keys, double duration)
+{
+    AnimationPrimitive anim("bench", duration);
+    for(int channel = 0; channel < channels; channel++)
+    {
+        AnimationChannelKeys channelKeys;
+        for(int key = 0; key < keys; key++)
+        {
+            float time = static_cast<float>(duration * key / (keys - 1));
+            channelKeys.positionTimes.push_back(time);
+            channelKeys.positions.push_back(glm::vec3(channel, key * 0.1f, 0.f));
+            channelKeys.rotationTimes.push_back(time);
+            channelKeys.rotations.push_back(glm::angleAxis(time, glm::normalize(glm::vec3(1.f, channel, 2.f))));
+        }
+        anim.addChannel(channelKeys, channel);
+    }
+    return anim;
+}
+
+static void benchAnimParallel(const BenchArgs& args)
+{
+    const double duration = 4.0;
+    const int channels = 32;
+    AnimationPrimitive anim = makeBenchAnimation(channels, args.keys, duration);
+    ModelNodeTree nodes = makeBenchNodes(channels);
+
+    // instances start at different times like units spawned over several frames
+    std::vector<BenchInstance> instances(args.count);
+    for(int i = 0; i < args.count; i++)
+        instances[i] = BenchInstance{std::fmod(i * 0.37, duration), std::vector<AnimationCursor>(channels), AnimationPose{}};
+
+    const double dt = 1.0 / 60.0;
+    auto advance = [&]() {
+        for(auto& instance : instances)
+            instance.time = std::fmod(instance.time + dt, duration);
+    };
+
+    ThreadPool& pool = ThreadPool::global();
+    const double samples = static_cast<double>(args.count) * channels * args.frames;
+    spdlog::info("anim-parallel: {} instance(s), {} channel(s), {} key(s), {} frame(s), {} thread(s)", args.count, channels, args.keys, args.frames, pool.threadCount());
+
+    report("serial", measure(args.frames, [&](int) {
+        advance();
+        for(auto& instance : instances)
+            instance.pose.evaluate(anim, &nodes, nullptr, instance.time, instance.cursors.data());
+    }), samples);
+
+    for(size_t batch : {1, 16, 64})
+    {
+        report(fmt::format("parallel, batch {}", batch), measure(args.frames, [&](int) {
+            advance();
+            pool.parallelFor(instances.size(), batch, [&](size_t begin, size_t end) {
+                for(size_t i = begin; i < end; i++)
+                    instances[i].pose.evaluate(anim, &nodes, nullptr, instances[i].time, instances[i].cursors.data());
+            });
+        }), samples);
+    }
+}
+
+static void benchAnimCache(const BenchArgs& args)
+{
+    const double duration = 4.0;
+    const int channels = 32;
+    const int groups = 8; // e.g. idle loops started together
+    AnimationPrimitive anim = makeBenchAnimation(channels, args.keys, duration);
+    ModelNodeTree nodes = makeBenchNodes(channels);
+
+    // instances of a group are a few milliseconds apart
+    std::vector<BenchInstance> instances(args.count);
+    for(int i = 0; i < args.count; i++)
+    {
+        double offset = (i % groups) * duration / groups + (i / groups % 5) * 0.001;
+        instances[i] = BenchInstance{offset, std::vector<AnimationCursor>(channels), AnimationPose{}};
+    }
+
+    const double dt = 1.0 / 60.0;
+    auto advance = [&]() {
+        for(auto& instance : instances)
+            instance.time = std::fmod(instance.time + dt, duration);
+    };
+
+    spdlog::info("anim-cache: {} instance(s) in {} group(s), {} channel(s), {} key(s), {} frame(s)", args.count, groups, channels, args.keys, args.frames);
+    const double samples = static_cast<double>(args.count) * args.frames;
+
+    report("no cache", measure(args.frames, [&](int) {
+        advance();
+        for(auto& instance : instances)
+            instance.pose.evaluate(anim, &nodes, nullptr, instance.time, instance.cursors.data());
+    }), samples);
+
+    std::vector<std::shared_ptr<AnimationPose>> shared(instances.size());
+    for(double tolerance : {1.0 / 240.0, 1.0 / 120.0, 1.0 / 60.0})
+    {
+        AnimationPoseCache cache;
+        cache.setTolerance(tolerance);
+        report(fmt::format("cache, tolerance {:.1f} ms", tolerance * 1000.0), measure(args.frames, [&](int) {
+            advance();
+            for(size_t i = 0; i < instances.size(); i++)
+            {
+                double time;
+                bool evaluate;
+                shared[i] = cache.acquire(&anim, &nodes, nullptr, instances[i].time, time, evaluate);
+                if(evaluate)
+                    shared[i]->evaluate(anim, &nodes, nullptr, time, instances[i].cursors.data());
+            }
+            cache.endFrame();
+        }), samples);
+        const auto& stats = cache.totalStats();
+        spdlog::info("    hit rate {:.1f}%, {:.1f} pose(s)/frame", stats.hitRate() * 100.0, static_cast<double>(stats.poses) / args.frames);
+    }
+}
+
+static void benchAnimBake(const BenchArgs& args)
+{
+    const double duration = 4.0;
+    AnimationPrimitive anim = makeBenchAnimation(args.count, args.keys, duration);
+    ModelNodeTree nodes = makeBenchNodes(args.count);
+    const double dt = 1.0 / 60.0;
+    const double samples = static_cast<double>(args.count) * args.frames;
+    spdlog::info("anim-bake: {} channel(s), {} key(s), {} frame(s)", args.count, args.keys, args.frames);
+
+    BenchInstance instance{0.0, std::vector<AnimationCursor>(args.count), AnimationPose{}};
+    auto run = [&](const std::string& name) {
+        report(name, measure(args.frames, [&](int frame) {
+            instance.pose.evaluate(anim, &nodes, nullptr, std::fmod(frame * dt * 1.01, duration), instance.cursors.data());
+        }), samples);
+    };
+
+    run("keyframes");
+    for(double rate : {15.0, 30.0, 60.0})
+    {
+        auto bake = anim.bake(rate);
+        run(fmt::format("baked {} Hz", rate));
+        spdlog::info("    {} frames, {} -> {} bytes, max error {:.5f} translation, {:.5f} matrix",
+                     bake.frames, bake.keyBytes, bake.bakedBytes, bake.maxTranslationError, bake.maxMatrixError);
+    }
+}
+
+static void benchAnimCompress(const BenchArgs& args)
+{
+    const double duration = 4.0;
+    // resampled motion: smooth curves with a hold in the middle, as exporters bake them
+    AnimationPrimitive anim("bench", duration);
+    for(int channel = 0; channel < args.count; channel++)
+    {
+        AnimationChannelKeys keys;
+        for(int key = 0; key < args.keys; key++)
+        {
+            float time = static_cast<float>(duration * key / (args.keys - 1));
+            float phase = std::clamp(time - 1.5f, 0.f, 1.f) + std::max(time - 2.5f, 0.f);
+            keys.positionTimes.push_back(time);
+            keys.positions.push_back(glm::vec3(channel + std::sin(phase), phase * 2.f, 0.f));
+            keys.rotationTimes.push_back(time);
+            keys.rotations.push_back(glm::angleAxis(phase, glm::normalize(glm::vec3(1.f, channel, 2.f))));
+            keys.scaleTimes.push_back(time);
+            keys.scales.push_back(glm::vec3(1.f));
+        }
+        anim.addChannel(keys, channel);
+    }
+    ModelNodeTree nodes = makeBenchNodes(args.count);
+
+    const double dt = 1.0 / 60.0;
+    const double samples = static_cast<double>(args.count) * args.frames;
+    spdlog::info("anim-compress: {} channel(s), {} key(s), {} frame(s)", args.count, args.keys, args.frames);
+
+    BenchInstance instance{0.0, std::vector<AnimationCursor>(args.count), AnimationPose{}};
+    auto run = [&](const std::string& name, const AnimationPrimitive& clip) {
+        report(name, measure(args.frames, [&](int frame) {
+            instance.pose.evaluate(clip, &nodes, nullptr, std::fmod(frame * dt, duration), instance.cursors.data());
+        }), samples);
+    };
+    run("uncompressed", anim);
+
+    for(float tolerance : {1e-4f, 1e-3f, 1e-2f})
+    {
+        AnimationPrimitive compressed = anim;
+        auto result = compressed.compress(AnimationCompressionSettings{tolerance, tolerance, tolerance});
+        run(fmt::format("compressed, tol {}", tolerance), compressed);
+        spdlog::info("    {} -> {} keys, {} -> {} bytes, max error {:.5f} position, {:.5f} rad rotation, {:.5f} scale",
+                     result.keysBefore, result.keysAfter, result.bytesBefore, result.bytesAfter,
+                     result.maxPositionError, result.maxRotationError, result.maxScaleError);
+    }
+}
+
+static void benchAnimLOD(const BenchArgs& args)
+{
+    const double duration = 4.0;
+    const int channels = 32;
+    AnimationPrimitive anim = makeBenchAnimation(channels, args.keys, duration);
+    ModelNodeTree nodes = makeBenchNodes(channels);
+
+    std::vector<BenchInstance> instances(args.count);
+    std::vector<AnimationPose> from(args.count), to(args.count);
+    for(int i = 0; i < args.count; i++)
+        instances[i] = BenchInstance{std::fmod(i * 0.37, duration), std::vector<AnimationCursor>(channels), AnimationPose{}};
+
+    const double dt = 1.0 / 60.0;
+    spdlog::info("anim-lod: {} instance(s), {} channel(s), {} key(s), {} frame(s)", args.count, channels, args.keys, args.frames);
+    const double samples = static_cast<double>(args.count) * args.frames;
+
+    // mix of an army seen from above: a quarter near the camera, half far away, a quarter off-screen
+    for(uint32_t interval : {1u, 2u, 4u, 8u})
+    {
+        report(fmt::format("lod, reduced every {}", interval), measure(args.frames, [&](int frame) {
+            for(size_t i = 0; i < instances.size(); i++)
+            {
+                auto& instance = instances[i];
+                size_t tier = i % 4;
+                if(tier == 0)
+                    instance.pose.evaluate(anim, &nodes, nullptr, instance.time, instance.cursors.data());
+                else if(tier < 3)
+                {
+                    uint32_t step = static_cast<uint32_t>(frame) % interval;
+                    if(step == 0)
+                    {
+                        std::swap(from[i], to[i]);
+                        if(frame == 0)
+                            from[i].evaluate(anim, &nodes, nullptr, instance.time, instance.cursors.data());
+                        to[i].evaluate(anim, &nodes, nullptr, std::fmod(instance.time + interval * dt, duration), instance.cursors.data());
+                    }
+                    instance.pose.interpolate(from[i], to[i], static_cast<float>(step) / interval);
+                }
+                instance.time = std::fmod(instance.time + dt, duration);
+            }
+        }), samples);
+    }
+
+    report("all full", measure(args.frames, [&](int) {
+        for(auto& instance : instances)
+        {
+            instance.pose.evaluate(anim, &nodes, nullptr, instance.time, instance.cursors.data());
+            instance.time = std::fmod(instance.time + dt, duration);
+        }
+    }), samples);
+}
+
+static void benchAnimBlend(const BenchArgs& args)
+{
+    const int channels = 32;
+    AnimationPrimitive walk = makeBenchAnimation(channels, args.keys, 4.0);
+    AnimationPrimitive run = makeBenchAnimation(channels, args.keys, 2.5);
+    AnimationPrimitive breathe = makeBenchAnimation(channels / 4, args.keys, 3.0);
+    ModelNodeTree nodes = makeBenchNodes(channels);
+
+    struct BlendInstance
+    {
+        double time;
+        std::vector<AnimationCursor> walkCursors, runCursors, breatheCursors;
+        AnimationPose pose;
+    };
+    std::vector<BlendInstance> instances(args.count);
+    for(int i = 0; i < args.count; i++)
+        instances[i] = BlendInstance{i * 0.37, std::vector<AnimationCursor>(channels), std::vector<AnimationCursor>(channels),
+                                     std::vector<AnimationCursor>(channels / 4), AnimationPose{}};
+
+    const double dt = 1.0 / 60.0;
+    const double samples = static_cast<double>(args.count) * args.frames;
+    spdlog::info("anim-blend: {} instance(s), {} channel(s), {} key(s), {} frame(s)", args.count, channels, args.keys, args.frames);
+
+    // the first frame sizes the buffers, the measured ones must not allocate
+    auto run_suite = [&](const std::string& name, size_t layerCount) {
+        auto frame = [&](int frameId) {
+            for(auto& instance : instances)
+            {
+                double time = instance.time + frameId * dt;
+                float fade = static_cast<float>(std::fmod(time, 1.0));
+                AnimationLayer layers[3] = {
+                    {&walk, std::fmod(time, walk.duration()), 1.f, false, instance.walkCursors.data()},
+                    {&run, std::fmod(time, run.duration()), fade, false, instance.runCursors.data()},
+                    {&breathe, std::fmod(time, breathe.duration()), 0.5f, true, instance.breatheCursors.data()}};
+                if(layerCount == 1)
+                    instance.pose.evaluate(walk, &nodes, nullptr, layers[0].timecode, layers[0].cursors);
+                else
+                    instance.pose.evaluateBlend(layers, layerCount, &nodes, nullptr);
+            }
+        };
+        std::function<void(int)> fn = frame;
+        fn(0);
+        size_t allocations = allocationCount.load();
+        double seconds = measure(args.frames, fn);
+        allocations = allocationCount.load() - allocations;
+        report(name, seconds, samples);
+        spdlog::info("    {} allocation(s) while measuring", allocations);
+    };
+
+    run_suite("single clip", 1);
+    run_suite("cross-fade", 2);
+    run_suite("cross-fade + additive", 3);
+}
+
+static void benchMorph(const BenchArgs& args)
+{
+    // facial style morph: two targets (expressions, phonemes) of 8 poses, each pose moves a tenth of the vertices
+    const uint32_t vertexCount = 4000, targetCount = 2, poseCount = 8;
+    std::vector<glm::vec3> base(vertexCount);
+    for(uint32_t i = 0; i < vertexCount; i++)
+        base[i] = glm::vec3(i % 64, i / 64, 0.f) * 0.01f;
+
+    MeshMorph morph;
+    std::vector<std::vector<std::vector<glm::vec3>>> fullPoses(targetCount); // the same keys as full vertex copies
+    for(uint32_t target = 0; target < targetCount; target++)
+    {
+        MorphTarget morphTarget{fmt::format("target{}", target), {}};
+        for(uint32_t pose = 0; pose < poseCount; pose++)
+        {
+            std::vector<glm::vec3> positions = base;
+            uint32_t first = (target * poseCount + pose) * vertexCount / (targetCount * poseCount * 2);
+            for(uint32_t i = first; i < first + vertexCount / 10; i++)
+                positions[i].z += 0.01f * (pose + 1);
+            morphTarget.keys.push_back(MeshMorph::makeKey(static_cast<float>(pose + 1), base, positions));
+            fullPoses[target].push_back(std::move(positions));
+        }
+        morph.addTarget(morphTarget);
+    }
+
+    // a new pose every 5 frames at 30 fps
+    MorphAnimation anim("bench", 4.0);
+    for(uint32_t target = 0; target < targetCount; target++)
+    {
+        MorphTrack track{0, target, {}, {}};
+        for(uint32_t key = 0; key <= 24; key++)
+        {
+            track.times.push_back(key / 6.f);
+            track.poses.push_back((key * 3 + target) % (poseCount + 1));
+        }
+        anim.addTrack(track);
+    }
+
+    spdlog::info("morph: {} instance(s), {} vertices, {} target(s) of {} pose(s), {} frame(s)", args.count, vertexCount, targetCount, poseCount, args.frames);
+    spdlog::info("    {} bytes of sparse keys ({} deltas), {} bytes as full copies", morph.memoryUsage(), morph.deltaCount(),
+                 targetCount * poseCount * vertexCount * sizeof(glm::vec3));
+    const double dt = 1.0 / 60.0;
+    const double samples = static_cast<double>(args.count) * args.frames;
+
+    std::vector<std::vector<glm::vec3>> instances(args.count, base);
+    std::vector<MorphWeight> weights;
+    double total = 0.0;
+    report("full copies", measure(args.frames, [&](int frame) {
+        for(int i = 0; i < args.count; i++)
+        {
+            weights.clear();
+            anim.sample(0, std::fmod((frame + i) * dt, anim.duration()), weights);
+            auto& positions = instances[i];
+            positions = base;
+            // every pose blends all of its vertices
+            for(const auto& weight : weights)
+            {
+                const auto& pose = fullPoses[weight.target][weight.key];
+                for(uint32_t v = 0; v < vertexCount; v++)
+                    positions[v] += (pose[v] - base[v]) * weight.weight;
+            }
+            total += positions[vertexCount / 2].z;
+        }
+    }), samples);
+
+    report("sparse deltas", measure(args.frames, [&](int frame) {
+        for(int i = 0; i < args.count; i++)
+        {
+            weights.clear();
+            anim.sample(0, std::fmod((frame + i) * dt, anim.duration()), weights);
+            auto& positions = instances[i];
+            positions = base;
+            morph.apply(weights, positions);
+            total += positions[vertexCount / 2].z;
+        }
+    }), samples);
+    spdlog::info("    checksum {:.0f}", total);
+}
+
+static void benchTransforms(const BenchArgs& args)
+{
+    // mostly static scenery with a few moving units
+    std::vector<glm::vec3> positions(args.count);
+    std::vector<glm::quat> rotations(args.count);
+    std::vector<glm::vec3> scales(args.count, glm::vec3(1.f));
+    for(int i = 0; i < args.count; i++)
+    {
+        positions[i] = glm::vec3(i % 100, 0.f, i / 100);
+        rotations[i] = glm::angleAxis(i * 0.1f, glm::vec3(0.f, 1.f, 0.f));
+    }
+    spdlog::info("transforms: {} transform(s), {} frame(s)", args.count, args.frames);
+    const double samples = static_cast<double>(args.count) * args.frames;
+
+    std::vector<glm::mat4> worlds(args.count);
+    report("recompose all", measure(args.frames, [&](int frame) {
+        positions[frame % args.count].y += 0.01f;
+        for(int i = 0; i < args.count; i++)
+            worlds[i] = glm::translate(glm::mat4(1.f), positions[i]) * glm::toMat4(rotations[i]) * glm::scale(glm::mat4(1.f), scales[i]);
+    }), samples);
+
+    for(double moving : {0.01, 0.1, 1.0})
+    {
+        TransformSystem transforms;
+        std::vector<uint32_t> slots(args.count);
+        for(int i = 0; i < args.count; i++)
+            slots[i] = transforms.add(positions[i], rotations[i], scales[i]);
+        transforms.update();
+
+        const int movingCount = std::max(1, static_cast<int>(args.count * moving));
+        size_t recomputed = 0;
+        report(fmt::format("dirty only, {:.0f}% moving", moving * 100.0), measure(args.frames, [&](int frame) {
+            for(int i = 0; i < movingCount; i++)
+            {
+                size_t index = (static_cast<size_t>(frame) * 7919 + i) % args.count;
+                positions[index].y += 0.01f;
+                transforms.setPosition(slots[index], positions[index]);
+            }
+            transforms.update();
+            recomputed += transforms.lastRecomputed();
+        }), samples);
+        spdlog::info("    {:.0f} recomputed per frame", static_cast<double>(recomputed) / args.frames);
+    }
+
+    // everything moving, both passes split over pools of several sizes
+    spdlog::info("  thread scaling, global pool {} thread(s)", ThreadPool::global().threadCount());
+    for(unsigned workers : {1u, 3u, 7u})
+    {
+        ThreadPool pool(workers);
+        TransformSystem transforms(pool);
+        std::vector<uint32_t> slots(args.count);
+        for(int i = 0; i < args.count; i++)
+            slots[i] = transforms.add(positions[i], rotations[i], scales[i]);
+        transforms.update();
+
+        report(fmt::format("100% moving, {} threads", pool.threadCount()), measure(args.frames, [&](int frame) {
+            for(int i = 0; i < args.count; i++)
+            {
+                positions[i].y += 0.01f;
+                transforms.setPosition(slots[i], positions[i]);
+            }
+            transforms.update();
+        }), samples);
+    }
+
+    // units of four parts (hull, turret, barrel, sight), 1% of the hulls move
+    // scripted follow logic copies every part's transform from its parent each frame
+    const int partsPerUnit = 4;
+    const int units = std::max(1, args.count / partsPerUnit);
+    const int movingUnits = std::max(1, units / 100);
+    std::vector<glm::mat4> locals(args.count);
+    for(int i = 0; i < args.count; i++)
+        locals[i] = glm::translate(glm::mat4(1.f), positions[i]) * glm::toMat4(rotations[i]);
+    report("follow logic, 1% of units moving", measure(args.frames, [&](int frame) {
+        for(int i = 0; i < movingUnits; i++)
+        {
+            size_t unit = (static_cast<size_t>(frame) * 7919 + i) % units;
+            locals[unit * partsPerUnit][3].y += 0.01f;
+        }
+        for(int i = 0; i < args.count; i++)
+            worlds[i] = i % partsPerUnit == 0 ? locals[i] : worlds[i - 1] * locals[i];
+    }), samples);
+
+    TransformSystem hierarchy;
+    std::vector<uint32_t> slots(args.count);
+    for(int i = 0; i < args.count; i++)
+    {
+        slots[i] = hierarchy.add(positions[i], rotations[i], scales[i]);
+        if(i % partsPerUnit != 0)
+            hierarchy.setParent(slots[i], slots[i - 1]);
+    }
+    hierarchy.update();
+
+    size_t recomputed = 0;
+    report("hierarchy, 1% of units moving", measure(args.frames, [&](int frame) {
+        for(int i = 0; i < movingUnits; i++)
+        {
+            size_t index = (static_cast<size_t>(frame) * 7919 + i) % units * partsPerUnit;
+            positions[index].y += 0.01f;
+            hierarchy.setPosition(slots[index], positions[index]);
+        }
+        hierarchy.update();
+        recomputed += hierarchy.lastRecomputed();
+    }), samples);
+    spdlog::info("    {:.0f} recomputed per frame", static_cast<double>(recomputed) / args.frames);
+}
+
+static void benchSpatial(const BenchArgs& args)
+{
+    // entities of 0.5-2.5 units scattered over a 2 km square, 1% of them moving every frame
+    const float worldSize = 2000.f;
+    const int queriesPerFrame = 16;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coord(0.f, worldSize);
+    std::uniform_real_distribution<float> size(0.5f, 2.5f);
+    std::vector<SpatialBounds> bounds(args.count);
+    for(auto& b : bounds)
+        b = SpatialBounds::fromSphere(glm::vec3(coord(rng), coord(rng) * 0.05f, coord(rng)), size(rng));
+
+    SpatialIndex index;
+    std::vector<uint32_t> proxies(args.count);
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < args.count; i++)
+        proxies[i] = index.insert(bounds[i], reinterpret_cast<Entity*>(static_cast<uintptr_t>(i + 1)));
+    double buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("spatial: {} entities, {} frame(s), {} queries per frame", args.count, args.frames, queriesPerFrame);
+    spdlog::info("  build {:.3f} ms, tree height {}", buildTime * 1000.0, index.height());
+
+    const int movingCount = std::max(1, args.count / 100);
+    size_t reinserted = 0;
+    report("move 1%", measure(args.frames, [&](int frame) {
+        for(int i = 0; i < movingCount; i++)
+        {
+            size_t id = (static_cast<size_t>(frame) * 7919 + i) % args.count;
+            glm::vec3 step(0.1f, 0.f, 0.05f);
+            bounds[id].min += step;
+            bounds[id].max += step;
+            reinserted += index.move(proxies[id], bounds[id]);
+        }
+    }), static_cast<double>(movingCount) * args.frames);
+    spdlog::info("    {:.1f}% reinserted", 100.0 * reinserted / (static_cast<double>(movingCount) * args.frames));
+
+    std::vector<glm::vec3> centers(queriesPerFrame * 64);
+    for(auto& c : centers)
+        c = glm::vec3(coord(rng), coord(rng) * 0.05f, coord(rng));
+    auto center = [&](int frame, int q) { return centers[(frame * queriesPerFrame + q) % centers.size()]; };
+    const double queries = static_cast<double>(queriesPerFrame) * args.frames;
+
+    // scanning every entity, what scripts had to do so far
+    std::vector<Entity*> found;
+    size_t scanned = 0, indexed = 0;
+    report("box, linear scan", measure(args.frames, [&](int frame) {
+        for(int q = 0; q < queriesPerFrame; q++)
+        {
+            SpatialBounds query = SpatialBounds::fromSphere(center(frame, q), 30.f);
+            found.clear();
+            for(int i = 0; i < args.count; i++)
+            {
+                if(bounds[i].overlaps(query))
+                    found.push_back(reinterpret_cast<Entity*>(static_cast<uintptr_t>(i + 1)));
+            }
+            scanned += found.size();
+        }
+    }), queries);
+    report("box, index", measure(args.frames, [&](int frame) {
+        for(int q = 0; q < queriesPerFrame; q++)
+        {
+            found.clear();
+            index.queryBox(SpatialBounds::fromSphere(center(frame, q), 30.f), found);
+            indexed += found.size();
+        }
+    }), queries);
+    if(scanned != indexed)
+        spdlog::error("    index found {} entities, the scan {}", indexed, scanned);
+
+    report("sphere, index", measure(args.frames, [&](int frame) {
+        for(int q = 0; q < queriesPerFrame; q++)
+        {
+            found.clear();
+            index.querySphere(center(frame, q), 30.f, found);
+        }
+    }), queries);
+
+    std::vector<SpatialRayHit> hits;
+    report("ray 200 m, index", measure(args.frames, [&](int frame) {
+        for(int q = 0; q < queriesPerFrame; q++)
+        {
+            hits.clear();
+            index.queryRay(RaySegment{center(frame, q), glm::vec3(200.f, 0.f, 0.f), 1.f}, hits);
+        }
+    }), queries);
+
+    glm::mat4 viewProj = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.5f, 300.f)
+                       * glm::lookAt(glm::vec3(worldSize * 0.5f, 20.f, worldSize * 0.5f), glm::vec3(worldSize * 0.5f + 1.f, 20.f, worldSize * 0.5f), glm::vec3(0.f, 1.f, 0.f));
+    size_t visible = 0;
+    report("frustum, index", measure(args.frames, [&](int frame) {
+        found.clear();
+        index.queryFrustum(viewProj, found);
+        visible += found.size();
+    }), args.frames);
+    spdlog::info("    {:.0f} visible per frame", static_cast<double>(visible) / args.frames);
+}
+
+static void benchCulling(const BenchArgs& args)
+{
+    // bounding spheres around a camera looking down +x, about a sixth of them inside its frustum
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> coord(-300.f, 300.f);
+    std::uniform_real_distribution<float> size(0.5f, 4.f);
+    std::vector<float> x(args.count), y(args.count), z(args.count), radius(args.count);
+    for(int i = 0; i < args.count; i++)
+    {
+        x[i] = coord(rng);
+        y[i] = coord(rng) * 0.1f;
+        z[i] = coord(rng);
+        radius[i] = size(rng);
+    }
+
+    glm::mat4 viewProj = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.5f, 300.f)
+                       * glm::lookAt(glm::vec3(0.f), glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+    glm::vec4 row[4];
+    for(int i = 0; i < 4; i++)
+        row[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    const glm::vec4 frustum[6] = {row[3] + row[0], row[3] - row[0], row[3] + row[1], row[3] - row[1], row[3] + row[2], row[3] - row[2]};
+    float planes[24];
+    for(int i = 0; i < 6; i++)
+    {
+        glm::vec4 plane = frustum[i] / glm::length(glm::vec3(frustum[i]));
+        for(int k = 0; k < 4; k++)
+            planes[i * 4 + k] = plane[k];
+    }
+    spdlog::info("culling: {} sphere(s), {} frame(s)", args.count, args.frames);
+    const double samples = static_cast<double>(args.count) * args.frames;
+
+    // what Camera3D::sphereInFrustum does per mesh
+    std::vector<uint8_t> scalarVisible(args.count), visible(args.count);
+    report("scalar, per sphere", measure(args.frames, [&](int) {
+        for(int i = 0; i < args.count; i++)
+        {
+            bool inside = true;
+            for(int p = 0; p < 6 && inside; p++)
+                inside = glm::dot(glm::vec3(frustum[p]), glm::vec3(x[i], y[i], z[i])) + frustum[p].w >= -radius[i] * glm::length(glm::vec3(frustum[p]));
+            scalarVisible[i] = inside;
+        }
+    }), samples);
+    report("simd, 4 per step", measure(args.frames, [&](int) {
+        clean::simd::spheresInPlanes(planes, 6, x.data(), y.data(), z.data(), radius.data(), args.count, visible.data());
+    }), samples);
+
+    size_t visibleCount = 0, mismatches = 0;
+    for(int i = 0; i < args.count; i++)
+    {
+        visibleCount += visible[i];
+        // spheres touching a plane may land on either side through rounding
+        mismatches += visible[i] != scalarVisible[i];
+    }
+    spdlog::info("    {} visible, {} culled, {} differ from the scalar test", visibleCount, args.count - visibleCount, mismatches);
+}
+
+// about the size of an entity with its transform and bookkeeping
+struct BenchProjectile
+{
+    glm::mat4 world;
+    glm::vec3 position, velocity;
+    glm::quat rotation;
+    std::shared_ptr<BenchProjectile> owner;
+    uint64_t id;
+    float lifetime;
+    char scriptState[160];
+};
+
+static void benchPool(const BenchArgs& args)
+{
+    // a steady stream of projectiles, a tenth of the live ones replaced each frame
+    const int spawnsPerFrame = std::max(1, args.count / 10);
+    spdlog::info("pool: {} live object(s), {} spawn(s) and despawn(s) per frame, {} frame(s)", args.count, spawnsPerFrame, args.frames);
+    const double samples = static_cast<double>(spawnsPerFrame) * args.frames;
+
+    auto churn = [&](const std::string& name, const std::function<std::shared_ptr<BenchProjectile>()>& spawn) {
+        std::vector<std::shared_ptr<BenchProjectile>> live(args.count);
+        for(auto& object : live)
+            object = spawn();
+        size_t next = 0;
+        size_t allocations = allocationCount.load();
+        report(name, measure(args.frames, [&](int) {
+            for(int i = 0; i < spawnsPerFrame; i++)
+            {
+                live[next] = spawn();
+                live[next]->lifetime = 2.f;
+                next = (next + 1) % live.size();
+            }
+        }), samples);
+        spdlog::info("    {:.2f} heap allocation(s) per spawn", static_cast<double>(allocationCount.load() - allocations) / samples);
+    };
+
+    churn("make_shared", []() { return std::make_shared<BenchProjectile>(); });
+    churn("pooled", []() { return clean::makePooled<BenchProjectile>(); });
+
+    for(const auto& stats : clean::ObjectPool::allStats())
+        spdlog::info("    pool {}: {} byte slots, {} live, {} high water, {} capacity, {} allocations",
+                     stats.name, stats.slotSize, stats.live, stats.highWater, stats.capacity, stats.allocations);
+}
+
+static void benchEvents(const BenchArgs& args)
+{
+    // per entity update events, as Entity raises them every frame; most entities have no script attached
+    spdlog::info("events: {} entities, {} frame(s)", args.count, args.frames);
+    const double samples = static_cast<double>(args.count) * args.frames;
+    double total = 0.0;
+
+    for(int every : {1, 10})
+    {
+        std::vector<boost::signals2::signal<void(double)>> signals(args.count);
+        std::vector<clean::delegate_list<void(double)>> delegates(args.count);
+        for(int i = 0; i < args.count; i += every)
+        {
+            signals[i].connect([&total](double dt) { total += dt; });
+            delegates[i].connect([&total](double dt) { total += dt; });
+        }
+
+        report(fmt::format("signals2, 1 in {} subscribed", every), measure(args.frames, [&](int) {
+            for(auto& signal : signals)
+                signal(0.016);
+        }), samples);
+        report(fmt::format("delegates, 1 in {} subscribed", every), measure(args.frames, [&](int) {
+            for(auto& delegate : delegates)
+                delegate(0.016);
+        }), samples);
+    }
+
+    // one queued event per entity and frame, delivered at the end of the frame
+    struct Hit
+    {
+        uint32_t entity;
+        float damage;
+    };
+    clean::EventBus bus;
+    bus.subscribe<Hit>([&total](const Hit& hit) { total += hit.damage; });
+    report("event bus, publish + dispatch", measure(args.frames, [&](int) {
+        for(int i = 0; i < args.count; i++)
+            bus.publish(Hit{static_cast<uint32_t>(i), 1.f});
+        bus.dispatch();
+    }), samples);
+    spdlog::info("    checksum {:.0f}", total);
+}
+
+int main(int argc, char* argv[])
+{
+    spdlog::set_pattern("%v");
+    auto args = argparse::parse<BenchArgs>(argc, argv);
+
+    if(args.suite == "anim-sampling")
+        benchAnimSampling(args);
+    else if(args.suite == "anim-parallel")
+        benchAnimParallel(args);
+    else if(args.suite == "anim-cache")
+        benchAnimCache(args);
+    else if(args.suite == "anim-bake")
+        benchAnimBake(args);
+    else if(args.suite == "anim-compress")
+        benchAnimCompress(args);
+    else if(args.suite == "anim-lod")
+        benchAnimLOD(args);
+    else if(args.suite == "anim-blend")
+        benchAnimBlend(args);
+    else if(args.suite == "morph")
+        benchMorph(args);
+    else if(args.suite == "transforms")
+        benchTransforms(args);
+    else if(args.suite == "spatial")
+        benchSpatial(args);
+    else if(args.suite == "culling")
+        benchCulling(args);
+    else if(args.suite == "pool")
+        benchPool(args);
+    else if(args.suite == "events")
+        benchEvents(args);
+    else
+    {
+        spdlog::error("Unknown suite '{}'", args.suite);
+        return 1;
+    }
+    return 0;
+}
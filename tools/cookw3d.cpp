@@ -0,0 +1,345 @@
+// cleanengine-cook-w3d: converts every .w3d entry of the given .big archives into cooked models
+// (see ModelCache), which ModelManager loads instead of running Assimp on the source file
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <assimp/IOSystem.hpp>
+#include <assimp/MemoryIOWrapper.h>
+#include <spdlog/spdlog.h>
+
+#include "argparse.hpp"
+#include "common/loaders/bigresourceloader.hpp"
+#include "common/importers/modelimporter.hpp"
+#include "common/3d/modelcache.hpp"
+
+#define MANIFEST_NAME "cooked/manifest.txt"
+
+struct ArchiveEntry
+{
+    std::string archive;
+    BigFileEntry entry;
+};
+
+// 'Art\W3D\ABC.w3d' -> 'art/w3d/abc.w3d'
+static std::string normalizePath(const std::string& path)
+{
+    std::string result = boost::algorithm::to_lower_copy(path);
+    std::replace(result.begin(), result.end(), '\\', '/');
+    return result;
+}
+
+// lets the importer open files referenced by a model (e.g. skeleton hierarchies) from the archives
+// and remembers every path it was asked about, found or not, as the dependencies of the import
+class ArchiveIOSystem : public Assimp::IOSystem
+{
+public:
+    ArchiveIOSystem(const std::map<std::string, ArchiveEntry>& entries)
+        : m_entries(entries)
+    {}
+
+    bool Exists(const char* pFile) const override
+    {
+        std::string path = normalizePath(pFile);
+        m_requested.insert(path);
+        return m_entries.find(path) != m_entries.end();
+    }
+
+    char getOsSeparator() const override
+    {
+        return '/';
+    }
+
+    Assimp::IOStream* Open(const char* pFile, const char* pMode = "rb") override
+    {
+        (void)pMode;
+        std::string path = normalizePath(pFile);
+        m_requested.insert(path);
+        auto it = m_entries.find(path);
+        if(it == m_entries.end())
+            return nullptr;
+
+        auto resource = BigResourceLoader::readEntry(it->second.archive, it->second.entry);
+        uint8_t* buffer = new uint8_t[resource->data.size()];
+        std::copy(resource->data.begin(), resource->data.end(), buffer);
+        return new Assimp::MemoryIOStream(buffer, resource->data.size(), true);
+    }
+
+    void Close(Assimp::IOStream* pFile) override
+    {
+        delete pFile;
+    }
+
+    // paths requested since the last call, sorted
+    std::vector<std::string> takeRequested()
+    {
+        std::vector<std::string> paths(m_requested.begin(), m_requested.end());
+        m_requested.clear();
+        return paths;
+    }
+private:
+    const std::map<std::string, ArchiveEntry>& m_entries;
+    mutable std::set<std::string> m_requested;
+};
+
+struct CookArgs : public argparse::Args
+{
+    std::vector<std::string>& archives = arg("archives", ".big archives to cook").multi_argument();
+    std::string& output = kwarg("o,output", "resource root the cooked/ directory is written to").set_default("data");
+    bool& incremental = flag("i,incremental", "skip files whose source hash matches the manifest");
+    int& jobs = kwarg("j,jobs", "worker threads, 0 uses all cores").set_default(0);
+    bool& compressAnimations = flag("c,compress-animations", "drop redundant animation keys and quantize positions/rotations");
+};
+
+enum class CookStatus
+{
+    eCooked,
+    eSkipped,
+    eFailed
+};
+
+struct CookJob
+{
+    std::string archive;
+    BigFileEntry entry;
+    std::string cookedPath;
+
+    // filled by workers
+    CookStatus status = CookStatus::eFailed;
+    uint64_t hash = 0;
+    std::vector<std::string> dependencies; // other archive files read by the import
+    size_t bytesOut = 0;
+    double milliseconds = 0.0;
+    std::string error;
+};
+
+struct ManifestEntry
+{
+    uint64_t hash;
+    std::vector<std::string> dependencies;
+};
+
+// FNV-1a over the source data, the dependencies (path and data, missing ones only by path),
+// the cooked format version and the cook options
+static uint64_t sourceHash(const std::vector<char>& data, const std::vector<std::string>& dependencies,
+                           const std::map<std::string, ArchiveEntry>& entries, bool compressAnimations)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto feed = [&hash](const char* bytes, size_t size) {
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= static_cast<uint8_t>(bytes[i]);
+            hash *= 0x100000001B3ull;
+        }
+    };
+    feed(data.data(), data.size());
+    for(const auto& dependency : dependencies)
+    {
+        feed(dependency.c_str(), dependency.size() + 1);
+        auto it = entries.find(dependency);
+        uint8_t found = it != entries.end() ? 1 : 0;
+        feed(reinterpret_cast<const char*>(&found), sizeof(found));
+        if(found)
+        {
+            auto resource = BigResourceLoader::readEntry(it->second.archive, it->second.entry);
+            feed(resource->data.data(), resource->data.size());
+        }
+    }
+    uint32_t version = ModelCache::VERSION;
+    feed(reinterpret_cast<const char*>(&version), sizeof(version));
+    uint8_t options = compressAnimations ? 1 : 0;
+    feed(reinterpret_cast<const char*>(&options), sizeof(options));
+    return hash;
+}
+
+// "<hash> <cooked path> <dependency>..." per line
+static std::map<std::string, ManifestEntry> readManifest(const std::filesystem::path& path)
+{
+    std::map<std::string, ManifestEntry> manifest;
+    std::ifstream file(path);
+    std::string line;
+    while(std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string cookedPath;
+        ManifestEntry entry{};
+        if(!(fields >> std::hex >> entry.hash >> cookedPath))
+            continue;
+        for(std::string dependency; fields >> dependency;)
+            entry.dependencies.push_back(dependency);
+        manifest[cookedPath] = std::move(entry);
+    }
+    return manifest;
+}
+
+static void writeManifest(const std::filesystem::path& path, const std::map<std::string, ManifestEntry>& manifest)
+{
+    std::ofstream file(path, std::ios::trunc);
+    for(const auto& [cookedPath, entry] : manifest)
+    {
+        file << fmt::format("{:016x} {}", entry.hash, cookedPath);
+        for(const auto& dependency : entry.dependencies)
+            file << ' ' << dependency;
+        file << '\n';
+    }
+}
+
+static void cookFile(ModelImporter& importer, ArchiveIOSystem& io, CookJob& job, const std::filesystem::path& root,
+                     const std::map<std::string, ArchiveEntry>& entries, const std::map<std::string, ManifestEntry>& manifest,
+                     bool incremental, bool compressAnimations)
+{
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        auto resource = BigResourceLoader::readEntry(job.archive, job.entry);
+
+        // the dependencies of the last cook decide, a changed or added skeleton file changes the hash
+        std::filesystem::path target = root / job.cookedPath;
+        auto manifestIt = manifest.find(job.cookedPath);
+        if(incremental && manifestIt != manifest.end() && std::filesystem::exists(target) &&
+           manifestIt->second.hash == sourceHash(resource->data, manifestIt->second.dependencies, entries, compressAnimations))
+        {
+            job.hash = manifestIt->second.hash;
+            job.dependencies = manifestIt->second.dependencies;
+            job.status = CookStatus::eSkipped;
+            return;
+        }
+
+        io.takeRequested();
+        auto model = importer.importFile(job.entry.filename(), job.entry.filename());
+        std::string sourcePath = normalizePath(job.entry.filename());
+        for(auto& dependency : io.takeRequested())
+        {
+            if(dependency != sourcePath)
+                job.dependencies.push_back(std::move(dependency));
+        }
+        job.hash = sourceHash(resource->data, job.dependencies, entries, compressAnimations);
+        std::vector<char> cooked = ModelCache::serialize(*model);
+
+        std::filesystem::create_directories(target.parent_path());
+        std::ofstream file(target, std::ios::binary | std::ios::trunc);
+        file.write(cooked.data(), cooked.size());
+        if(!file)
+            throw std::runtime_error(fmt::format("Failed to write '{}'", target.string()));
+
+        job.bytesOut = cooked.size();
+        job.status = CookStatus::eCooked;
+    }
+    catch(const std::exception& e)
+    {
+        job.status = CookStatus::eFailed;
+        job.error = e.what();
+    }
+    job.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if(job.status == CookStatus::eCooked)
+        spdlog::info("{} -> {} ({:.1f} ms, {} -> {} bytes)", job.entry.filename(), job.cookedPath, job.milliseconds, job.entry.dataSize(), job.bytesOut);
+    else
+        spdlog::error("{}: {} ({:.1f} ms)", job.entry.filename(), job.error, job.milliseconds);
+}
+
+int main(int argc, char* argv[])
+{
+    spdlog::set_pattern("[%H:%M:%S %z] [%^---%L---%$] %v");
+    spdlog::set_level(spdlog::level::warn); // keep Assimp/W3D import chatter out of the report
+
+    auto args = argparse::parse<CookArgs>(argc, argv);
+    spdlog::set_level(spdlog::level::info);
+
+    // later archives override entries of earlier ones, like the game does
+    std::map<std::string, ArchiveEntry> entries;
+    std::map<std::string, CookJob> jobsByPath;
+    for(const auto& archive : args.archives)
+    {
+        try
+        {
+            for(const auto& entry : BigResourceLoader::listEntries(archive))
+            {
+                if(!boost::iends_with(entry.filename(), ".w3d"))
+                    continue;
+                entries.insert_or_assign(normalizePath(entry.filename()), ArchiveEntry{archive, entry});
+                std::string cookedPath = ModelCache::cookedPath(entry.filename());
+                jobsByPath.insert_or_assign(cookedPath, CookJob{archive, entry, cookedPath});
+            }
+        }
+        catch(const std::exception& e)
+        {
+            spdlog::error("Failed to read archive '{}': {}", archive, e.what());
+            return 1;
+        }
+    }
+
+    std::vector<CookJob> jobs;
+    jobs.reserve(jobsByPath.size());
+    for(auto& it : jobsByPath)
+        jobs.push_back(std::move(it.second));
+
+    std::filesystem::path root(args.output);
+    std::filesystem::path manifestPath = root / MANIFEST_NAME;
+    std::map<std::string, ManifestEntry> manifest;
+    if(args.incremental)
+        manifest = readManifest(manifestPath);
+
+    unsigned threadCount = args.jobs > 0 ? static_cast<unsigned>(args.jobs) : std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min<unsigned>(threadCount, std::max<size_t>(jobs.size(), 1));
+    spdlog::info("Cooking {} W3D file(s) on {} thread(s)", jobs.size(), threadCount);
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> nextJob = 0;
+    std::vector<std::thread> workers;
+    for(unsigned i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back([&]() {
+            auto* io = new ArchiveIOSystem(entries); // owned by the importer
+            ModelImporter importer(io); // Assimp importers can't be shared between threads
+            importer.setAnimationCompression(args.compressAnimations);
+            for(size_t jobId = nextJob++; jobId < jobs.size(); jobId = nextJob++)
+                cookFile(importer, *io, jobs[jobId], root, entries, manifest, args.incremental, args.compressAnimations);
+        });
+    }
+    for(auto& worker : workers)
+        worker.join();
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t cooked = 0, skipped = 0, failed = 0;
+    size_t bytesIn = 0, bytesOut = 0;
+    for(const auto& job : jobs)
+    {
+        switch(job.status)
+        {
+        case CookStatus::eCooked:
+            cooked++;
+            bytesIn += job.entry.dataSize();
+            bytesOut += job.bytesOut;
+            manifest[job.cookedPath] = ManifestEntry{job.hash, job.dependencies};
+            break;
+        case CookStatus::eSkipped:
+            skipped++;
+            break;
+        case CookStatus::eFailed:
+            failed++;
+            manifest.erase(job.cookedPath);
+            break;
+        }
+    }
+
+    std::filesystem::create_directories(manifestPath.parent_path());
+    writeManifest(manifestPath, manifest);
+
+    spdlog::info("{} cooked, {} up to date, {} failed in {:.2f} s", cooked, skipped, failed, totalSeconds);
+    spdlog::info("{} bytes read, {} bytes written", bytesIn, bytesOut);
+    for(const auto& job : jobs)
+    {
+        if(job.status == CookStatus::eFailed)
+            spdlog::error("  failed: {} ({})", job.entry.filename(), job.error);
+    }
+    return failed > 0 ? 1 : 0;
+}